@@ -0,0 +1,514 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+/*
+    bench - lib, userspace routines and IPC micro-benchmarks on host-native core
+*/
+
+#include "userspace/stdio.h"
+#include "userspace/stdlib.h"
+#include "userspace/process.h"
+#include "userspace/ipc.h"
+#include "userspace/stream.h"
+#include "userspace/error.h"
+#include "userspace/linux/host.h"
+#include "userspace/systime.h"
+#include "userspace/array.h"
+#include "userspace/so.h"
+#include "userspace/rb.h"
+#include "userspace/ip.h"
+#include "userspace/crc.h"
+#include "userspace/svc.h"
+#include "midware/crypto/aes.h"
+#include "midware/crypto/sha1.h"
+#include "midware/crypto/sha256.h"
+#include "kernel_config.h"
+#include "config.h"
+
+//IPC commands, echo process is replying to
+typedef enum {
+    BENCH_IPC_PING = 0,
+    BENCH_IPC_CALL,
+    BENCH_IPC_BATCH,
+    //same cmd hash, as BENCH_IPC_CALL. Never posted to echo
+    BENCH_IPC_BACKLOG = BENCH_IPC_CALL + IPC_HASH_SIZE
+} BENCH_IPC;
+
+void app();
+void bench_echo();
+
+const REX __APP = {
+    //name
+    "Bench",
+    //size. Host signal frame is saved on process stack on host core
+    BENCH_PROCESS_SIZE,
+    //priority
+    200,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app
+};
+
+const REX __BENCH_ECHO = {
+    //name
+    "Bench echo",
+    //size
+    ECHO_PROCESS_SIZE,
+    //priority. Same as bench, so echo is running only when bench is waiting
+    200,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    bench_echo
+};
+
+static uint8_t __DATA[DATA_SIZE];
+static unsigned int __SEED;
+
+//userspace rand is mixed with uptime. Bench must be repeatable
+static unsigned int bench_rand()
+{
+    __SEED = __SEED * 1103515245 + 12345;
+    return __SEED >> 16;
+}
+
+static unsigned int pool_used()
+{
+    POOL_STAT stat;
+    ((const LIB_STD*)__GLOBAL->lib[LIB_ID_STD])->pool_stat(&__PROCESS->pool, &stat, get_sp());
+    return stat.used;
+}
+
+static void print_result(const char* name, unsigned int ops, unsigned int us, unsigned int bytes)
+{
+    //no 64 bit math
+    unsigned int ns = (us / ops) * 1000 + (us % ops) * 1000 / ops;
+    host_printf("%-16s %8d ops %8dus %6dns/op", name, ops, us, ns);
+    if (bytes)
+        host_printf(" %8d bytes", bytes);
+    host_printf("\n");
+}
+
+static void print_throughput(const char* name, unsigned int ops, unsigned int us, unsigned int size)
+{
+    unsigned int ns = (us / ops) * 1000 + (us % ops) * 1000 / ops;
+    //bytes per us is MB/s. All bench sets are below 4GB
+    host_printf("%-16s %8d ops %8dus %6dns/op %5dMB/s\n", name, ops, us, ns, us ? ops * size / us : 0);
+}
+
+static void bench_malloc(const char* name, unsigned int ops, unsigned int count, unsigned int max_size)
+{
+    void* slots[MALLOC_SLOTS];
+    void* ptr;
+    SYSTIME uptime;
+    unsigned int i, idx, used, peak;
+    memset(slots, 0, sizeof(slots));
+    __SEED = 1;
+    peak = 0;
+
+    get_uptime(&uptime);
+    for (i = 0; i < ops; ++i)
+    {
+        idx = bench_rand() % count;
+        switch (bench_rand() % 3)
+        {
+        case 0:
+            free(slots[idx]);
+            slots[idx] = NULL;
+            break;
+        case 1:
+            //on failure old slot is still valid
+            if ((ptr = realloc(slots[idx], bench_rand() % max_size + 1)) != NULL)
+                slots[idx] = ptr;
+            break;
+        default:
+            if (slots[idx] == NULL)
+                slots[idx] = malloc(bench_rand() % max_size + 1);
+        }
+    }
+    print_result(name, ops, systime_elapsed_us(&uptime), 0);
+
+    //pool footprint with live set, including headers and fragmentation
+    used = pool_used();
+    for (i = 0; i < count; ++i)
+        if (slots[i] != NULL)
+            peak += ((const LIB_STD*)__GLOBAL->lib[LIB_ID_STD])->pool_slot_size(&__PROCESS->pool, slots[i]);
+    host_printf("%-16s %8d bytes used, %d bytes in live slots, pool span %d bytes\n", "  footprint", used, peak,
+                (unsigned int)__PROCESS->pool.last_slot - (unsigned int)__PROCESS->pool.first_slot);
+    for (i = 0; i < count; ++i)
+        free(slots[i]);
+    //with KERNEL_RANGE_CHECKING every slot mark is verified
+    if (!((const LIB_STD*)__GLOBAL->lib[LIB_ID_STD])->pool_check(&__PROCESS->pool, get_sp()))
+    {
+        host_printf("%s: pool corrupted\n", name);
+        host_exit(1);
+    }
+}
+
+static void bench_array()
+{
+    ARRAY* ar;
+    SYSTIME uptime;
+    unsigned int i, used;
+    used = pool_used();
+    if (array_create(&ar, sizeof(unsigned int), 1) == NULL)
+        return;
+
+    get_uptime(&uptime);
+    for (i = 0; i < ARRAY_OPS; ++i)
+        *(unsigned int*)array_append(&ar) = i;
+    print_result("array append", ARRAY_OPS, systime_elapsed_us(&uptime), pool_used() - used);
+
+    get_uptime(&uptime);
+    for (i = ARRAY_OPS; i; --i)
+        array_remove(&ar, i - 1);
+    print_result("array remove", ARRAY_OPS, systime_elapsed_us(&uptime), pool_used() - used);
+    array_destroy(&ar);
+}
+
+static void bench_so()
+{
+    SO so;
+    HANDLE handles[SO_HANDLES];
+    SYSTIME uptime;
+    unsigned int i, idx, used;
+    used = pool_used();
+    if (so_create(&so, sizeof(unsigned int), 1) == NULL)
+        return;
+    __SEED = 1;
+
+    get_uptime(&uptime);
+    for (i = 0; i < SO_HANDLES; ++i)
+        handles[i] = so_allocate(&so);
+    print_result("so allocate", SO_HANDLES, systime_elapsed_us(&uptime), pool_used() - used);
+
+    get_uptime(&uptime);
+    for (i = 0; i < SO_OPS; ++i)
+    {
+        idx = bench_rand() % SO_HANDLES;
+        so_free(&so, handles[idx]);
+        handles[idx] = so_allocate(&so);
+        *(unsigned int*)so_get(&so, handles[idx]) = i;
+    }
+    print_result("so churn", SO_OPS, systime_elapsed_us(&uptime), pool_used() - used);
+    so_destroy(&so);
+}
+
+static void bench_rb()
+{
+    RB rb;
+    uint8_t buf[RB_SIZE];
+    SYSTIME uptime;
+    unsigned int i, sum;
+    rb_init(&rb, RB_SIZE);
+    sum = 0;
+
+    get_uptime(&uptime);
+    for (i = 0; i < RB_OPS; ++i)
+    {
+        buf[rb_put(&rb)] = (uint8_t)i;
+        //keep ring half full
+        if (rb_size(&rb) >= RB_SIZE / 2)
+            sum += buf[rb_get(&rb)];
+    }
+    print_result("rb put/get", RB_OPS, systime_elapsed_us(&uptime), 0);
+
+    get_uptime(&uptime);
+    for (i = 0; i < RB_OPS / RB_SIZE; ++i)
+    {
+        rb_clear(&rb);
+        while (!rb_is_full(&rb))
+        {
+            memset(buf + rb.head, (uint8_t)i, rb_put_span(&rb));
+            rb_put_advance(&rb, rb_put_span(&rb));
+        }
+        while (!rb_is_empty(&rb))
+        {
+            sum += buf[rb.tail];
+            rb_get_advance(&rb, rb_get_span(&rb));
+        }
+    }
+    print_throughput("rb span", RB_OPS / RB_SIZE, systime_elapsed_us(&uptime), RB_SIZE);
+    //don't let compiler to optimize it out
+    __DATA[0] = (uint8_t)sum;
+}
+
+static void bench_stream_failed(const char* name)
+{
+    host_printf("%s: error %d\n", name, get_last_error());
+    host_exit(1);
+}
+
+static void bench_stream()
+{
+    char buf[STREAM_CHUNK];
+    SYSTIME uptime;
+    HANDLE stream, handle, writer;
+    char* ptr;
+    unsigned int i;
+    stream = stream_create(STREAM_SIZE);
+    handle = stream_open(stream);
+    writer = stream_open(stream);
+    if (stream == INVALID_HANDLE || handle == INVALID_HANDLE || writer == INVALID_HANDLE)
+        bench_stream_failed("stream create");
+
+    get_uptime(&uptime);
+    for (i = 0; i < STREAM_OPS; ++i)
+    {
+        if (stream_write_no_block(handle, (char*)__DATA, STREAM_CHUNK) != STREAM_CHUNK)
+            bench_stream_failed("stream copy");
+        stream_read_no_block(handle, buf, STREAM_CHUNK);
+    }
+    print_throughput("stream copy", STREAM_OPS, systime_elapsed_us(&uptime), STREAM_CHUNK);
+
+    get_uptime(&uptime);
+    for (i = 0; i < STREAM_OPS; ++i)
+    {
+        //chunk is stream size divider, so span never wraps
+        if (stream_write_reserve(handle, &ptr) < STREAM_CHUNK)
+            bench_stream_failed("stream zero-copy");
+        stream_write_commit(handle, STREAM_CHUNK);
+        stream_read_consume(handle, stream_read_peek(handle, &ptr));
+    }
+    print_throughput("stream zero-copy", STREAM_OPS, systime_elapsed_us(&uptime), STREAM_CHUNK);
+
+    //copying write and other reserve must not touch reserved span before commit
+    stream_flush(stream);
+    if (stream_write_reserve(handle, &ptr) < STREAM_CHUNK)
+        bench_stream_failed("stream reserve");
+    memset(ptr, 'r', STREAM_CHUNK);
+    error(ERROR_OK);
+    if (stream_write_no_block(writer, (char*)__DATA, STREAM_CHUNK) || get_last_error() != ERROR_IN_PROGRESS)
+        bench_stream_failed("stream write during reserve");
+    if (stream_write(writer, (char*)__DATA, STREAM_CHUNK))
+        bench_stream_failed("stream blocking write during reserve");
+    error(ERROR_OK);
+    if (stream_write_reserve(writer, &ptr) || get_last_error() != ERROR_IN_PROGRESS)
+        bench_stream_failed("stream reserve during reserve");
+    error(ERROR_OK);
+    stream_write_commit(handle, STREAM_CHUNK);
+    if (stream_write_no_block(writer, (char*)__DATA, STREAM_CHUNK) != STREAM_CHUNK)
+        bench_stream_failed("stream write after commit");
+    if (stream_read_no_block(handle, buf, STREAM_CHUNK) != STREAM_CHUNK || buf[0] != 'r' || buf[STREAM_CHUNK - 1] != 'r')
+        bench_stream_failed("stream reserved data");
+    if (stream_read_no_block(handle, buf, STREAM_CHUNK) != STREAM_CHUNK || memcmp(buf, __DATA, STREAM_CHUNK))
+        bench_stream_failed("stream copied data");
+
+    //reservation is lost on flush
+    stream_write_reserve(writer, &ptr);
+    stream_flush(stream);
+    stream_write_commit(writer, STREAM_CHUNK);
+    if (get_last_error() != ERROR_INVALID_STATE || stream_get_size(stream))
+        bench_stream_failed("stream commit after flush");
+
+    stream_close(writer);
+    stream_close(handle);
+    stream_destroy(stream);
+}
+
+static void bench_format()
+{
+    char buf[128];
+    SYSTIME uptime;
+    unsigned int i;
+
+    get_uptime(&uptime);
+    for (i = 0; i < FORMAT_OPS; ++i)
+        sprintf(buf, "%s %d %08X %c %-10s|", "bench", i, i * 2654435761u, 'x', "pad");
+    print_result("sprintf", FORMAT_OPS, systime_elapsed_us(&uptime), 0);
+}
+
+static void bench_checksum()
+{
+    SYSTIME uptime;
+    unsigned int i, sum;
+    sum = 0;
+
+    get_uptime(&uptime);
+    for (i = 0; i < CHECKSUM_OPS; ++i)
+        sum += ip_checksum(__DATA, DATA_SIZE);
+    print_throughput("ip_checksum", CHECKSUM_OPS, systime_elapsed_us(&uptime), DATA_SIZE);
+
+    get_uptime(&uptime);
+    for (i = 0; i < CHECKSUM_OPS; ++i)
+        sum += crc32(__DATA, DATA_SIZE, CRC32_INIT);
+    print_throughput("crc32", CHECKSUM_OPS, systime_elapsed_us(&uptime), DATA_SIZE);
+
+    get_uptime(&uptime);
+    for (i = 0; i < CHECKSUM_OPS; ++i)
+        sum += crc16(__DATA, DATA_SIZE, CRC16_INIT);
+    print_throughput("crc16", CHECKSUM_OPS, systime_elapsed_us(&uptime), DATA_SIZE);
+    __DATA[0] = (uint8_t)sum;
+}
+
+static void bench_crypto()
+{
+    AES_KEY key;
+    SHA1_CTX sha1;
+    SHA256_CTX sha256;
+    uint8_t iv[AES_BLOCK_SIZE];
+    uint8_t hash[SHA256_BLOCK_SIZE];
+    SYSTIME uptime;
+    unsigned int i;
+    //AES CBC is working on whole blocks
+    unsigned int size = DATA_SIZE & ~(AES_BLOCK_SIZE - 1);
+    memset(iv, 0, AES_BLOCK_SIZE);
+    AES_set_encrypt_key(__DATA, 128, &key);
+
+    get_uptime(&uptime);
+    for (i = 0; i < CRYPTO_OPS; ++i)
+        AES_cbc_encrypt(__DATA, __DATA, size, &key, iv, AES_ENCRYPT);
+    print_throughput("aes128 cbc", CRYPTO_OPS, systime_elapsed_us(&uptime), size);
+
+    get_uptime(&uptime);
+    for (i = 0; i < CRYPTO_OPS; ++i)
+    {
+        sha1_init(&sha1);
+        sha1_update(&sha1, __DATA, DATA_SIZE);
+        sha1_final(&sha1, hash);
+    }
+    print_throughput("sha1", CRYPTO_OPS, systime_elapsed_us(&uptime), DATA_SIZE);
+
+    get_uptime(&uptime);
+    for (i = 0; i < CRYPTO_OPS; ++i)
+    {
+        sha256_init(&sha256);
+        sha256_update(&sha256, __DATA, DATA_SIZE);
+        sha256_final(&sha256, hash);
+    }
+    print_throughput("sha256", CRYPTO_OPS, systime_elapsed_us(&uptime), DATA_SIZE);
+}
+
+void bench_echo()
+{
+    IPC ipc;
+    unsigned int batch = 0;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (HAL_ITEM(ipc.cmd))
+        {
+        case BENCH_IPC_PING:
+            ipc_post(&ipc);
+            break;
+        case BENCH_IPC_CALL:
+            ipc_write(&ipc);
+            break;
+        case BENCH_IPC_BATCH:
+            //param2 is batch size. Whole batch is acked at once
+            if (++batch == ipc.param2)
+            {
+                batch = 0;
+                ipc_post(&ipc);
+            }
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+            ipc_write(&ipc);
+        }
+    }
+}
+
+static void bench_ipc_failed(const char* name)
+{
+    host_printf("%s: error %d\n", name, get_last_error());
+    host_exit(1);
+}
+
+static void bench_ipc_call(const char* name, HANDLE echo)
+{
+    SYSTIME uptime;
+    unsigned int i;
+
+    get_uptime(&uptime);
+    for (i = 0; i < IPC_OPS; ++i)
+    {
+        if (get(echo, HAL_REQ(HAL_APP, BENCH_IPC_CALL), i, i, 0) != i)
+            bench_ipc_failed(name);
+    }
+    print_result(name, IPC_OPS, systime_elapsed_us(&uptime), 0);
+}
+
+static void bench_ipc()
+{
+    IPC ipcs[IPC_BATCH];
+    IPC ipc;
+    SYSTIME uptime;
+    HANDLE echo;
+    unsigned int i, j;
+    echo = process_create(&__BENCH_ECHO);
+    if (echo == INVALID_HANDLE)
+        bench_ipc_failed("echo create");
+
+    get_uptime(&uptime);
+    for (i = 0; i < IPC_OPS; ++i)
+    {
+        ipc_post_inline(echo, HAL_CMD(HAL_APP, BENCH_IPC_PING), i, 0, 0);
+        ipc_read(&ipc);
+    }
+    print_result("ipc post/read", IPC_OPS, systime_elapsed_us(&uptime), 0);
+
+    bench_ipc_call("ipc call", echo);
+
+    //same IPC count, one supervisor call and one echo wakeup per IPC
+    get_uptime(&uptime);
+    for (i = 0; i < IPC_OPS / IPC_BATCH; ++i)
+    {
+        for (j = 0; j < IPC_BATCH; ++j)
+            ipc_post_inline(echo, HAL_CMD(HAL_APP, BENCH_IPC_BATCH), j, IPC_BATCH, 0);
+        ipc_read(&ipc);
+    }
+    print_result("ipc post xN", IPC_OPS / IPC_BATCH * IPC_BATCH, systime_elapsed_us(&uptime), 0);
+
+    for (j = 0; j < IPC_BATCH; ++j)
+    {
+        ipcs[j].process = echo;
+        ipcs[j].cmd = HAL_CMD(HAL_APP, BENCH_IPC_BATCH);
+        ipcs[j].param1 = j;
+        ipcs[j].param2 = IPC_BATCH;
+        ipcs[j].param3 = 0;
+    }
+    get_uptime(&uptime);
+    for (i = 0; i < IPC_OPS / IPC_BATCH; ++i)
+    {
+        if (ipc_post_batch(ipcs, IPC_BATCH) != IPC_BATCH)
+            bench_ipc_failed("ipc batch");
+        ipc_read(&ipc);
+    }
+    print_result("ipc batch", IPC_OPS / IPC_BATCH * IPC_BATCH, systime_elapsed_us(&uptime), 0);
+
+    //unrelated IPCs with same cmd hash, as reply, are left on own queue. Reply is found by scan
+    for (i = 0; i < IPC_BACKLOG; ++i)
+        ipc_post_inline(process_get_current(), HAL_CMD(HAL_APP, BENCH_IPC_BACKLOG), i, 0, 0);
+    bench_ipc_call("ipc call backlog", echo);
+    ipc_remove(ANY_HANDLE, HAL_CMD(HAL_APP, BENCH_IPC_BACKLOG), ANY_HANDLE);
+
+    process_destroy(echo);
+}
+
+void app()
+{
+    unsigned int i;
+    for (i = 0; i < DATA_SIZE; ++i)
+        __DATA[i] = (uint8_t)(i * 7);
+
+    host_printf("pool: %s, range checking %s\n", KERNEL_POOL_SEGREGATED ? "segregated" : "linked list",
+                KERNEL_RANGE_CHECKING ? "on" : "off");
+    bench_malloc("malloc mix", MALLOC_OPS, MALLOC_SLOTS, MALLOC_MAX_SIZE);
+    bench_malloc("malloc large", MALLOC_LARGE_OPS, MALLOC_LARGE_SLOTS, MALLOC_LARGE_MAX_SIZE);
+    bench_array();
+    bench_so();
+    bench_rb();
+    bench_stream();
+    bench_format();
+    bench_checksum();
+    bench_crypto();
+    bench_ipc();
+    host_exit(0);
+}
@@ -0,0 +1,49 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//process size. Process pool is placed inside
+#define BENCH_PROCESS_SIZE                          0x100000
+
+//malloc/realloc/free random mix
+#define MALLOC_OPS                                  200000
+#define MALLOC_SLOTS                                256
+#define MALLOC_MAX_SIZE                             256
+//same mix with large blocks, up to top pool class. Slots count must not exceed MALLOC_SLOTS
+#define MALLOC_LARGE_OPS                            20000
+#define MALLOC_LARGE_SLOTS                          16
+#define MALLOC_LARGE_MAX_SIZE                       0x8000
+//array_append, then array_remove from tail
+#define ARRAY_OPS                                   100000
+//so_allocate/so_free churn over live handles window
+#define SO_OPS                                      200000
+#define SO_HANDLES                                  1000
+//ring buffer put/get pairs
+#define RB_OPS                                      1000000
+#define RB_SIZE                                     256
+//stream copying and zero-copy write/read pairs. Chunk must be stream size divider
+#define STREAM_OPS                                  100000
+#define STREAM_SIZE                                 256
+#define STREAM_CHUNK                                64
+//sprintf calls
+#define FORMAT_OPS                                  100000
+//data block for checksum, CRC and crypto
+#define DATA_SIZE                                   1500
+#define CHECKSUM_OPS                                20000
+#define CRYPTO_OPS                                  2000
+//IPC round trips with echo process
+#define ECHO_PROCESS_SIZE                           16384
+#define IPC_OPS                                     100000
+//must fit in echo IPC queue: less than KERNEL_IPC_COUNT
+#define IPC_BATCH                                   32
+//unrelated IPCs on own queue during call. Less than KERNEL_IPC_COUNT - 1
+#define IPC_BACKLOG                                 32
+
+#endif // CONFIG_H
@@ -0,0 +1,289 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+/*
+    tcpip_bench - TCP/IP stack segment processing benchmark on host-native core.
+    Fake ETH driver is feeding synthetic segments from many connections
+*/
+
+#include "userspace/stdio.h"
+#include "userspace/process.h"
+#include "userspace/linux/host.h"
+#include "userspace/ipc.h"
+#include "userspace/systime.h"
+#include "userspace/error.h"
+#include "userspace/tcpip.h"
+#include "userspace/tcp.h"
+#include "userspace/ip.h"
+#include "userspace/arp.h"
+#include "fake_eth.h"
+#include "config.h"
+
+void app();
+
+const REX __APP = {
+    //name
+    "TCP/IP bench",
+    //size
+    APP_PROCESS_SIZE,
+    //priority
+    APP_PROCESS_PRIORITY,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app
+};
+
+static const IP __LOCAL_IP =                        BENCH_LOCAL_IP;
+static const IP __REMOTE_IP =                       BENCH_REMOTE_IP;
+static const MAC __REMOTE_MAC =                     BENCH_REMOTE_MAC;
+
+static void print_result(const char* name, unsigned int ops, unsigned int us)
+{
+    //no 64 bit math
+    unsigned int ns = (us / ops) * 1000 + (us % ops) * 1000 / ops;
+    host_printf("%-16s %8d segments %8dus %6dns/segment\n", name, ops, us, ns);
+}
+
+static void fail(const char* msg)
+{
+    host_printf("%s: error %d\n", msg, get_last_error());
+    host_exit(1);
+}
+
+//wait for fake ETH to inject all frames and for expected count of connection notifications. Returns first notified handle
+static HANDLE wait_done(unsigned int cmd, unsigned int count)
+{
+    IPC ipc;
+    HANDLE handle = INVALID_HANDLE;
+    unsigned int notified = 0;
+    bool done = false;
+    while (!done || notified < count)
+    {
+        ipc_read(&ipc);
+        if (ipc.cmd == HAL_CMD(HAL_APP, FAKE_ETH_DONE))
+            done = true;
+        else if (ipc.cmd == HAL_CMD(HAL_TCP, cmd))
+        {
+            if (notified++ == 0)
+                handle = ipc.param1;
+        }
+    }
+    return handle;
+}
+
+static HANDLE bench_handshake(HANDLE tcpip, HANDLE eth)
+{
+    HANDLE handle;
+    SYSTIME uptime;
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_HANDSHAKE), BENCH_CONNECTIONS, 0, 0);
+    handle = wait_done(IPC_OPEN, BENCH_CONNECTIONS);
+    //SYN and ACK for every connection
+    print_result("handshake", BENCH_CONNECTIONS * 2, systime_elapsed_us(&uptime));
+    return handle;
+}
+
+static void bench_acks(HANDLE tcpip, HANDLE eth)
+{
+    SYSTIME uptime;
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_ACKS), BENCH_SEGMENTS, 0, 0);
+    wait_done(IPC_OPEN, 0);
+    //stack is processing requests in order. Make sure, last injected segment is processed
+    tcpip_get_conn_state(tcpip);
+    print_result("established ack", BENCH_SEGMENTS, systime_elapsed_us(&uptime));
+}
+
+//stream data to remote host with BENCH_BULK_QUEUE writes in flight
+static void bench_bulk(HANDLE tcpip, HANDLE eth, HANDLE handle, unsigned int loss)
+{
+    IO* ios[BENCH_BULK_QUEUE];
+    IO* io;
+    IPC ipc;
+    TCP_STACK* tcp_stack;
+    SYSTIME uptime;
+    unsigned int i, queued, done, us;
+    for (i = 0; i < BENCH_BULK_QUEUE; ++i)
+        if ((ios[i] = io_create(BENCH_BULK_IO_SIZE + sizeof(TCP_STACK))) == NULL)
+            fail("io create");
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_BULK), tcp_get_remote_port(tcpip, handle) - BENCH_REMOTE_PORT_BASE, loss, 0);
+    //make sure fake ETH is in bulk mode before first segment
+    tcpip_get_conn_state(tcpip);
+
+    get_uptime(&uptime);
+    for (queued = done = 0; done < BENCH_BULK_WRITES; )
+    {
+        if (queued < BENCH_BULK_WRITES && queued - done < BENCH_BULK_QUEUE)
+        {
+            io = ios[queued++ % BENCH_BULK_QUEUE];
+            io_reset(io);
+            tcp_stack = io_push(io, sizeof(TCP_STACK));
+            tcp_stack->flags = 0;
+            tcp_stack->urg_len = 0;
+            io->data_size = BENCH_BULK_IO_SIZE;
+            tcp_write(tcpip, handle, io);
+            continue;
+        }
+        ipc_read(&ipc);
+        if (ipc.cmd == HAL_IO_CMD(HAL_TCP, IPC_WRITE))
+        {
+            if ((int)ipc.param3 < 0)
+            {
+                error(ipc.param3);
+                fail("tcp write");
+            }
+            ++done;
+        }
+    }
+    us = systime_elapsed_us(&uptime);
+    //bytes per us is MB/s
+    host_printf("%-16s %8d bytes %8dus %6dMB/s %d lost\n", loss ? "bulk lossy" : "bulk", BENCH_BULK_WRITES * BENCH_BULK_IO_SIZE, us,
+                us ? BENCH_BULK_WRITES * BENCH_BULK_IO_SIZE / us : 0, get(eth, HAL_REQ(HAL_APP, FAKE_ETH_STAT), 0, 0, 0));
+    for (i = 0; i < BENCH_BULK_QUEUE; ++i)
+        io_destroy(ios[i]);
+}
+
+static void print_stream(HANDLE eth, const char* name, unsigned int us)
+{
+    IPC ipc;
+    ipc.process = eth;
+    ipc.cmd = HAL_REQ(HAL_APP, FAKE_ETH_STAT);
+    call(&ipc);
+    host_printf("%-16s %8d bytes %8dus %6dMB/s %d retransmits %d SACKs %d ACKs %d overruns\n", name, BENCH_STREAM_SIZE, us,
+                us ? BENCH_STREAM_SIZE / us : 0, ipc.param2, ipc.param3, get(eth, HAL_REQ(HAL_APP, FAKE_ETH_STREAM_ACKS), 0, 0, 0),
+                get(eth, HAL_REQ(HAL_APP, FAKE_ETH_OVERRUNS), 0, 0, 0));
+}
+
+//receive data from remote host with BENCH_STREAM_QUEUE reads in flight
+static void bench_stream(HANDLE tcpip, HANDLE eth, HANDLE handle, unsigned int reorder)
+{
+    IO* io;
+    IPC ipc;
+    SYSTIME uptime;
+    unsigned int i, received, us;
+    for (i = 0; i < BENCH_STREAM_QUEUE; ++i)
+    {
+        if ((io = io_create(BENCH_STREAM_IO_SIZE + sizeof(TCP_STACK))) == NULL)
+            fail("io create");
+        tcp_read(tcpip, handle, io, BENCH_STREAM_IO_SIZE);
+    }
+
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_STREAM), tcp_get_remote_port(tcpip, handle) - BENCH_REMOTE_PORT_BASE, reorder, BENCH_STREAM_SIZE);
+    for (received = 0; received < BENCH_STREAM_SIZE; )
+    {
+        ipc_read(&ipc);
+        if (ipc.cmd == HAL_IO_CMD(HAL_TCP, IPC_READ))
+        {
+            if ((int)ipc.param3 < 0)
+            {
+                error(ipc.param3);
+                fail("tcp read");
+            }
+            received += ipc.param3;
+            io = (IO*)ipc.param2;
+            if (received + BENCH_STREAM_IO_SIZE * (BENCH_STREAM_QUEUE - 1) < BENCH_STREAM_SIZE)
+                tcp_read(tcpip, handle, io, BENCH_STREAM_IO_SIZE);
+            else
+                io_destroy(io);
+        }
+    }
+    us = systime_elapsed_us(&uptime);
+    print_stream(eth, reorder ? "stream reorder" : "stream", us);
+}
+
+//receive stack frames without copy, BENCH_ZERO_COPY_REQS requests in flight. Connection is not switching back to copy mode
+static void bench_stream_zero_copy(HANDLE tcpip, HANDLE eth, HANDLE handle)
+{
+    IPC ipc;
+    SYSTIME uptime;
+    unsigned int i, received;
+    for (i = 0; i < BENCH_ZERO_COPY_REQS; ++i)
+        tcp_read_frame(tcpip, handle);
+
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_STREAM), tcp_get_remote_port(tcpip, handle) - BENCH_REMOTE_PORT_BASE, 0, BENCH_STREAM_SIZE);
+    for (received = 0; received < BENCH_STREAM_SIZE; )
+    {
+        ipc_read(&ipc);
+        if (ipc.cmd == HAL_CMD(HAL_TCP, TCP_READ_FRAME))
+        {
+            error(ipc.param3);
+            fail("tcp read frame");
+        }
+        if (ipc.cmd == HAL_IO_CMD(HAL_TCP, TCP_READ_FRAME))
+        {
+            received += ipc.param3;
+            tcp_release_frame(tcpip, handle, (IO*)ipc.param2);
+            tcp_read_frame(tcpip, handle);
+        }
+    }
+    print_stream(eth, "stream zero copy", systime_elapsed_us(&uptime));
+}
+
+static void bench_resets(HANDLE tcpip, HANDLE eth)
+{
+    SYSTIME uptime;
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, FAKE_ETH_RESETS), 0, 0, 0);
+    wait_done(IPC_CLOSE, BENCH_CONNECTIONS);
+    print_result("reset", BENCH_CONNECTIONS, systime_elapsed_us(&uptime));
+}
+
+static void print_stats(HANDLE tcpip)
+{
+    TCPIP_STATS stats;
+    if (!tcpip_get_stats(tcpip, &stats))
+        fail("tcpip get stats");
+    host_printf("frames           %8d rx %8d tx %d errors %d starved %d used max %d dropped\n", stats.rx_frames, stats.tx_frames,
+                stats.rx_errors, stats.rx_starved, stats.io_used_max, stats.io_drops);
+    host_printf("tcp segments     %8d rx %8d tx %d retransmits %d fast %d out of window\n", stats.tcp_rx, stats.tcp_tx,
+                stats.tcp_retransmits, stats.tcp_fast_retransmits, stats.tcp_otw_drops);
+    host_printf("tcp acks         %8d tx %8d saved\n", stats.tcp_ack_tx, stats.tcp_ack_saved);
+}
+
+//RTT is estimated per connection, so only while connections are open
+static void print_rtt(HANDLE tcpip)
+{
+    TCPIP_STATS stats;
+    if (!tcpip_get_stats(tcpip, &stats))
+        fail("tcpip get stats");
+    host_printf("rtt              %8d samples, RTT %dus +/- %dus\n", stats.tcp_rtt_samples, stats.tcp_srtt, stats.tcp_rttvar);
+}
+
+void app()
+{
+    HANDLE eth, tcpip, handle;
+    eth = process_create(&__FAKE_ETH);
+    tcpip = tcpip_create(TCPIP_PROCESS_SIZE, TCPIP_PROCESS_PRIORITY, 0);
+    if (eth == INVALID_HANDLE || tcpip == INVALID_HANDLE)
+        fail("process create");
+    if (!tcpip_open(tcpip, eth, 0, ETH_AUTO))
+        fail("tcpip open");
+    ip_set(tcpip, &__LOCAL_IP);
+    if (!arp_add_static(tcpip, &__REMOTE_IP, &__REMOTE_MAC))
+        fail("arp add");
+    if (tcp_listen(tcpip, BENCH_LOCAL_PORT) == INVALID_HANDLE)
+        fail("tcp listen");
+
+    host_printf("%d connections\n", BENCH_CONNECTIONS);
+    handle = bench_handshake(tcpip, eth);
+    bench_acks(tcpip, eth);
+    bench_bulk(tcpip, eth, handle, 0);
+    bench_bulk(tcpip, eth, handle, BENCH_BULK_LOSS);
+    print_rtt(tcpip);
+    bench_stream(tcpip, eth, handle, 0);
+    bench_stream(tcpip, eth, handle, BENCH_STREAM_REORDER);
+    bench_stream_zero_copy(tcpip, eth, handle);
+    bench_resets(tcpip, eth);
+    //same 4-tuples once again, after all TCBs are destroyed
+    bench_handshake(tcpip, eth);
+    print_stats(tcpip);
+    host_exit(0);
+}
@@ -0,0 +1,53 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//process size. Host signal frame is saved on process stack on host core
+#define APP_PROCESS_SIZE                            0x10000
+//listener is receiving notification on every accepted connection, so it must drain IPC queue faster, than stack fills it
+#define APP_PROCESS_PRIORITY                        147
+#define FAKE_ETH_PROCESS_SIZE                       0x10000
+#define FAKE_ETH_PROCESS_PRIORITY                   148
+//all TCBs are allocated from TCP/IP process pool
+#define TCPIP_PROCESS_SIZE                          0x100000
+#define TCPIP_PROCESS_PRIORITY                      149
+
+//max rx frames, queued by stack
+#define FAKE_ETH_RX_MAX                             16
+
+//stack is 10.0.0.1, remote host is 10.0.0.2
+#define BENCH_LOCAL_IP                              {{10, 0, 0, 1}}
+#define BENCH_REMOTE_IP                             {{10, 0, 0, 2}}
+#define BENCH_LOCAL_MAC                             {{0x02, 0x00, 0x00, 0x00, 0x00, 0x01}}
+#define BENCH_REMOTE_MAC                            {{0x02, 0x00, 0x00, 0x00, 0x00, 0x02}}
+#define BENCH_LOCAL_PORT                            80
+//remote port of every connection is base + index
+#define BENCH_REMOTE_PORT_BASE                      1024
+#define BENCH_CONNECTIONS                           1000
+//pure ACK segments, spread over established connections
+#define BENCH_SEGMENTS                              100000
+//data stream on single connection, remote host is acking every segment
+#define BENCH_BULK_IO_SIZE                          4096
+#define BENCH_BULK_WRITES                           4096
+//user writes in flight
+#define BENCH_BULK_QUEUE                            4
+//remote host is dropping every n-th data segment on lossy stream
+#define BENCH_BULK_LOSS                             100
+//data stream from remote host on single connection
+#define BENCH_STREAM_SIZE                           (16 * 1024 * 1024)
+#define BENCH_STREAM_IO_SIZE                        8192
+//user reads in flight. Stack is accepting one read at time
+#define BENCH_STREAM_QUEUE                          1
+//remote host is swapping every n-th segment with next one on reordered stream
+#define BENCH_STREAM_REORDER                        20
+//frame requests in flight on zero copy stream
+#define BENCH_ZERO_COPY_REQS                        4
+
+#endif // CONFIG_H
@@ -0,0 +1,573 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#include "fake_eth.h"
+#include "userspace/eth.h"
+#include "userspace/io.h"
+#include "userspace/ip.h"
+#include "userspace/mac.h"
+#include "userspace/tcp.h"
+#include "userspace/endian.h"
+#include "userspace/error.h"
+#include "config.h"
+#include <string.h>
+
+#define FAKE_ETH_TCP_FLAG_SYN                       (1 << 1)
+#define FAKE_ETH_TCP_FLAG_RST                       (1 << 2)
+#define FAKE_ETH_TCP_FLAG_ACK                       (1 << 4)
+#define FAKE_ETH_TCP_OPTS_SACK_PERMITTED            4
+#define FAKE_ETH_TCP_OPTS_SACK                      5
+#define FAKE_ETH_MSS                                1460
+#define FAKE_ETH_WINDOW                             65535
+#define FAKE_ETH_FRAME_MAX                          (sizeof(MAC_HEADER) + 1500)
+//client ISN of connection. Spaced enough to never overlap
+#define FAKE_ETH_ISN(conn)                          ((conn) << 16)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint8_t ver_ihl;
+    uint8_t tos;
+    uint8_t total_len_be[2];
+    uint8_t id_be[2];
+    uint8_t flags_offset_be[2];
+    uint8_t ttl;
+    uint8_t proto;
+    uint8_t header_crc_be[2];
+    IP src;
+    IP dst;
+} FAKE_ETH_IP_HEADER;
+
+typedef struct {
+    uint8_t src_port_be[2];
+    uint8_t dst_port_be[2];
+    uint8_t seq_be[4];
+    uint8_t ack_be[4];
+    uint8_t data_off;
+    uint8_t flags;
+    uint8_t window_be[2];
+    uint8_t checksum_be[2];
+    uint8_t urgent_pointer_be[2];
+} FAKE_ETH_TCP_HEADER;
+
+typedef struct {
+    MAC_HEADER mac;
+    FAKE_ETH_IP_HEADER ip;
+    FAKE_ETH_TCP_HEADER tcp;
+} FAKE_ETH_FRAME;
+#pragma pack(pop)
+
+typedef enum {
+    FAKE_ETH_MODE_IDLE = 0,
+    FAKE_ETH_MODE_HANDSHAKE,
+    FAKE_ETH_MODE_ACKS,
+    FAKE_ETH_MODE_RESETS,
+    FAKE_ETH_MODE_BULK,
+    FAKE_ETH_MODE_STREAM
+} FAKE_ETH_MODE;
+
+typedef struct {
+    uint16_t conn;
+    uint32_t ack;
+} FAKE_ETH_ACK;
+
+typedef struct {
+    HANDLE tcpip, app;
+    unsigned int eth_handle;
+    //read requests from stack, FIFO
+    IO* rx[FAKE_ETH_RX_MAX];
+    unsigned int rx_head, rx_count;
+    //workload
+    FAKE_ETH_MODE mode;
+    unsigned int conns, segments, syn_sent, ack_sent, injected, seed;
+    //ACKs to send: on SYN-ACK or on received data, FIFO
+    FAKE_ETH_ACK pending[BENCH_CONNECTIONS];
+    unsigned int pending_head, pending_count;
+    uint32_t remote_isn[BENCH_CONNECTIONS];
+    //bulk receiver. Lost segment is making hole [rcv_nxt, hole_end), next segments are buffered up to ooo_end
+    unsigned int bulk_conn, loss, data_segments, lost;
+    uint32_t rcv_nxt, hole_end, ooo_end;
+    bool hole;
+    //stream sender. Every n-th segment is swapped with next one. Go back to snd_una on 3 dup ACKs
+    unsigned int stream_conn, reorder, stream_size, snd_una, snd_nxt, snd_wnd, dup_acks, retransmits, sacks, acks;
+    //frames on line with no rx buffer posted
+    unsigned int overruns;
+    //gathered frame, as it is on line
+    uint8_t wire[FAKE_ETH_FRAME_MAX];
+    uint32_t stream_base;
+    bool swapped;
+} FAKE_ETH;
+
+void fake_eth_main();
+
+const REX __FAKE_ETH = {
+    //name
+    "Fake ETH",
+    //size
+    FAKE_ETH_PROCESS_SIZE,
+    //priority
+    FAKE_ETH_PROCESS_PRIORITY,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    fake_eth_main
+};
+
+static const IP __LOCAL_IP =                        BENCH_LOCAL_IP;
+static const IP __REMOTE_IP =                       BENCH_REMOTE_IP;
+static const MAC __LOCAL_MAC =                      BENCH_LOCAL_MAC;
+static const MAC __REMOTE_MAC =                     BENCH_REMOTE_MAC;
+
+//repeatable from run to run
+static unsigned int fake_eth_rand(FAKE_ETH* eth)
+{
+    eth->seed = eth->seed * 1103515245 + 12345;
+    return eth->seed >> 16;
+}
+
+static void fake_eth_build(IO* io, unsigned int conn, uint32_t seq, uint32_t ack, uint8_t flags, unsigned int len)
+{
+    FAKE_ETH_FRAME* frame = io_data(io);
+    uint8_t* opts = (uint8_t*)io_data(io) + sizeof(FAKE_ETH_FRAME);
+    //SACK permitted, aligned with NOOPs
+    unsigned int opts_size = flags & FAKE_ETH_TCP_FLAG_SYN ? 4 : 0;
+    memset(frame, 0, sizeof(FAKE_ETH_FRAME));
+    memcpy(&frame->mac.dst, &__LOCAL_MAC, sizeof(MAC));
+    memcpy(&frame->mac.src, &__REMOTE_MAC, sizeof(MAC));
+    short2be(frame->mac.lentype_be, ETHERTYPE_IP);
+
+    frame->ip.ver_ihl = 0x45;
+    short2be(frame->ip.total_len_be, sizeof(FAKE_ETH_IP_HEADER) + sizeof(FAKE_ETH_TCP_HEADER) + opts_size + len);
+    short2be(frame->ip.id_be, conn);
+    frame->ip.ttl = 64;
+    frame->ip.proto = PROTO_TCP;
+    frame->ip.src.u32.ip = __REMOTE_IP.u32.ip;
+    frame->ip.dst.u32.ip = __LOCAL_IP.u32.ip;
+    short2be(frame->ip.header_crc_be, ip_checksum(&frame->ip, sizeof(FAKE_ETH_IP_HEADER)));
+
+    short2be(frame->tcp.src_port_be, BENCH_REMOTE_PORT_BASE + conn);
+    short2be(frame->tcp.dst_port_be, BENCH_LOCAL_PORT);
+    int2be(frame->tcp.seq_be, seq);
+    int2be(frame->tcp.ack_be, ack);
+    frame->tcp.data_off = ((sizeof(FAKE_ETH_TCP_HEADER) + opts_size) >> 2) << 4;
+    frame->tcp.flags = flags;
+    short2be(frame->tcp.window_be, FAKE_ETH_WINDOW);
+    if (opts_size)
+    {
+        opts[0] = FAKE_ETH_TCP_OPTS_SACK_PERMITTED;
+        opts[1] = 2;
+        opts[2] = opts[3] = 1;
+    }
+    memset(opts + opts_size, (uint8_t)seq, len);
+    short2be(frame->tcp.checksum_be, tcp_checksum(&frame->tcp, sizeof(FAKE_ETH_TCP_HEADER) + opts_size + len, &__REMOTE_IP, &__LOCAL_IP));
+    io->data_size = sizeof(FAKE_ETH_FRAME) + opts_size + len;
+}
+
+static void fake_eth_queue_ack(FAKE_ETH* eth, unsigned int conn, uint32_t ack)
+{
+    FAKE_ETH_ACK* pending;
+    if (eth->pending_count >= BENCH_CONNECTIONS)
+        return;
+    pending = &eth->pending[(eth->pending_head + eth->pending_count) % BENCH_CONNECTIONS];
+    pending->conn = conn;
+    pending->ack = ack;
+    ++eth->pending_count;
+}
+
+static unsigned int fake_eth_stream_len(FAKE_ETH* eth, unsigned int pos)
+{
+    return eth->stream_size - pos > FAKE_ETH_MSS ? FAKE_ETH_MSS : eth->stream_size - pos;
+}
+
+static bool fake_eth_stream_next(FAKE_ETH* eth, IO* io)
+{
+    unsigned int len, pos;
+    uint32_t base = eth->stream_base;
+    //acknowledge data, received in bulk mode
+    uint32_t ack = eth->stream_conn == eth->bulk_conn ? eth->rcv_nxt : eth->remote_isn[eth->stream_conn] + 1;
+    //second one of swapped pair
+    if (eth->swapped)
+    {
+        len = fake_eth_stream_len(eth, eth->snd_nxt);
+        fake_eth_build(io, eth->stream_conn, base + eth->snd_nxt, ack, FAKE_ETH_TCP_FLAG_ACK, len);
+        eth->snd_nxt += len + fake_eth_stream_len(eth, eth->snd_nxt + len);
+        eth->swapped = false;
+        return true;
+    }
+    if (eth->snd_nxt >= eth->stream_size)
+        return false;
+    len = fake_eth_stream_len(eth, eth->snd_nxt);
+    pos = eth->snd_nxt;
+    //swap only if pair fits window
+    if (eth->reorder && ((eth->snd_nxt / FAKE_ETH_MSS) % eth->reorder) == eth->reorder - 1 && eth->snd_nxt + len < eth->stream_size &&
+        eth->snd_nxt + len + fake_eth_stream_len(eth, eth->snd_nxt + len) - eth->snd_una <= eth->snd_wnd)
+    {
+        pos = eth->snd_nxt + len;
+        len = fake_eth_stream_len(eth, pos);
+    }
+    if (pos + len - eth->snd_una > eth->snd_wnd)
+        return false;
+    fake_eth_build(io, eth->stream_conn, base + pos, ack, FAKE_ETH_TCP_FLAG_ACK, len);
+    if (pos != eth->snd_nxt)
+        eth->swapped = true;
+    else
+        eth->snd_nxt += len;
+    return true;
+}
+
+static bool fake_eth_next_frame(FAKE_ETH* eth, IO* io)
+{
+    unsigned int conn;
+    //answers go first
+    if (eth->pending_count)
+    {
+        conn = eth->pending[eth->pending_head].conn;
+        fake_eth_build(io, conn, FAKE_ETH_ISN(conn) + 1, eth->pending[eth->pending_head].ack, FAKE_ETH_TCP_FLAG_ACK, 0);
+        eth->pending_head = (eth->pending_head + 1) % BENCH_CONNECTIONS;
+        --eth->pending_count;
+        ++eth->ack_sent;
+        return true;
+    }
+    switch (eth->mode)
+    {
+    case FAKE_ETH_MODE_HANDSHAKE:
+        if (eth->syn_sent < eth->conns)
+        {
+            fake_eth_build(io, eth->syn_sent, FAKE_ETH_ISN(eth->syn_sent), 0, FAKE_ETH_TCP_FLAG_SYN, 0);
+            ++eth->syn_sent;
+            return true;
+        }
+        break;
+    case FAKE_ETH_MODE_ACKS:
+        if (eth->injected < eth->segments)
+        {
+            conn = fake_eth_rand(eth) % eth->conns;
+            fake_eth_build(io, conn, FAKE_ETH_ISN(conn) + 1, eth->remote_isn[conn] + 1, FAKE_ETH_TCP_FLAG_ACK, 0);
+            return true;
+        }
+        break;
+    case FAKE_ETH_MODE_STREAM:
+        return fake_eth_stream_next(eth, io);
+    case FAKE_ETH_MODE_RESETS:
+        if (eth->injected < eth->conns)
+        {
+            conn = eth->injected;
+            //RST must be in receive window, after streamed data
+            fake_eth_build(io, conn, conn == eth->stream_conn ? eth->stream_base + eth->stream_size : FAKE_ETH_ISN(conn) + 1, 0, FAKE_ETH_TCP_FLAG_RST, 0);
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+//frame is on line. Real MAC is dropping it, if no rx buffer is posted
+static bool fake_eth_ready(FAKE_ETH* eth)
+{
+    if (eth->pending_count)
+        return true;
+    switch (eth->mode)
+    {
+    case FAKE_ETH_MODE_HANDSHAKE:
+        return eth->syn_sent < eth->conns;
+    case FAKE_ETH_MODE_ACKS:
+        return eth->injected < eth->segments;
+    case FAKE_ETH_MODE_STREAM:
+        return eth->swapped || (eth->snd_nxt < eth->stream_size &&
+                                eth->snd_nxt + fake_eth_stream_len(eth, eth->snd_nxt) - eth->snd_una <= eth->snd_wnd);
+    case FAKE_ETH_MODE_RESETS:
+        return eth->injected < eth->conns;
+    default:
+        return false;
+    }
+}
+
+static void fake_eth_pump(FAKE_ETH* eth)
+{
+    IO* io;
+    if (!eth->rx_count && fake_eth_ready(eth))
+        ++eth->overruns;
+    while (eth->rx_count)
+    {
+        io = eth->rx[eth->rx_head];
+        if (!fake_eth_next_frame(eth, io))
+            break;
+        eth->rx_head = (eth->rx_head + 1) % FAKE_ETH_RX_MAX;
+        --eth->rx_count;
+        ++eth->injected;
+        io_complete(eth->tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), eth->eth_handle, io);
+    }
+    //all frames are in stack
+    if ((eth->mode == FAKE_ETH_MODE_HANDSHAKE && eth->ack_sent == eth->conns) ||
+        (eth->mode == FAKE_ETH_MODE_ACKS && eth->injected == eth->segments) ||
+        (eth->mode == FAKE_ETH_MODE_RESETS && eth->injected == eth->conns))
+    {
+        eth->mode = FAKE_ETH_MODE_IDLE;
+        ipc_post_inline(eth->app, HAL_CMD(HAL_APP, FAKE_ETH_DONE), eth->injected, 0, 0);
+    }
+}
+
+static void fake_eth_rx_data(FAKE_ETH* eth, uint32_t seq, unsigned int len)
+{
+    if (seq == eth->rcv_nxt)
+    {
+        //drop every n-th segment, one hole at time
+        if (eth->loss && !eth->hole && (++eth->data_segments % eth->loss) == 0)
+        {
+            eth->hole = true;
+            eth->hole_end = eth->ooo_end = seq + len;
+            ++eth->lost;
+            return;
+        }
+        eth->rcv_nxt += len;
+        //hole filled, take buffered
+        if (eth->hole && (int32_t)(eth->rcv_nxt - eth->hole_end) >= 0)
+        {
+            if ((int32_t)(eth->ooo_end - eth->rcv_nxt) > 0)
+                eth->rcv_nxt = eth->ooo_end;
+            eth->hole = false;
+        }
+    }
+    else if (eth->hole && seq == eth->ooo_end)
+        eth->ooo_end += len;
+    //ack every segment, dup ack on out of order
+    fake_eth_queue_ack(eth, eth->bulk_conn, eth->rcv_nxt);
+}
+
+static void fake_eth_rx_ack(FAKE_ETH* eth, FAKE_ETH_TCP_HEADER* tcp, unsigned int len)
+{
+    unsigned int i;
+    uint8_t* opts = (uint8_t*)tcp + sizeof(FAKE_ETH_TCP_HEADER);
+    unsigned int ack = be2int(tcp->ack_be) - eth->stream_base;
+    for (i = 0; i + sizeof(FAKE_ETH_TCP_HEADER) < ((tcp->data_off >> 4) << 2) && opts[i]; i += opts[i] == 1 ? 1 : opts[i + 1])
+        if (opts[i] == FAKE_ETH_TCP_OPTS_SACK)
+            ++eth->sacks;
+    if (len == 0)
+        ++eth->acks;
+    eth->snd_wnd = be2short(tcp->window_be);
+    if ((int)(ack - eth->snd_una) > 0)
+    {
+        eth->snd_una = ack;
+        eth->dup_acks = 0;
+        if ((int)(ack - eth->snd_nxt) > 0)
+            eth->snd_nxt = ack;
+    }
+    else if (ack == eth->snd_una && eth->snd_nxt != eth->snd_una && ++eth->dup_acks == 3)
+    {
+        //go back
+        eth->snd_nxt = eth->snd_una;
+        eth->swapped = false;
+        ++eth->retransmits;
+    }
+}
+
+static void fake_eth_rx_response(FAKE_ETH* eth, void* buf, unsigned int size)
+{
+    FAKE_ETH_FRAME* frame = buf;
+    FAKE_ETH_TCP_HEADER* tcp;
+    unsigned int conn, ip_hdr_size, len;
+    if (size < sizeof(FAKE_ETH_FRAME) || be2short(frame->mac.lentype_be) != ETHERTYPE_IP || frame->ip.proto != PROTO_TCP)
+        return;
+    ip_hdr_size = (frame->ip.ver_ihl & 0xf) << 2;
+    tcp = (FAKE_ETH_TCP_HEADER*)((uint8_t*)&frame->ip + ip_hdr_size);
+    //real host is dropping segment with invalid checksum
+    if (ip_checksum(&frame->ip, ip_hdr_size) ||
+        tcp_checksum(tcp, be2short(frame->ip.total_len_be) - ip_hdr_size, &__LOCAL_IP, &__REMOTE_IP))
+        return;
+    conn = be2short(tcp->dst_port_be) - BENCH_REMOTE_PORT_BASE;
+    if (conn >= BENCH_CONNECTIONS)
+        return;
+    if (tcp->flags == (FAKE_ETH_TCP_FLAG_SYN | FAKE_ETH_TCP_FLAG_ACK))
+    {
+        eth->remote_isn[conn] = be2int(tcp->seq_be);
+        fake_eth_queue_ack(eth, conn, eth->remote_isn[conn] + 1);
+        return;
+    }
+    len = be2short(frame->ip.total_len_be) - ip_hdr_size - ((tcp->data_off >> 4) << 2);
+    if (eth->mode == FAKE_ETH_MODE_BULK && conn == eth->bulk_conn && len)
+        fake_eth_rx_data(eth, be2int(tcp->seq_be), len);
+    if (eth->mode == FAKE_ETH_MODE_STREAM && conn == eth->stream_conn && (tcp->flags & FAKE_ETH_TCP_FLAG_ACK))
+        fake_eth_rx_ack(eth, tcp, len);
+}
+
+static inline void fake_eth_read(FAKE_ETH* eth, IO* io)
+{
+    if (eth->rx_count >= FAKE_ETH_RX_MAX)
+    {
+        error(ERROR_TOO_MANY_HANDLES);
+        return;
+    }
+    eth->rx[(eth->rx_head + eth->rx_count) % FAKE_ETH_RX_MAX] = io;
+    ++eth->rx_count;
+    fake_eth_pump(eth);
+    error(ERROR_SYNC);
+}
+
+static inline void fake_eth_write(FAKE_ETH* eth, IPC* ipc)
+{
+    IO* io = (IO*)ipc->param2;
+    ETH_GATHER* gather;
+    if (HAL_ITEM(ipc->cmd) == ETH_WRITE_GATHER)
+    {
+        //like DMA, reading both parts to line
+        gather = io_stack(io);
+        if (io->data_size + gather->size > FAKE_ETH_FRAME_MAX)
+        {
+            error(ERROR_INVALID_PARAMS);
+            return;
+        }
+        memcpy(eth->wire, io_data(io), io->data_size);
+        memcpy(eth->wire + io->data_size, gather->data, gather->size);
+        fake_eth_rx_response(eth, eth->wire, io->data_size + gather->size);
+    }
+    else
+        fake_eth_rx_response(eth, io_data(io), io->data_size);
+    //transmitted immediately
+    io_complete(ipc->process, HAL_IO_CMD(HAL_ETH, IPC_WRITE), ipc->param1, io);
+    fake_eth_pump(eth);
+    error(ERROR_SYNC);
+}
+
+static inline void fake_eth_open(FAKE_ETH* eth, IPC* ipc)
+{
+    eth->tcpip = ipc->process;
+    eth->eth_handle = ipc->param1;
+    //link is up right after open
+    ipc_post_inline(eth->tcpip, HAL_CMD(HAL_ETH, ETH_NOTIFY_LINK_CHANGED), eth->eth_handle, (ETH_CONN_TYPE)ipc->param2 == ETH_AUTO ? ETH_100_FULL : ipc->param2, 0);
+}
+
+static inline void fake_eth_request(FAKE_ETH* eth, IPC* ipc)
+{
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case IPC_OPEN:
+        fake_eth_open(eth, ipc);
+        break;
+    case IPC_CLOSE:
+        eth->tcpip = INVALID_HANDLE;
+        break;
+    case IPC_READ:
+        fake_eth_read(eth, (IO*)ipc->param2);
+        break;
+    case IPC_WRITE:
+    case ETH_WRITE_GATHER:
+        fake_eth_write(eth, ipc);
+        break;
+    case ETH_GET_MAC:
+        ipc->param2 = __LOCAL_MAC.u32.hi;
+        ipc->param3 = __LOCAL_MAC.u32.lo;
+        break;
+    case ETH_GET_HEADER_SIZE:
+        //no special header required
+        ipc->param2 = 0;
+        ipc->param3 = ERROR_OK;
+        break;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+        break;
+    }
+}
+
+static inline void fake_eth_app_request(FAKE_ETH* eth, IPC* ipc)
+{
+    eth->app = ipc->process;
+    eth->injected = 0;
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case FAKE_ETH_HANDSHAKE:
+        eth->conns = ipc->param1 > BENCH_CONNECTIONS ? BENCH_CONNECTIONS : ipc->param1;
+        eth->syn_sent = eth->ack_sent = 0;
+        eth->pending_head = eth->pending_count = 0;
+        eth->mode = FAKE_ETH_MODE_HANDSHAKE;
+        break;
+    case FAKE_ETH_ACKS:
+        eth->segments = ipc->param1;
+        eth->mode = FAKE_ETH_MODE_ACKS;
+        break;
+    case FAKE_ETH_RESETS:
+        eth->mode = FAKE_ETH_MODE_RESETS;
+        break;
+    case FAKE_ETH_BULK:
+        //stream is continued on same connection
+        if (eth->bulk_conn != ipc->param1)
+        {
+            eth->bulk_conn = ipc->param1;
+            eth->rcv_nxt = eth->remote_isn[eth->bulk_conn] + 1;
+        }
+        eth->loss = ipc->param2;
+        eth->data_segments = eth->lost = 0;
+        eth->hole = false;
+        eth->mode = FAKE_ETH_MODE_BULK;
+        break;
+    case FAKE_ETH_STREAM:
+        //stream is continued on same connection
+        if (eth->stream_conn != ipc->param1)
+        {
+            eth->stream_conn = ipc->param1;
+            eth->stream_base = FAKE_ETH_ISN(eth->stream_conn) + 1;
+        }
+        else
+            eth->stream_base += eth->stream_size;
+        eth->reorder = ipc->param2;
+        eth->stream_size = ipc->param3;
+        eth->snd_una = eth->snd_nxt = eth->dup_acks = 0;
+        eth->retransmits = eth->sacks = eth->acks = 0;
+        //initial window, RFC 5681
+        eth->snd_wnd = 2 * FAKE_ETH_MSS;
+        eth->swapped = false;
+        eth->mode = FAKE_ETH_MODE_STREAM;
+        break;
+    case FAKE_ETH_STAT:
+        ipc->param2 = eth->mode == FAKE_ETH_MODE_STREAM ? eth->retransmits : eth->lost;
+        ipc->param3 = eth->sacks;
+        return;
+    case FAKE_ETH_STREAM_ACKS:
+        ipc->param2 = eth->acks;
+        return;
+    case FAKE_ETH_OVERRUNS:
+        ipc->param2 = eth->overruns;
+        return;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+        return;
+    }
+    eth->overruns = 0;
+    fake_eth_pump(eth);
+}
+
+void fake_eth_main()
+{
+    IPC ipc;
+    FAKE_ETH eth;
+    eth.tcpip = eth.app = INVALID_HANDLE;
+    eth.eth_handle = 0;
+    eth.rx_head = eth.rx_count = 0;
+    eth.pending_head = eth.pending_count = 0;
+    eth.mode = FAKE_ETH_MODE_IDLE;
+    eth.conns = eth.segments = eth.overruns = 0;
+    eth.bulk_conn = eth.stream_conn = BENCH_CONNECTIONS;
+    eth.seed = 1;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (HAL_GROUP(ipc.cmd))
+        {
+        case HAL_ETH:
+            fake_eth_request(&eth, &ipc);
+            break;
+        case HAL_APP:
+            fake_eth_app_request(&eth, &ipc);
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+            break;
+        }
+        ipc_write(&ipc);
+    }
+}
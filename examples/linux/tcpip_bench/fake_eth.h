@@ -0,0 +1,42 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef FAKE_ETH_H
+#define FAKE_ETH_H
+
+/*
+    fake_eth - ETH driver emulation. Feeds synthetic segments from remote host to TCP/IP stack
+ */
+
+#include "userspace/process.h"
+#include "userspace/ipc.h"
+
+typedef enum {
+    //param1: connections count. Open connections from remote host
+    FAKE_ETH_HANDSHAKE = IPC_USER,
+    //param1: segments count. Send pure ACK on random established connections
+    FAKE_ETH_ACKS,
+    //reset all established connections
+    FAKE_ETH_RESETS,
+    //param1: connection, param2: drop every n-th data segment or 0. Receive data from stack, ACK every segment
+    FAKE_ETH_BULK,
+    //param1: connection, param2: swap every n-th segment with next or 0, param3: size. Send data to stack
+    FAKE_ETH_STREAM,
+    //return param2: data segments, dropped in bulk receive/retransmits in stream, param3: SACK options received in stream
+    FAKE_ETH_STAT,
+    //return param2: pure ACKs received in stream
+    FAKE_ETH_STREAM_ACKS,
+    //return param2: frames, ready to send with no rx buffer posted by stack in last workload
+    FAKE_ETH_OVERRUNS,
+    //to app, param1: frames injected
+    FAKE_ETH_DONE
+} FAKE_ETH_IPCS;
+
+extern const REX __FAKE_ETH;
+
+#endif // FAKE_ETH_H
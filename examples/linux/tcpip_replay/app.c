@@ -0,0 +1,178 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+/*
+    tcpip_replay - captured traffic replay through TCP/IP stack on host-native core.
+    Frames are injected back-to-back, stack throughput and per-layer receive time are measured.
+    Run with same capture before and after change to catch performance regression
+*/
+
+#include "userspace/stdio.h"
+#include "userspace/process.h"
+#include "userspace/linux/host.h"
+#include "userspace/ipc.h"
+#include "userspace/io.h"
+#include "userspace/systime.h"
+#include "userspace/error.h"
+#include "userspace/tcpip.h"
+#include "userspace/tcp.h"
+#include "userspace/udp.h"
+#include "userspace/ip.h"
+#include "pcap_eth.h"
+#include "config.h"
+
+void app();
+
+const REX __APP = {
+    //name
+    "TCP/IP replay",
+    //size
+    APP_PROCESS_SIZE,
+    //priority
+    APP_PROCESS_PRIORITY,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app
+};
+
+static const IP __LOCAL_IP =                        REPLAY_LOCAL_IP;
+static const unsigned short __TCP_PORTS[] =         REPLAY_TCP_PORTS;
+static const unsigned short __UDP_PORTS[] =         REPLAY_UDP_PORTS;
+
+static void fail(const char* msg)
+{
+    host_printf("%s: error %d\n", msg, get_last_error());
+    host_exit(1);
+}
+
+static unsigned int ns_per_frame(unsigned int frames, unsigned int us)
+{
+    //no 64 bit math
+    return frames ? (us / frames) * 1000 + (us % frames) * 1000 / frames : 0;
+}
+
+//time is inclusive of upper layers, own is without them
+static void print_layer(const char* name, unsigned int frames, unsigned int us, unsigned int own_us)
+{
+    host_printf("%-16s %8d frames %8dus %6dns/frame %8dus own\n", name, frames, us, ns_per_frame(frames, us), own_us);
+}
+
+static void replay_listen(HANDLE tcpip)
+{
+    unsigned int i;
+    HANDLE handle;
+    IO* io;
+    for (i = 0; __TCP_PORTS[i]; ++i)
+    {
+        if (tcp_listen(tcpip, __TCP_PORTS[i]) == INVALID_HANDLE)
+            fail("tcp listen");
+    }
+    for (i = 0; __UDP_PORTS[i]; ++i)
+    {
+        if ((handle = udp_listen(tcpip, __UDP_PORTS[i])) == INVALID_HANDLE)
+            fail("udp listen");
+        if ((io = io_create(REPLAY_READ_SIZE)) == NULL)
+            fail("io create");
+        udp_read_batch(tcpip, handle, io, REPLAY_READ_SIZE);
+    }
+}
+
+//drain all received data, until driver injects whole capture. Returns injected frames
+static unsigned int replay_wait(HANDLE tcpip)
+{
+    IPC ipc;
+    IO* io;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (ipc.cmd)
+        {
+        case HAL_CMD(HAL_APP, PCAP_ETH_DONE):
+            return ipc.param1;
+        case HAL_CMD(HAL_TCP, IPC_OPEN):
+            //accepted connection
+            if (ipc.param2 == INVALID_HANDLE)
+                break;
+            if ((io = io_create(REPLAY_READ_SIZE + sizeof(TCP_STACK))) == NULL)
+                fail("io create");
+            tcp_read(tcpip, ipc.param1, io, REPLAY_READ_SIZE);
+            break;
+        case HAL_IO_CMD(HAL_TCP, IPC_READ):
+            //connection closed or reset
+            if ((int)ipc.param3 < 0)
+                io_destroy((IO*)ipc.param2);
+            else
+                tcp_read(tcpip, ipc.param1, (IO*)ipc.param2, REPLAY_READ_SIZE);
+            break;
+        case HAL_IO_CMD(HAL_UDP, UDP_READ_BATCH):
+            udp_read_batch(tcpip, ipc.param1, (IO*)ipc.param2, REPLAY_READ_SIZE);
+            break;
+        case HAL_CMD(HAL_UDP, UDP_READ_BATCH):
+            //listener closed
+            io_destroy((IO*)ipc.param2);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void print_stats(HANDLE tcpip, HANDLE eth, unsigned int injected, unsigned int us)
+{
+    IPC ipc;
+    TCPIP_STATS stats;
+    if (!tcpip_get_stats(tcpip, &stats))
+        fail("tcpip get stats");
+    ipc.process = eth;
+    ipc.cmd = HAL_REQ(HAL_APP, PCAP_ETH_STAT);
+    call(&ipc);
+
+    host_printf("%-16s %8d frames %8dus %6dns/frame %8dpps\n", "replay", injected, us, ns_per_frame(injected, us),
+                ns_per_frame(injected, us) ? 1000000000 / ns_per_frame(injected, us) : 0);
+    print_layer("mac", stats.rx_frames, stats.rx_us, stats.rx_us - stats.ip_rx_us);
+    print_layer("ip", stats.ip_rx, stats.ip_rx_us, stats.ip_rx_us - stats.tcp_rx_us - stats.udp_rx_us);
+    print_layer("tcp", stats.tcp_rx, stats.tcp_rx_us, stats.tcp_rx_us);
+    print_layer("udp", stats.udp_rx, stats.udp_rx_us, stats.udp_rx_us);
+    host_printf("drops            %d skipped %d mac %d ip header %d ip address %d ip proto %d tcp checksum %d out of window %d starved\n",
+                ipc.param2, stats.mac_drops, stats.ip_header_errors, stats.ip_addr_drops, stats.ip_proto_drops,
+                stats.tcp_checksum_errors, stats.tcp_otw_drops, stats.rx_starved);
+    host_printf("ip assembly      %d assembled %d timeouts %d evictions %d drops %d duplicates\n", stats.ip_assembled,
+                stats.ip_assembly_timeouts, stats.ip_assembly_evictions, stats.ip_assembly_drops, stats.ip_fragment_dups);
+    host_printf("sent             %8d frames %8d tcp segments %d ARP misses\n", ipc.param3, stats.tcp_tx, stats.arp_misses);
+}
+
+void app()
+{
+    HANDLE eth, tcpip;
+    SYSTIME uptime;
+    int frames;
+    unsigned int injected, us;
+    eth = process_create(&__PCAP_ETH);
+    tcpip = tcpip_create(TCPIP_PROCESS_SIZE, TCPIP_PROCESS_PRIORITY, 0);
+    if (eth == INVALID_HANDLE || tcpip == INVALID_HANDLE)
+        fail("process create");
+    if (!tcpip_open(tcpip, eth, 0, ETH_AUTO))
+        fail("tcpip open");
+    ip_set(tcpip, &__LOCAL_IP);
+    if ((frames = get_size(eth, HAL_REQ(HAL_APP, PCAP_ETH_LOAD), 0, 0, 0)) < 0)
+        fail("load "REPLAY_INPUT);
+    replay_listen(tcpip);
+    host_printf("%d frames loaded from %s, %d loops\n", frames, REPLAY_INPUT, REPLAY_LOOPS);
+
+    get_uptime(&uptime);
+    ipc_post_inline(eth, HAL_CMD(HAL_APP, PCAP_ETH_REPLAY), REPLAY_LOOPS, 0, 0);
+    injected = replay_wait(tcpip);
+    //requests are processed in order, last injected frame is already passed stack
+    tcpip_get_conn_state(tcpip);
+    us = systime_elapsed_us(&uptime);
+
+    ack(eth, HAL_REQ(HAL_APP, PCAP_ETH_FLUSH), 0, 0, 0);
+    print_stats(tcpip, eth, injected, us);
+    host_exit(0);
+}
@@ -0,0 +1,48 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//process size. Host signal frame is saved on process stack on host core
+#define APP_PROCESS_SIZE                            0x10000
+//listener is receiving notification on every accepted connection, so it must drain IPC queue faster, than stack fills it
+#define APP_PROCESS_PRIORITY                        147
+#define PCAP_ETH_PROCESS_SIZE                       0x10000
+#define PCAP_ETH_PROCESS_PRIORITY                   148
+//all TCBs are allocated from TCP/IP process pool
+#define TCPIP_PROCESS_SIZE                          0x100000
+#define TCPIP_PROCESS_PRIORITY                      149
+
+//max rx frames, queued by stack
+#define PCAP_ETH_RX_MAX                             16
+//pending ARP replies to stack requests
+#define PCAP_ETH_ARP_MAX                            4
+
+//captured frames to stack, relative to working directory. Ethernet link type only
+#define REPLAY_INPUT                                "replay.pcap"
+//frames, sent by stack. Empty string - don't write
+#define REPLAY_OUTPUT                               "replay_out.pcap"
+//whole capture is loaded before replay
+#define REPLAY_BUFFER_SIZE                          (32 * 1024 * 1024)
+//transmitted frames are buffered and written on buffer full and on end of replay
+#define REPLAY_OUTPUT_BUFFER_SIZE                   (1024 * 1024)
+//capture is replayed few times back-to-back
+#define REPLAY_LOOPS                                1
+
+//stack is configured as captured host. Capture must be taken on this host or filtered for it
+#define REPLAY_LOCAL_IP                             {{10, 0, 0, 1}}
+#define REPLAY_LOCAL_MAC                            {{0x02, 0x00, 0x00, 0x00, 0x00, 0x01}}
+//any host, ARP requested by stack, is answering with this MAC
+#define REPLAY_REMOTE_MAC                           {{0x02, 0x00, 0x00, 0x00, 0x00, 0x02}}
+//ports, listened during replay. Data is read and discarded. Zero terminated
+#define REPLAY_TCP_PORTS                            {80, 0}
+#define REPLAY_UDP_PORTS                            {0}
+#define REPLAY_READ_SIZE                            8192
+
+#endif // CONFIG_H
@@ -0,0 +1,449 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#include "pcap_eth.h"
+#include "userspace/eth.h"
+#include "userspace/io.h"
+#include "userspace/ip.h"
+#include "userspace/mac.h"
+#include "userspace/systime.h"
+#include "userspace/endian.h"
+#include "userspace/error.h"
+#include "config.h"
+#include <string.h>
+
+//from libc. Capture files are on host filesystem
+extern int open(const char* pathname, int flags, ...);
+extern long read(int fd, void* buf, unsigned int count);
+extern long write(int fd, const void* buf, unsigned int count);
+extern int close(int fd);
+
+#define HOST_O_RDONLY                               0x0000
+#define HOST_O_WRONLY_CREAT_TRUNC                   0x0241
+
+#define PCAP_MAGIC                                  0xa1b2c3d4
+#define PCAP_MAGIC_SWAPPED                          0xd4c3b2a1
+#define PCAP_MAGIC_NS                               0xa1b23c4d
+#define PCAP_MAGIC_NS_SWAPPED                       0x4d3cb2a1
+#define PCAP_VERSION_MAJOR                          2
+#define PCAP_VERSION_MINOR                          4
+#define PCAP_SNAPLEN                                65535
+#define PCAP_LINKTYPE_ETHERNET                      1
+
+#define PCAP_ETH_ARP_HRD_ETHERNET                   1
+#define PCAP_ETH_ARP_REQUEST                        1
+#define PCAP_ETH_ARP_REPLY                          2
+#define PCAP_ETH_FRAME_MAX                          (sizeof(MAC_HEADER) + 1500)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+} PCAP_HEADER;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} PCAP_RECORD;
+
+typedef struct {
+    MAC_HEADER mac;
+    uint8_t hrd_be[2];
+    uint8_t pro_be[2];
+    uint8_t hln;
+    uint8_t pln;
+    uint8_t op_be[2];
+    MAC src_mac;
+    IP src_ip;
+    MAC dst_mac;
+    IP dst_ip;
+} PCAP_ETH_ARP_FRAME;
+#pragma pack(pop)
+
+typedef struct {
+    HANDLE tcpip, app;
+    unsigned int eth_handle;
+    //read requests from stack, FIFO
+    IO* rx[PCAP_ETH_RX_MAX];
+    unsigned int rx_head, rx_count;
+    //loaded capture, walked by pos
+    unsigned int size, pos, frames, loops, injected, skipped;
+    bool swapped, replay;
+    //replies to stack ARP requests, FIFO. Injected before next captured frame
+    PCAP_ETH_ARP_FRAME arp[PCAP_ETH_ARP_MAX];
+    unsigned int arp_head, arp_count;
+    //frames, sent by stack
+    int out;
+    unsigned int out_size, sent;
+    //gathered frame, as it is on line
+    uint8_t wire[PCAP_ETH_FRAME_MAX];
+} PCAP_ETH;
+
+void pcap_eth_main();
+
+const REX __PCAP_ETH = {
+    //name
+    "PCAP ETH",
+    //size
+    PCAP_ETH_PROCESS_SIZE,
+    //priority
+    PCAP_ETH_PROCESS_PRIORITY,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    pcap_eth_main
+};
+
+static const MAC __LOCAL_MAC =                      REPLAY_LOCAL_MAC;
+static const MAC __REMOTE_MAC =                     REPLAY_REMOTE_MAC;
+
+//too big for process stack
+static uint8_t __capture[REPLAY_BUFFER_SIZE];
+static uint8_t __output[REPLAY_OUTPUT_BUFFER_SIZE];
+
+//capture is written on host with other byte order
+static uint32_t pcap_eth_u32(PCAP_ETH* eth, uint32_t value)
+{
+    if (!eth->swapped)
+        return value;
+    return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
+
+static void pcap_eth_flush(PCAP_ETH* eth)
+{
+    if (eth->out >= 0 && eth->out_size)
+        write(eth->out, __output, eth->out_size);
+    eth->out_size = 0;
+}
+
+static void pcap_eth_out(PCAP_ETH* eth, void* buf, unsigned int size)
+{
+    PCAP_RECORD* rec;
+    SYSTIME uptime;
+    if (eth->out < 0 || sizeof(PCAP_RECORD) + size > REPLAY_OUTPUT_BUFFER_SIZE)
+        return;
+    if (eth->out_size + sizeof(PCAP_RECORD) + size > REPLAY_OUTPUT_BUFFER_SIZE)
+        pcap_eth_flush(eth);
+    get_uptime(&uptime);
+    rec = (PCAP_RECORD*)(__output + eth->out_size);
+    rec->ts_sec = uptime.sec;
+    rec->ts_usec = uptime.usec;
+    rec->incl_len = rec->orig_len = size;
+    memcpy(rec + 1, buf, size);
+    eth->out_size += sizeof(PCAP_RECORD) + size;
+}
+
+static void pcap_eth_open_output(PCAP_ETH* eth)
+{
+    PCAP_HEADER* hdr = (PCAP_HEADER*)__output;
+    if (eth->out >= 0 || REPLAY_OUTPUT[0] == 0)
+        return;
+    if ((eth->out = open(REPLAY_OUTPUT, HOST_O_WRONLY_CREAT_TRUNC, 0644)) < 0)
+        return;
+    hdr->magic = PCAP_MAGIC;
+    hdr->version_major = PCAP_VERSION_MAJOR;
+    hdr->version_minor = PCAP_VERSION_MINOR;
+    hdr->thiszone = 0;
+    hdr->sigfigs = 0;
+    hdr->snaplen = PCAP_SNAPLEN;
+    hdr->network = PCAP_LINKTYPE_ETHERNET;
+    eth->out_size = sizeof(PCAP_HEADER);
+}
+
+static inline void pcap_eth_load(PCAP_ETH* eth, IPC* ipc)
+{
+    int fd, res;
+    PCAP_HEADER* hdr = (PCAP_HEADER*)__capture;
+    PCAP_RECORD* rec;
+    unsigned int len;
+    if ((fd = open(REPLAY_INPUT, HOST_O_RDONLY)) < 0)
+    {
+        error(ERROR_NOT_FOUND);
+        return;
+    }
+    for (eth->size = 0; eth->size < REPLAY_BUFFER_SIZE; eth->size += res)
+    {
+        if ((res = read(fd, __capture + eth->size, REPLAY_BUFFER_SIZE - eth->size)) <= 0)
+            break;
+    }
+    close(fd);
+
+    if (eth->size < sizeof(PCAP_HEADER))
+    {
+        error(ERROR_INVALID_LENGTH);
+        return;
+    }
+    switch (hdr->magic)
+    {
+    case PCAP_MAGIC:
+    case PCAP_MAGIC_NS:
+        eth->swapped = false;
+        break;
+    case PCAP_MAGIC_SWAPPED:
+    case PCAP_MAGIC_NS_SWAPPED:
+        eth->swapped = true;
+        break;
+    default:
+        error(ERROR_INVALID_MAGIC);
+        return;
+    }
+    if (pcap_eth_u32(eth, hdr->network) != PCAP_LINKTYPE_ETHERNET)
+    {
+        error(ERROR_NOT_SUPPORTED);
+        return;
+    }
+
+    //count frames. Truncated tail record is ignored
+    for (eth->pos = sizeof(PCAP_HEADER), eth->frames = 0; eth->pos + sizeof(PCAP_RECORD) <= eth->size; eth->pos += sizeof(PCAP_RECORD) + len)
+    {
+        rec = (PCAP_RECORD*)(__capture + eth->pos);
+        len = pcap_eth_u32(eth, rec->incl_len);
+        if (len > eth->size - eth->pos - sizeof(PCAP_RECORD))
+            break;
+        ++eth->frames;
+    }
+    eth->size = eth->pos;
+    eth->pos = sizeof(PCAP_HEADER);
+    pcap_eth_open_output(eth);
+    ipc->param3 = eth->frames;
+}
+
+//any host, requested by stack, is on line
+static void pcap_eth_arp_reply(PCAP_ETH* eth, void* buf, unsigned int size)
+{
+    PCAP_ETH_ARP_FRAME* request = buf;
+    PCAP_ETH_ARP_FRAME* reply;
+    if (size < sizeof(PCAP_ETH_ARP_FRAME) || be2short(request->mac.lentype_be) != ETHERTYPE_ARP ||
+        be2short(request->op_be) != PCAP_ETH_ARP_REQUEST || eth->arp_count >= PCAP_ETH_ARP_MAX)
+        return;
+    reply = &eth->arp[(eth->arp_head + eth->arp_count) % PCAP_ETH_ARP_MAX];
+    memcpy(&reply->mac.dst, &request->src_mac, sizeof(MAC));
+    memcpy(&reply->mac.src, &__REMOTE_MAC, sizeof(MAC));
+    short2be(reply->mac.lentype_be, ETHERTYPE_ARP);
+    short2be(reply->hrd_be, PCAP_ETH_ARP_HRD_ETHERNET);
+    short2be(reply->pro_be, ETHERTYPE_IP);
+    reply->hln = sizeof(MAC);
+    reply->pln = sizeof(IP);
+    short2be(reply->op_be, PCAP_ETH_ARP_REPLY);
+    memcpy(&reply->src_mac, &__REMOTE_MAC, sizeof(MAC));
+    reply->src_ip.u32.ip = request->dst_ip.u32.ip;
+    memcpy(&reply->dst_mac, &request->src_mac, sizeof(MAC));
+    reply->dst_ip.u32.ip = request->src_ip.u32.ip;
+    ++eth->arp_count;
+}
+
+static bool pcap_eth_next_frame(PCAP_ETH* eth, IO* io)
+{
+    PCAP_RECORD* rec;
+    unsigned int len;
+    //answers go first
+    if (eth->arp_count)
+    {
+        memcpy(io_data(io), &eth->arp[eth->arp_head], sizeof(PCAP_ETH_ARP_FRAME));
+        io->data_size = sizeof(PCAP_ETH_ARP_FRAME);
+        eth->arp_head = (eth->arp_head + 1) % PCAP_ETH_ARP_MAX;
+        --eth->arp_count;
+        return true;
+    }
+    while (eth->replay)
+    {
+        if (eth->pos >= eth->size)
+        {
+            //all loops are in stack
+            if (--eth->loops == 0)
+            {
+                eth->replay = false;
+                ipc_post_inline(eth->app, HAL_CMD(HAL_APP, PCAP_ETH_DONE), eth->injected, 0, 0);
+                break;
+            }
+            eth->pos = sizeof(PCAP_HEADER);
+        }
+        rec = (PCAP_RECORD*)(__capture + eth->pos);
+        len = pcap_eth_u32(eth, rec->incl_len);
+        eth->pos += sizeof(PCAP_RECORD) + len;
+        //jumbo or truncated by MAC
+        if (len > io_get_free(io))
+        {
+            ++eth->skipped;
+            continue;
+        }
+        memcpy(io_data(io), rec + 1, len);
+        io->data_size = len;
+        ++eth->injected;
+        return true;
+    }
+    return false;
+}
+
+static void pcap_eth_pump(PCAP_ETH* eth)
+{
+    IO* io;
+    while (eth->rx_count)
+    {
+        io = eth->rx[eth->rx_head];
+        if (!pcap_eth_next_frame(eth, io))
+            break;
+        eth->rx_head = (eth->rx_head + 1) % PCAP_ETH_RX_MAX;
+        --eth->rx_count;
+        io_complete(eth->tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), eth->eth_handle, io);
+    }
+}
+
+static inline void pcap_eth_read(PCAP_ETH* eth, IO* io)
+{
+    if (eth->rx_count >= PCAP_ETH_RX_MAX)
+    {
+        error(ERROR_TOO_MANY_HANDLES);
+        return;
+    }
+    eth->rx[(eth->rx_head + eth->rx_count) % PCAP_ETH_RX_MAX] = io;
+    ++eth->rx_count;
+    pcap_eth_pump(eth);
+    error(ERROR_SYNC);
+}
+
+static inline void pcap_eth_write(PCAP_ETH* eth, IPC* ipc)
+{
+    IO* io = (IO*)ipc->param2;
+    ETH_GATHER* gather;
+    if (HAL_ITEM(ipc->cmd) == ETH_WRITE_GATHER)
+    {
+        //like DMA, reading both parts to line
+        gather = io_stack(io);
+        if (io->data_size + gather->size > PCAP_ETH_FRAME_MAX)
+        {
+            error(ERROR_INVALID_PARAMS);
+            return;
+        }
+        memcpy(eth->wire, io_data(io), io->data_size);
+        memcpy(eth->wire + io->data_size, gather->data, gather->size);
+        pcap_eth_out(eth, eth->wire, io->data_size + gather->size);
+    }
+    else
+    {
+        pcap_eth_arp_reply(eth, io_data(io), io->data_size);
+        pcap_eth_out(eth, io_data(io), io->data_size);
+    }
+    ++eth->sent;
+    //transmitted immediately
+    io_complete(ipc->process, HAL_IO_CMD(HAL_ETH, IPC_WRITE), ipc->param1, io);
+    pcap_eth_pump(eth);
+    error(ERROR_SYNC);
+}
+
+static inline void pcap_eth_open(PCAP_ETH* eth, IPC* ipc)
+{
+    eth->tcpip = ipc->process;
+    eth->eth_handle = ipc->param1;
+    //link is up right after open
+    ipc_post_inline(eth->tcpip, HAL_CMD(HAL_ETH, ETH_NOTIFY_LINK_CHANGED), eth->eth_handle, (ETH_CONN_TYPE)ipc->param2 == ETH_AUTO ? ETH_100_FULL : ipc->param2, 0);
+}
+
+static inline void pcap_eth_request(PCAP_ETH* eth, IPC* ipc)
+{
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case IPC_OPEN:
+        pcap_eth_open(eth, ipc);
+        break;
+    case IPC_CLOSE:
+        eth->tcpip = INVALID_HANDLE;
+        break;
+    case IPC_READ:
+        pcap_eth_read(eth, (IO*)ipc->param2);
+        break;
+    case IPC_WRITE:
+    case ETH_WRITE_GATHER:
+        pcap_eth_write(eth, ipc);
+        break;
+    case ETH_GET_MAC:
+        ipc->param2 = __LOCAL_MAC.u32.hi;
+        ipc->param3 = __LOCAL_MAC.u32.lo;
+        break;
+    case ETH_GET_HEADER_SIZE:
+        //no special header required
+        ipc->param2 = 0;
+        ipc->param3 = ERROR_OK;
+        break;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+        break;
+    }
+}
+
+static inline void pcap_eth_app_request(PCAP_ETH* eth, IPC* ipc)
+{
+    eth->app = ipc->process;
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case PCAP_ETH_LOAD:
+        pcap_eth_load(eth, ipc);
+        break;
+    case PCAP_ETH_REPLAY:
+        if (eth->frames == 0)
+        {
+            ipc_post_inline(eth->app, HAL_CMD(HAL_APP, PCAP_ETH_DONE), 0, 0, 0);
+            break;
+        }
+        eth->pos = sizeof(PCAP_HEADER);
+        eth->loops = ipc->param1 ? ipc->param1 : 1;
+        eth->injected = eth->skipped = eth->sent = 0;
+        eth->replay = true;
+        pcap_eth_pump(eth);
+        break;
+    case PCAP_ETH_FLUSH:
+        pcap_eth_flush(eth);
+        break;
+    case PCAP_ETH_STAT:
+        ipc->param2 = eth->skipped;
+        ipc->param3 = eth->sent;
+        break;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+        break;
+    }
+}
+
+void pcap_eth_main()
+{
+    IPC ipc;
+    PCAP_ETH eth;
+    eth.tcpip = eth.app = INVALID_HANDLE;
+    eth.eth_handle = 0;
+    eth.rx_head = eth.rx_count = 0;
+    eth.size = eth.pos = eth.frames = eth.loops = 0;
+    eth.injected = eth.skipped = eth.sent = 0;
+    eth.swapped = eth.replay = false;
+    eth.arp_head = eth.arp_count = 0;
+    eth.out = -1;
+    eth.out_size = 0;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (HAL_GROUP(ipc.cmd))
+        {
+        case HAL_ETH:
+            pcap_eth_request(&eth, &ipc);
+            break;
+        case HAL_APP:
+            pcap_eth_app_request(&eth, &ipc);
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+            break;
+        }
+        ipc_write(&ipc);
+    }
+}
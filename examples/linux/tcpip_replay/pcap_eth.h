@@ -0,0 +1,35 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef PCAP_ETH_H
+#define PCAP_ETH_H
+
+/*
+    pcap_eth - ETH driver emulation. Feeds frames from pcap capture to TCP/IP stack as fast, as stack is posting
+    receive buffers. Frames, sent by stack, are written to output pcap
+ */
+
+#include "userspace/process.h"
+#include "userspace/ipc.h"
+
+typedef enum {
+    //load input capture. Return param3: frames count or error
+    PCAP_ETH_LOAD = IPC_USER,
+    //param1: loops. Inject all captured frames to stack
+    PCAP_ETH_REPLAY,
+    //write buffered frames to output capture
+    PCAP_ETH_FLUSH,
+    //return param2: frames, skipped as not fitting in stack buffer. param3: frames, sent by stack
+    PCAP_ETH_STAT,
+    //to app, param1: frames injected
+    PCAP_ETH_DONE
+} PCAP_ETH_IPCS;
+
+extern const REX __PCAP_ETH;
+
+#endif // PCAP_ETH_H
@@ -0,0 +1,113 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef SYS_CONFIG_H
+#define SYS_CONFIG_H
+
+/*
+    config.h - userspace config
+ */
+
+//----------------------------- objects ----------------------------------------------
+//make sure, you know what are you doing, before change
+#define SYS_OBJ_STDOUT                                      0
+#define SYS_OBJ_CORE                                        1
+
+#define SYS_OBJ_ADC                                         INVALID_HANDLE
+#define SYS_OBJ_DAC                                         INVALID_HANDLE
+#define SYS_OBJ_STDIN                                       INVALID_HANDLE
+#define SYS_OBJ_ETH                                         INVALID_HANDLE
+//--------------------------------- ETH ----------------------------------------------
+#define ETH_AUTO_NEGOTIATION_TIME                           5000
+
+#define ETH_DOUBLE_BUFFERING                                1
+//------------------------------- TCP/IP ---------------------------------------------
+#define TCPIP_DEBUG                                         0
+#define TCPIP_DEBUG_ERRORS                                  0
+
+#define TCPIP_MTU                                           1500
+#define TCPIP_MAX_FRAMES_COUNT                              20
+//receive frames, posted to ETH driver. Must not exceed driver buffers: 2 with ETH_DOUBLE_BUFFERING, 1 otherwise
+#define TCPIP_RX_FRAMES                                     8
+//transmit frames, handed to ETH driver at once. Must not exceed driver buffers, same as receive
+#define TCPIP_TX_FRAMES                                     4
+//transmit TCP data by reference to user write IO, only headers are built. ETH driver must support ETH_WRITE_GATHER
+#define TCPIP_TX_GATHER                                     1
+//time receive path per layer, reported by tcpip_get_stats. Takes uptime few times per frame
+#define TCPIP_PROFILE                                       1
+
+//----------------------------- TCP/IP MAC --------------------------------------------
+//software MAC filter. Turn on in case of hardware is not supporting
+#define MAC_FILTER                                          0
+#define MAC_FIREWALL                                        0
+#define TCPIP_MAC_DEBUG                                     0
+
+//----------------------------- TCP/IP ARP --------------------------------------------
+#define ARP_DEBUG                                           0
+#define ARP_DEBUG_FLOW                                      0
+
+#define ARP_CACHE_SIZE_MAX                                  10
+//in seconds
+#define ARP_CACHE_INCOMPLETE_TIMEOUT                        5
+#define ARP_CACHE_TIMEOUT                                   600
+
+//----------------------------- TCP/IP IP ---------------------------------------------
+#define IP_DEBUG                                            0
+#define IP_DEBUG_FLOW                                       0
+
+//set, if not supported by hardware
+#define IP_CHECKSUM                                         1
+
+#define IP_FRAGMENTATION                                    1
+#define IP_FRAGMENTATION_ASSEMBLY_TIMEOUT                   10
+//must be less TCPIP_MTU * TCPIP_MAX_FRAMES_COUNT
+#define IP_MAX_LONG_SIZE                                    5000
+#define IP_MAX_LONG_PACKETS                                 2
+
+#define IP_FIREWALL                                         0
+
+//---------------------------- TCP/IP ICMP --------------------------------------------
+#define ICMP                                                1
+#define ICMP_DEBUG                                          0
+
+#define ICMP_ECHO_TIMEOUT                                   5
+//reply on ICMP echo and echo request
+#define ICMP_ECHO                                           1
+
+//----------------------------- TCP/IP UDP --------------------------------------------
+#define UDP                                                 1
+//local port lookup buckets. Must be power of 2
+#define UDP_HASH_SIZE                                       8
+#define UDP_DEBUG                                           0
+#define UDP_DEBUG_FLOW                                      0
+
+//----------------------------- TCP/IP TCP --------------------------------------------
+#define TCP_DEBUG                                           0
+//retransmissions before connection is dropped. Retransmission timeout is doubled each time
+#define TCP_RETRY_COUNT                                     8
+#define TCP_KEEP_ALIVE                                      0
+//closing states and keep-alive timeout, ms
+#define TCP_TIMEOUT                                         30000
+//RFC 6298 retransmission timeout bounds, ms
+#define TCP_RTO_MIN                                         200
+#define TCP_RTO_MAX                                         60000
+//0 - don't limit
+#define TCP_HANDLES_LIMIT                                   1024
+//connection and listener lookup buckets. Must be power of 2
+#define TCP_HASH_SIZE                                       256
+//out of order segments, queued per connection until gap is filled and reported with SACK. 0 - disable
+#define TCP_OOO_MAX                                         4
+//delay pure ACK until second full segment or timeout, ms. 0 - ACK every segment
+#define TCP_DELAYED_ACK_MS                                  200
+//frames, held by zero copy receive connection: queued and passed to user. Must fit 16 bit window. 0 - disable
+#define TCP_ZERO_COPY_FRAMES                                8
+//Low-level debug. only for development
+#define TCP_DEBUG_FLOW                                      0
+#define TCP_DEBUG_PACKETS                                   0
+
+#endif // SYS_CONFIG_H
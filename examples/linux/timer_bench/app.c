@@ -0,0 +1,98 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+/*
+    timer_bench - kernel timers queue benchmark on host-native core
+*/
+
+#include "userspace/stdio.h"
+#include "userspace/process.h"
+#include "userspace/linux/host.h"
+#include "userspace/ipc.h"
+#include "userspace/systime.h"
+#include "userspace/error.h"
+#include "config.h"
+
+void app();
+
+const REX __APP = {
+    //name
+    "Timer bench",
+    //size. Host signal frame is saved on process stack on host core
+    16384,
+    //priority
+    200,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app
+};
+
+static HANDLE __TIMERS[TIMERS_COUNT];
+
+static void print_result(const char* name, unsigned int us)
+{
+    host_printf("%s: %d timers in %dus, %d.%02dus per timer\n", name, TIMERS_COUNT, us, us / TIMERS_COUNT, (us * 100 / TIMERS_COUNT) % 100);
+}
+
+static void bench_start_stop()
+{
+    int i;
+    SYSTIME uptime;
+    unsigned int diff;
+
+    get_uptime(&uptime);
+    for (i = 0; i < TIMERS_COUNT; ++i)
+        timer_start_us(__TIMERS[i], TIMER_IDLE_TIMEOUT_US + ((i * TIMER_SHUFFLE) % TIMERS_COUNT) * (TIMER_IDLE_TIMEOUT_US / TIMERS_COUNT));
+    diff = systime_elapsed_us(&uptime);
+    print_result("start", diff);
+
+    //stop in order, different from start
+    get_uptime(&uptime);
+    for (i = 0; i < TIMERS_COUNT; ++i)
+        timer_stop(__TIMERS[(i * TIMER_SHUFFLE) % TIMERS_COUNT], (i * TIMER_SHUFFLE) % TIMERS_COUNT, HAL_APP);
+    diff = systime_elapsed_us(&uptime);
+    print_result("stop", diff);
+}
+
+static void bench_shoot()
+{
+    int i;
+    IPC ipc;
+    SYSTIME uptime;
+    unsigned int diff;
+
+    get_uptime(&uptime);
+    for (i = 0; i < TIMERS_COUNT; ++i)
+        timer_start_us(__TIMERS[i], ((i * TIMER_SHUFFLE) % TIMERS_COUNT) * (TIMER_SHOOT_RANGE_US / TIMERS_COUNT) + 1);
+    for (i = 0; i < TIMERS_COUNT; ++i)
+        ipc_read_ex(&ipc, KERNEL_HANDLE, HAL_CMD(HAL_APP, IPC_TIMEOUT), ANY_HANDLE);
+    diff = systime_elapsed_us(&uptime);
+    host_printf("shoot: %d timers in %dus (range %dus)\n", TIMERS_COUNT, diff, TIMER_SHOOT_RANGE_US);
+}
+
+void app()
+{
+    int i;
+    for (i = 0; i < TIMERS_COUNT; ++i)
+    {
+        __TIMERS[i] = timer_create(i, HAL_APP);
+        if (__TIMERS[i] == INVALID_HANDLE)
+        {
+            host_printf("timer create failed on %d, increase SRAM_SIZE\n", i);
+            host_exit(1);
+        }
+    }
+
+    bench_start_stop();
+    bench_shoot();
+
+    for (i = 0; i < TIMERS_COUNT; ++i)
+        timer_destroy(__TIMERS[i]);
+    host_exit(0);
+}
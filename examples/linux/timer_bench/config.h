@@ -0,0 +1,20 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define TIMERS_COUNT                                10000
+//far enough, so no timer will fire during start/stop test
+#define TIMER_IDLE_TIMEOUT_US                       10000000
+//all timers will fire in this range during shoot test
+#define TIMER_SHOOT_RANGE_US                        100000
+//prime, coprime with TIMERS_COUNT. Used to shuffle timers order
+#define TIMER_SHUFFLE                               7919
+
+#endif // CONFIG_H
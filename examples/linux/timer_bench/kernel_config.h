@@ -0,0 +1,48 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef KERNEL_CONFIG_H
+#define KERNEL_CONFIG_H
+
+//----------------------------------- kernel ------------------------------------------------------------------
+//enable kernel info. Disabling this you can save some flash size, but kernel will be much less verbose, especially on critical errors. Generally doesn't affect on perfomance
+#define KERNEL_DEBUG                                1
+//marks objects with magic in headers. Decrease perfomance on few tacts, but very useful for debug if you don't have MPU enabled
+#define KERNEL_MARKS                                0
+//check range of dynamic objects in pools
+#define KERNEL_RANGE_CHECKING                       0
+//segregated fit pools: O(1) malloc/free for cost of 52 bytes per pool and 4 bytes more per slot
+#define KERNEL_POOL_SEGREGATED                      0
+//shrink dynamic arrays storage, when less than quarter is used. Saves pool space for cost of few reallocs on remove
+#define KERNEL_ARRAY_SHRINK                         0
+//check kernel handles. Require few tacts, but making kernel calls much safer
+#define KERNEL_HANDLE_CHECKING                      1
+//check user adresses. Require few tacts, but making kernel calls much safer
+#define KERNEL_ADDRESS_CHECKING                     0
+//some kernel statistics (stack, mem, etc). Decrease perfomance in any object creation.
+#define KERNEL_PROFILING                            1
+//Enabling this you will get stats on each thread uptime, but decreasing context switching up to 2 times
+#define KERNEL_PROCESS_STAT                         1
+//Kernel halt on fatal error, disable power save mode
+//Don't forget to turn off in production.
+#define KERNEL_DEVELOPER_MODE                       1
+//enable this only if you have problems with system timer. May decrease perfomance
+#define KERNEL_TIMER_DEBUG                          0
+//size of IPC queue per process. All bench timers can fire at once
+#define KERNEL_IPC_COUNT                            10001
+//enable this only if you have problems with IPC oferflow.
+#define KERNEL_IPC_DEBUG                            1
+//Allows to debug critical kernel errors, but decreases perfomance
+#define KERNEL_SVC_DEBUG                            0
+//maximum number of global handles. Must be at least 1
+#define KERNEL_OBJECTS_COUNT                        5
+//enable multi-process safe dynamic heap. Required for most of high-level stacks (BLE, TCP/IP, etc)
+//disable to save few bytes
+#define KERNEL_HEAP                                 1
+
+#endif // KERNEL_CONFIG_H
@@ -36,7 +36,8 @@
 #define ETH_COL                                     A3
 #define ETH_CRS_WKUP                                A0
 
-#define TCPIP_PROCESS_SIZE                          1200
+//stack and heap. ARP cache, route and reassembly tables are allocated on heap, sized by sys_config
+#define TCPIP_PROCESS_SIZE                          1800
 #define TCPIP_PROCESS_PRIORITY                      149
 
 #define DBG_CONSOLE                                 UART_2
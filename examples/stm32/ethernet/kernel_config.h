@@ -16,6 +16,10 @@
 #define KERNEL_MARKS                                0
 //check range of dynamic objects in pools
 #define KERNEL_RANGE_CHECKING                       0
+//segregated fit pools: O(1) malloc/free for cost of 52 bytes per pool and 4 bytes more per slot
+#define KERNEL_POOL_SEGREGATED                      0
+//shrink dynamic arrays storage, when less than quarter is used. Saves pool space for cost of few reallocs on remove
+#define KERNEL_ARRAY_SHRINK                         0
 //check kernel handles. Require few tacts, but making kernel calls much safer
 #define KERNEL_HANDLE_CHECKING                      1
 //check user adresses. Require few tacts, but making kernel calls much safer
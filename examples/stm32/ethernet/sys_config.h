@@ -136,6 +136,14 @@
 
 #define TCPIP_MTU                                           1500
 #define TCPIP_MAX_FRAMES_COUNT                              10
+//receive frames, posted to ETH driver. Must not exceed driver buffers: 2 with ETH_DOUBLE_BUFFERING, 1 otherwise
+#define TCPIP_RX_FRAMES                                     2
+//transmit frames, handed to ETH driver at once. Must not exceed driver buffers, same as receive
+#define TCPIP_TX_FRAMES                                     2
+//transmit TCP data by reference to user write IO, only headers are built. ETH driver must support ETH_WRITE_GATHER
+#define TCPIP_TX_GATHER                                     1
+//time receive path per layer, reported by tcpip_get_stats. Takes uptime few times per frame
+#define TCPIP_PROFILE                                       0
 
 //----------------------------- TCP/IP MAC --------------------------------------------
 //software MAC filter. Turn on in case of hardware is not supporting
@@ -177,6 +185,8 @@
 
 //----------------------------- TCP/IP UDP --------------------------------------------
 #define UDP                                                 0
+//local port lookup buckets. Must be power of 2
+#define UDP_HASH_SIZE                                       8
 //required for DHCP
 #define UDP_BROADCAST                                       1
 #define DNSS                                                0
@@ -190,11 +200,24 @@
 
 //----------------------------- TCP/IP TCP --------------------------------------------
 #define TCP_DEBUG                                           1
-#define TCP_RETRY_COUNT                                     3
+//retransmissions before connection is dropped. Retransmission timeout is doubled each time
+#define TCP_RETRY_COUNT                                     8
 #define TCP_KEEP_ALIVE                                      0
+//closing states and keep-alive timeout, ms
 #define TCP_TIMEOUT                                         30000
+//RFC 6298 retransmission timeout bounds, ms
+#define TCP_RTO_MIN                                         200
+#define TCP_RTO_MAX                                         60000
 //0 - don't limit
 #define TCP_HANDLES_LIMIT                                   10
+//connection and listener lookup buckets. Must be power of 2
+#define TCP_HASH_SIZE                                       8
+//out of order segments, queued per connection until gap is filled and reported with SACK. 0 - disable
+#define TCP_OOO_MAX                                         2
+//delay pure ACK until second full segment or timeout, ms. 0 - ACK every segment
+#define TCP_DELAYED_ACK_MS                                  200
+//frames, held by zero copy receive connection: queued and passed to user. Must fit 16 bit window. 0 - disable
+#define TCP_ZERO_COPY_FRAMES                                0
 //Low-level debug. only for development
 #define TCP_DEBUG_FLOW                                      0
 #define TCP_DEBUG_PACKETS                                   0
@@ -212,7 +235,9 @@
 //Each session internal IO size. Smaller may require more often requests
 //to TCP/IP stack, bigger consumes more memory. Default to MSS.
 #define WEBS_IO_SIZE                                        1460
-//Maximum request size. If request is bigger, it will be responded with "payload too large"
+//Request line and headers buffer, allocated once per session
+#define WEBS_HEADER_SIZE                                    1024
+//Maximum request body size. Body is streamed to handler. If request is bigger, it will be responded with "payload too large"
 #define WEBS_MAX_PAYLOAD                                    8192
 
 //---------------------------- TLS server---------------------------------------------
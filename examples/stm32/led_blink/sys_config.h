@@ -190,9 +190,14 @@
 
 //----------------------------- TCP/IP TCP --------------------------------------------
 #define TCP_DEBUG                                           1
-#define TCP_RETRY_COUNT                                     3
+//retransmissions before connection is dropped. Retransmission timeout is doubled each time
+#define TCP_RETRY_COUNT                                     8
 #define TCP_KEEP_ALIVE                                      0
+//closing states and keep-alive timeout, ms
 #define TCP_TIMEOUT                                         30000
+//RFC 6298 retransmission timeout bounds, ms
+#define TCP_RTO_MIN                                         200
+#define TCP_RTO_MAX                                         60000
 //0 - don't limit
 #define TCP_HANDLES_LIMIT                                   10
 //Low-level debug. only for development
@@ -212,7 +217,9 @@
 //Each session internal IO size. Smaller may require more often requests
 //to TCP/IP stack, bigger consumes more memory. Default to MSS.
 #define WEBS_IO_SIZE                                        1460
-//Maximum request size. If request is bigger, it will be responded with "payload too large"
+//Request line and headers buffer, allocated once per session
+#define WEBS_HEADER_SIZE                                    1024
+//Maximum request body size. Body is streamed to handler. If request is bigger, it will be responded with "payload too large"
 #define WEBS_MAX_PAYLOAD                                    8192
 
 //---------------------------- TLS server---------------------------------------------
@@ -0,0 +1,361 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+/*
+    klinux.c - host-native core
+
+    Everything is running on single host thread:
+    - kernel context is running on top of SRAM, like MSP on cortex-m
+    - every process has own context, saved on top of process stack. Only callee-saved registers are
+      switched, signal mask is untouched, so context switch is not making host syscall
+    - svc_call switches to kernel context. Kernel executes call and switches to next active process
+    - host signals are IRQs. In supervisor context they are latched to soft NVIC and dispatched by kernel
+      or on return to process. In process context they are dispatched right from signal handler, like
+      exception on other cores. If IRQ wakes higher priority process, interrupted process is preempted from
+      handler and later resumed there. Signal frame is on process stack, so process stack must have room
+      for it: few KB, depending on host FPU state
+    - HPET and second pulse are emulated by single host interval timer
+*/
+
+#include "klinux.h"
+#include "kernel_config.h"
+#include "../kernel.h"
+#include "../kprocess.h"
+#include "../kirq.h"
+#include "../ksystime.h"
+#include "../dbg.h"
+#include <string.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#define SECOND_US                                   1000000ull
+
+//from libc. unistd.h is not included because of userspace names conflict
+extern long write(int fd, const void* buf, unsigned int count);
+extern void _exit(int status);
+
+//from kprocess.c. On other cores placed in LR on process startup
+extern void kprocess_abnormal_exit();
+
+typedef struct {
+    unsigned int num, param1, param2, param3;
+} SVC_FRAME;
+
+typedef struct {
+    unsigned int* kernel_sp;
+    SVC_FRAME svc_frame;
+    //set, when process is entering kernel. Signal handler is only latching IRQ in supervisor context
+    volatile bool supervisor;
+    //process was switched to kernel from IRQ, not by supervisor call
+    bool preempted;
+    bool switch_pending;
+    //soft NVIC
+    volatile unsigned int irq_pending;
+    sigset_t irq_sigset;
+    //HPET emulation
+    unsigned long long hpet_start, hpet_value, second_next;
+    bool hpet_active;
+} CORE;
+
+static CORE __CORE;
+
+//i386 SysV. Saves callee-saved registers on current stack and stack pointer to sp_from. Restores them from sp_to
+void context_switch(unsigned int** sp_from, unsigned int* sp_to);
+
+__ASM (
+    ".text\n"
+    ".type context_switch, @function\n"
+    "context_switch:\n"
+    "    movl 4(%esp), %eax\n"
+    "    movl 8(%esp), %edx\n"
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    movl %esp, (%eax)\n"
+    "    movl %edx, %esp\n"
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    ret\n"
+);
+
+//stack frame for first context_switch to fn(param)
+static unsigned int* context_init(void* stack_top, void (*fn)(unsigned int), unsigned int param)
+{
+    //edi, esi, ebx, ebp, fn, return address, param. param is 16 bytes aligned, as after call
+    unsigned int* sp = (unsigned int*)(((unsigned int)stack_top & ~0xf) - 10 * sizeof(unsigned int));
+    memset(sp, 0, 4 * sizeof(unsigned int));
+    sp[4] = (unsigned int)fn;
+    //fn is never returning
+    sp[5] = 0;
+    sp[6] = param;
+    return sp;
+}
+
+static unsigned long long host_time_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long long)tv.tv_sec * SECOND_US + tv.tv_usec;
+}
+
+static void host_stdout(const char *const buf, unsigned int size, void* param)
+{
+    write(1, buf, size);
+}
+
+void fatal()
+{
+    _exit(1);
+}
+
+/*********************** HPET *********************/
+
+static void hpet_arm()
+{
+    struct itimerval it;
+    unsigned long long now, deadline;
+    deadline = __CORE.second_next;
+    if (__CORE.hpet_active && __CORE.hpet_start + __CORE.hpet_value < deadline)
+        deadline = __CORE.hpet_start + __CORE.hpet_value;
+    now = host_time_us();
+    //already expired, fire as soon as possible
+    deadline = deadline > now ? deadline - now : 1;
+    it.it_interval.tv_sec = it.it_interval.tv_usec = 0;
+    it.it_value.tv_sec = deadline / SECOND_US;
+    it.it_value.tv_usec = deadline % SECOND_US;
+    setitimer(ITIMER_REAL, &it, NULL);
+}
+
+static void hpet_start(unsigned int value, void* param)
+{
+    __CORE.hpet_start = host_time_us();
+    __CORE.hpet_value = value;
+    __CORE.hpet_active = true;
+    hpet_arm();
+}
+
+static void hpet_stop(void* param)
+{
+    __CORE.hpet_active = false;
+}
+
+static unsigned int hpet_elapsed(void* param)
+{
+    return (unsigned int)(host_time_us() - __CORE.hpet_start);
+}
+
+static const CB_SVC_TIMER __HPET = {
+    hpet_start,
+    hpet_stop,
+    hpet_elapsed
+};
+
+static void hpet_isr(int vector, void* param)
+{
+    unsigned long long now = host_time_us();
+    //if host was suspended, second pulses will follow one by one, until uptime catch host time
+    if (now >= __CORE.second_next)
+    {
+        __CORE.second_next += SECOND_US;
+        ksystime_second_pulse();
+    }
+    else if (__CORE.hpet_active && now >= __CORE.hpet_start + __CORE.hpet_value)
+    {
+        __CORE.hpet_active = false;
+        ksystime_hpet_timeout();
+    }
+    hpet_arm();
+}
+
+/*********************** soft NVIC *********************/
+
+static void irq_dispatch()
+{
+    unsigned int pending;
+    int vector;
+    while ((pending = __atomic_exchange_n(&__CORE.irq_pending, 0, __ATOMIC_SEQ_CST)) != 0)
+    {
+        for (vector = 0; pending; ++vector, pending >>= 1)
+            if (pending & 1)
+                kirq_enter(vector);
+    }
+}
+
+//return from supervisor to process context. IRQs, latched meanwhile, are dispatched here, as on exception exit
+static void process_resume()
+{
+    KPROCESS* kprocess;
+    for (;;)
+    {
+        __CORE.supervisor = false;
+        __ASM volatile ("" : : : "memory");
+        if (__CORE.irq_pending == 0)
+            return;
+        __CORE.supervisor = true;
+        __ASM volatile ("" : : : "memory");
+        irq_dispatch();
+        if (__CORE.switch_pending)
+        {
+            //preempt, same as PendSV on other cores. Kernel will resume process right here
+            __CORE.preempted = true;
+            kprocess = (KPROCESS*)__KERNEL->active_process;
+            context_switch(&kprocess->sp, __CORE.kernel_sp);
+        }
+    }
+}
+
+static void on_signal(int signo)
+{
+    int vector = (signo == SIGALRM) ? HPET_IRQn : signo - SIGRTMIN;
+    __atomic_or_fetch(&__CORE.irq_pending, 1 << vector, __ATOMIC_SEQ_CST);
+    //kernel will dispatch it before return to process
+    if (__CORE.supervisor)
+        return;
+    //process is interrupted. Dispatch on process stack
+    process_resume();
+}
+
+static void halt_core()
+{
+    sigset_t saved;
+    sigprocmask(SIG_BLOCK, &__CORE.irq_sigset, &saved);
+    if (__CORE.irq_pending == 0)
+        sigsuspend(&saved);
+    sigprocmask(SIG_SETMASK, &saved, NULL);
+}
+
+static void irq_init()
+{
+    int i;
+    struct sigaction sa;
+    sigemptyset(&__CORE.irq_sigset);
+    sigaddset(&__CORE.irq_sigset, SIGALRM);
+    for (i = USER_IRQn; i < IRQ_VECTORS_COUNT; ++i)
+        sigaddset(&__CORE.irq_sigset, SIGRTMIN + i);
+
+    //Signal frame is on interrupted stack, so preempted handler is resumed with process.
+    //Signals are not masked in handler: handler may be switched out and nested signal in supervisor context is just latched
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_NODEFER | SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+    for (i = USER_IRQn; i < IRQ_VECTORS_COUNT; ++i)
+        sigaction(SIGRTMIN + i, &sa, NULL);
+}
+
+/*********************** context specific *********************/
+
+void pend_switch_context(void)
+{
+    __CORE.switch_pending = true;
+}
+
+static void process_start(unsigned int fn)
+{
+    unsigned int* sp;
+    process_resume();
+    ((void (*)(void))fn)();
+    kprocess_abnormal_exit();
+    //process is destroyed, return to supervisor
+    __CORE.supervisor = true;
+    context_switch(&sp, __CORE.kernel_sp);
+}
+
+void process_setup_context(KPROCESS* process, void (*fn)(void))
+{
+    //same as registers on other cores, context is saved on top of process stack
+    process->sp = context_init(process->sp, process_start, (unsigned int)fn);
+}
+
+void svc_call(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    //already in supervisor context
+    if (__CORE.supervisor)
+    {
+        svc(num, param1, param2, param3);
+        return;
+    }
+    //IRQ from now is latched. Frame can't be overwritten by other process, if this one is preempted before
+    __CORE.supervisor = true;
+    __ASM volatile ("" : : : "memory");
+    __CORE.svc_frame.num = num;
+    __CORE.svc_frame.param1 = param1;
+    __CORE.svc_frame.param2 = param2;
+    __CORE.svc_frame.param3 = param3;
+    context_switch(&((KPROCESS*)__KERNEL->active_process)->sp, __CORE.kernel_sp);
+    process_resume();
+}
+
+static void kernel_loop()
+{
+    KPROCESS* kprocess;
+    for (;;)
+    {
+        irq_dispatch();
+        if (__CORE.switch_pending)
+        {
+            if (__KERNEL->next_process == NULL)
+            {
+                halt_core();
+                continue;
+            }
+            __KERNEL->active_process = __KERNEL->next_process;
+            __KERNEL->next_process = NULL;
+            __CORE.switch_pending = false;
+        }
+        kprocess = __KERNEL->active_process;
+        if (kprocess == NULL)
+        {
+            halt_core();
+            continue;
+        }
+        __GLOBAL->process = kprocess->process;
+        //supervisor flag is cleared by process itself. Signal here is still for kernel
+        context_switch(&__CORE.kernel_sp, kprocess->sp);
+        if (__CORE.preempted)
+            __CORE.preempted = false;
+        //NULL if process is terminated on exit
+        else if (__KERNEL->active_process != NULL)
+            svc(__CORE.svc_frame.num, __CORE.svc_frame.param1, __CORE.svc_frame.param2, __CORE.svc_frame.param3);
+    }
+}
+
+static void kernel_start(unsigned int param)
+{
+    __CORE.supervisor = true;
+    startup();
+    kernel_setup_dbg(host_stdout, NULL);
+
+    //on other cores done by timer driver
+    kirq_register(KERNEL_HANDLE, HPET_IRQn, hpet_isr, NULL);
+    __CORE.second_next = host_time_us() + SECOND_US;
+    ksystime_hpet_setup(&__HPET, NULL);
+
+    kernel_loop();
+}
+
+int main()
+{
+    unsigned int* host_sp;
+    if (mmap((void*)SRAM_BASE, SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != (void*)SRAM_BASE)
+        return 1;
+#if (KERNEL_PROFILING)
+    memset((void*)(SRAM_BASE + SRAM_SIZE - KERNEL_STACK_MAX), MAGIC_UNINITIALIZED_BYTE, KERNEL_STACK_MAX);
+#endif //KERNEL_PROFILING
+    irq_init();
+
+    __CORE.kernel_sp = context_init((void*)(SRAM_BASE + SRAM_SIZE), kernel_start, 0);
+    context_switch(&host_sp, __CORE.kernel_sp);
+    //never reach
+    return 1;
+}
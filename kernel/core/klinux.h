@@ -0,0 +1,33 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef KLINUX_H
+#define KLINUX_H
+
+#include "../../userspace/cc_macro.h"
+
+#ifndef __i386__
+#error Kernel objects are passed as unsigned int. Build host core with -m32
+#endif //__i386__
+
+//terminates host process
+extern void fatal();
+
+//Kernel, IRQ handlers and processes are sharing single host thread. IRQ handlers are interrupting only
+//process context. In supervisor context IRQ is latched, so there is nothing to mask. Just don't let compiler reorder memory access.
+__STATIC_INLINE void disable_interrupts(void)
+{
+    __ASM volatile ("" : : : "memory");
+}
+
+__STATIC_INLINE void enable_interrupts(void)
+{
+    __ASM volatile ("" : : : "memory");
+}
+
+#endif // KLINUX_H
@@ -28,7 +28,12 @@
 #define MAGIC_UNINITIALIZED                            0xcdcdcdcd
 #define MAGIC_UNINITIALIZED_BYTE                       0xcd
 
+#ifdef LINUX
+//host libc calls require much more stack
+#define	KERNEL_STACK_MAX                               0x4000
+#else
 #define	KERNEL_STACK_MAX                               0x200
+#endif //LINUX
 
 
 #if !defined(LDS) && !defined(__ASSEMBLER__)
@@ -81,3 +81,10 @@ ARRAY* karray_squeeze(ARRAY** ar)
     res = ((const LIB_ARRAY*)__GLOBAL->lib[LIB_ID_ARRAY])->lib_array_squeeze(ar, &__KSTD_MEM);
     return res;
 }
+
+ARRAY* karray_reserve(ARRAY** ar, unsigned int count)
+{
+    void* res;
+    res = ((const LIB_ARRAY*)__GLOBAL->lib[LIB_ID_ARRAY])->lib_array_reserve(ar, &__KSTD_MEM, count);
+    return res;
+}
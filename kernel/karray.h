@@ -22,5 +22,6 @@ void* karray_insert(ARRAY** ar, unsigned int index);
 ARRAY* karray_clear(ARRAY** ar);
 ARRAY* karray_remove(ARRAY** ar, unsigned int index);
 ARRAY* karray_squeeze(ARRAY** ar);
+ARRAY* karray_reserve(ARRAY** ar, unsigned int count);
 
 #endif // KARRAY_H
@@ -154,6 +154,17 @@ void svc(unsigned int num, unsigned int param1, unsigned int param2, unsigned in
         CHECK_IO_ADDRESS(process, (IPC*)param1);
         kipc_post(process, (IPC*)param1);
         break;
+    case SVC_IPC_POST_BATCH:
+        CHECK_ADDRESS(process, (unsigned int*)param3, sizeof(unsigned int));
+        if (param2 > KIPC_BATCH_MAX)
+        {
+            *((unsigned int*)param3) = 0;
+            error(ERROR_OUT_OF_RANGE);
+            break;
+        }
+        CHECK_ADDRESS(process, (IPC*)param1, param2 * sizeof(IPC));
+        *((unsigned int*)param3) = kipc_post_batch(process, (IPC*)param1, param2);
+        break;
     case SVC_IPC_WAIT:
         kipc_wait(process, param1, param2, param3);
         break;
@@ -206,6 +217,22 @@ void svc(unsigned int num, unsigned int param1, unsigned int param2, unsigned in
         CHECK_ADDRESS(process, (char*)param2, *((unsigned int*)param3));
         *((unsigned int*)param3) = kstream_read_no_block(param1, (char*)param2, *((unsigned int*)param3));
         break;
+    case SVC_STREAM_WRITE_RESERVE:
+        CHECK_ADDRESS(process, (char**)param2, sizeof(char*));
+        CHECK_ADDRESS(process, (unsigned int*)param3, sizeof(unsigned int));
+        *((unsigned int*)param3) = kstream_write_reserve(param1, (char**)param2);
+        break;
+    case SVC_STREAM_WRITE_COMMIT:
+        kstream_write_commit(param1, param2);
+        break;
+    case SVC_STREAM_READ_PEEK:
+        CHECK_ADDRESS(process, (char**)param2, sizeof(char*));
+        CHECK_ADDRESS(process, (unsigned int*)param3, sizeof(unsigned int));
+        *((unsigned int*)param3) = kstream_read_peek(param1, (char**)param2);
+        break;
+    case SVC_STREAM_READ_CONSUME:
+        kstream_read_consume(param1, param2);
+        break;
     case SVC_STREAM_FLUSH:
         kstream_flush(param1);
         break;
@@ -55,6 +55,8 @@
 #include "core/arm7/core_arm7.h"
 #elif defined(CORTEX_M)
 #include "kcortexm.h"
+#elif defined(LINUX)
+#include "klinux.h"
 #else
 #error MCU core is not defined or not supported
 #endif
@@ -70,8 +72,11 @@ typedef struct {
     void* next_process;
 
     int kerror;
-    //active processes
-    KPROCESS* processes;
+    //active processes, ready queue per priority group. Head of highest queue is running.
+    //Accessed only as DLIST, or optimizer can reorder list update and head read
+    DLIST* processes[KERNEL_READY_QUEUES];
+    //bit (31 - queue) is set, if queue is not empty
+    unsigned int ready_mask;
 #if (KERNEL_PROCESS_STAT)
     KPROCESS* wait_processes;
 #endif //(KERNEL_PROCESS_STAT)
@@ -104,6 +109,7 @@ typedef struct {
     //callback param for HPET timer
     void* cb_ktimer_param;
 
+    //pairing heap root, nearest timer
     KTIMER* timers;
     //HPET value, set before call
     unsigned int hpet_value;
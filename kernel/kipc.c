@@ -16,12 +16,15 @@
 #include "../userspace/core/core.h"
 #include "kernel.h"
 #include "kernel_config.h"
+#include <string.h>
 
 #define KIPC_ITEM(p, num)                               ((IPC*)((unsigned int)(((KPROCESS*)(p))->process) + sizeof(PROCESS) + (num) * sizeof(IPC)))
 
 void kipc_init(KPROCESS *process)
 {
     rb_init(&(process->process->ipcs), KERNEL_IPC_COUNT);
+    memset(process->process->ipc_posted, 0, sizeof(process->process->ipc_posted));
+    memset(process->process->ipc_consumed, 0, sizeof(process->process->ipc_consumed));
     process->kipc.wait_process = INVALID_HANDLE;
     process->kipc.cmd = ANY_CMD;
 }
@@ -45,6 +48,30 @@ static inline int kipc_index(HANDLE p, HANDLE wait_process, unsigned int cmd, un
     return -1;
 }
 
+//Queue is in process memory and reordered by process without kernel call, so kernel can't index items.
+//Only counters by cmd hash are shared. Scan is skipped, when nothing with same hash is queued,
+//otherwise it's still linear of queue size
+static inline bool kipc_pending(HANDLE p, HANDLE wait_process, unsigned int cmd, unsigned int param1)
+{
+    PROCESS* process = ((KPROCESS*)p)->process;
+    if (cmd != ANY_CMD)
+    {
+        //nothing with same cmd hash, don't scan
+        if (process->ipc_posted[IPC_HASH(cmd)] == process->ipc_consumed[IPC_HASH(cmd)])
+            return false;
+    }
+    else if (wait_process == ANY_HANDLE && param1 == ANY_HANDLE)
+        return !rb_is_empty(&process->ipcs);
+    return kipc_index(p, wait_process, cmd, param1) >= 0;
+}
+
+static inline bool kipc_is_waiting(KPROCESS* receiver, HANDLE sender, IPC* ipc)
+{
+    return (receiver->kipc.wait_process == sender || receiver->kipc.wait_process == ANY_HANDLE) &&
+           (receiver->kipc.cmd == ipc->cmd || receiver->kipc.cmd == ANY_CMD) &&
+           ((receiver->kipc.param1 == ipc->param1) || (receiver->kipc.param1 == ANY_HANDLE));
+}
+
 static bool kipc_send(HANDLE sender, HANDLE receiver, unsigned int cmd, void* param)
 {
     bool res = true;
@@ -68,7 +95,10 @@ static void kipc_post_internal(HANDLE sender, HANDLE receiver, unsigned int cmd,
     r = (KPROCESS*)receiver;
     disable_interrupts();
     if (!rb_is_full(&r->process->ipcs))
+    {
         index = rb_put(&r->process->ipcs);
+        ++r->process->ipc_posted[IPC_HASH(cmd)];
+    }
     enable_interrupts();
     if (index >= 0)
     {
@@ -132,9 +162,7 @@ void kipc_post(HANDLE sender, IPC* ipc)
 
     receiver = (KPROCESS*)ipc->process;
     disable_interrupts();
-    if ((receiver->kipc.wait_process == sender || receiver->kipc.wait_process == ANY_HANDLE) &&
-                 (receiver->kipc.cmd == ipc->cmd || receiver->kipc.cmd == ANY_CMD) &&
-                 ((receiver->kipc.param1 == ipc->param1) || (receiver->kipc.param1 == ANY_HANDLE)))
+    if (kipc_is_waiting(receiver, sender, ipc))
     {
         //already waiting? Wakeup him
         receiver->kipc.wait_process = INVALID_HANDLE;
@@ -144,6 +172,68 @@ void kipc_post(HANDLE sender, IPC* ipc)
     kipc_post_internal(sender, ipc->process, ipc->cmd, ipc->param1, ipc->param2, ipc->param3);
 }
 
+unsigned int kipc_post_batch(HANDLE sender, IPC* ipcs, unsigned int count)
+{
+    KPROCESS* receiver;
+    IPC* cur;
+    unsigned int i, j, run, free;
+    int index;
+    bool wakeup;
+    for (i = 0; i < count; i += run)
+    {
+        //IO and exodriver IPC are processed one by one
+        if (((ipcs[i].cmd & HAL_MODE) == HAL_IO_MODE) || (ipcs[i].process == KERNEL_HANDLE))
+        {
+            CHECK_IO_ADDRESS(sender, &ipcs[i]);
+            error(ERROR_OK);
+            kipc_post(sender, &ipcs[i]);
+            //receiver overflow is reported by kipc_post. Rest of batch is not posted
+            if (get_last_error() == ERROR_OVERFLOW)
+                return i;
+            run = 1;
+            continue;
+        }
+        receiver = (KPROCESS*)ipcs[i].process;
+        CHECK_MAGIC(receiver, MAGIC_PROCESS);
+        for (run = 1; (i + run < count) && (ipcs[i + run].process == ipcs[i].process) && ((ipcs[i + run].cmd & HAL_MODE) != HAL_IO_MODE); ++run) {}
+
+        wakeup = false;
+        disable_interrupts();
+        free = rb_free(&receiver->process->ipcs);
+        if (free > run)
+            free = run;
+        for (j = 0; j < free; ++j)
+        {
+            index = rb_put(&receiver->process->ipcs);
+            ++receiver->process->ipc_posted[IPC_HASH(ipcs[i + j].cmd)];
+            cur = KIPC_ITEM(receiver, index);
+            cur->cmd = ipcs[i + j].cmd;
+            cur->param1 = ipcs[i + j].param1;
+            cur->param2 = ipcs[i + j].param2;
+            cur->param3 = ipcs[i + j].param3;
+            cur->process = sender;
+            if (!wakeup && kipc_is_waiting(receiver, sender, &ipcs[i + j]))
+                wakeup = true;
+        }
+        //already waiting? Wakeup him once for whole batch
+        if (wakeup)
+        {
+            receiver->kipc.wait_process = INVALID_HANDLE;
+            kprocess_wakeup((HANDLE)receiver);
+        }
+        enable_interrupts();
+        if (free < run)
+        {
+            error(ERROR_OVERFLOW);
+#if (KERNEL_IPC_DEBUG)
+            printk("Error: receiver %s IPC overflow on batch, %d of %d posted\n", kprocess_name((HANDLE)receiver), i + free, count);
+#endif //KERNEL_IPC_DEBUG
+            return i + free;
+        }
+    }
+    return count;
+}
+
 void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1)
 {
     if (wait_process == process)
@@ -157,7 +247,7 @@ void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned i
     kprocess_sleep(process, NULL, PROCESS_SYNC_IPC, INVALID_HANDLE);
 
     disable_interrupts();
-    if (kipc_index(process, wait_process, cmd, param1) >= 0)
+    if (kipc_pending(process, wait_process, cmd, param1))
         //maybe already on queue? Wakeup process
         kprocess_wakeup(process);
     else
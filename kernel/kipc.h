@@ -16,7 +16,11 @@
 void kipc_init(KPROCESS* process);
 void kipc_lock_release(KPROCESS* process);
 
+//batch size in bytes must not overflow on address check
+#define KIPC_BATCH_MAX                                  (0xffffffff / sizeof(IPC))
+
 void kipc_post(HANDLE sender, IPC* ipc);
+unsigned int kipc_post_batch(HANDLE sender, IPC* ipcs, unsigned int count);
 void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1);
 void kipc_call(HANDLE process, IPC* ipc);
 
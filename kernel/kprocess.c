@@ -38,54 +38,87 @@ static inline void switch_to_process(KPROCESS* kprocess)
     pend_switch_context();
 }
 
-void kprocess_add_to_active_list(KPROCESS* kprocess)
+static inline DLIST** kprocess_ready_queue(unsigned int priority)
 {
-    bool found = false;
-    KPROCESS* kprocess_to_save = kprocess;
-    DLIST_ENUM de;
+    priority >>= KERNEL_READY_QUEUE_SHIFT;
+    return &__KERNEL->processes[priority < KERNEL_READY_QUEUES ? priority : KERNEL_READY_QUEUES - 1];
+}
+
+static inline KPROCESS* kprocess_ready_head()
+{
+    if (__KERNEL->ready_mask == 0)
+        return NULL;
+    return (KPROCESS*)__KERNEL->processes[__builtin_clz(__KERNEL->ready_mask)];
+}
+
+//insert after all processes with same or higher priority
+static void kprocess_ready_insert(KPROCESS* kprocess)
+{
+    DLIST** queue = kprocess_ready_queue(kprocess->base_priority);
     KPROCESS* cur;
+    if (*queue == NULL)
+    {
+        dlist_add_tail(queue, (DLIST*)kprocess);
+        __KERNEL->ready_mask |= 0x80000000 >> (queue - __KERNEL->processes);
+        return;
+    }
+    //generally all processes in queue are of same priority, so search from tail
+    for (cur = (KPROCESS*)(*queue)->prev; cur->base_priority > kprocess->base_priority; cur = (KPROCESS*)cur->list.prev)
+    {
+        if ((DLIST*)cur == *queue)
+        {
+            dlist_add_head(queue, (DLIST*)kprocess);
+            return;
+        }
+    }
+    dlist_add_after(queue, (DLIST*)cur, (DLIST*)kprocess);
+}
+
+static void kprocess_ready_remove(KPROCESS* kprocess)
+{
+    DLIST** queue = kprocess_ready_queue(kprocess->base_priority);
+    dlist_remove(queue, (DLIST*)kprocess);
+    if (*queue == NULL)
+        __KERNEL->ready_mask &= ~(0x80000000 >> (queue - __KERNEL->processes));
+}
+
+void kprocess_add_to_active_list(KPROCESS* kprocess)
+{
+    KPROCESS* head;
 #if (KERNEL_PROCESS_STAT)
     ksystime_get_uptime_internal(&kprocess->uptime_start);
     dlist_remove((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
 #endif
+    head = kprocess_ready_head();
     //return from core HALT
-    if (__KERNEL->processes == NULL)
+    if (head == NULL)
     {
-        dlist_add_head((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
+        kprocess_ready_insert(kprocess);
         switch_to_process(kprocess);
         return;
     }
-    if (kprocess->base_priority < __KERNEL->processes->base_priority)
+    if (kprocess->base_priority < head->base_priority)
     {
-        kprocess_to_save = __KERNEL->processes;
-        dlist_remove_head((DLIST**)&__KERNEL->processes);
-        dlist_add_head((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
+        //preempted process goes after processes with same priority
+        kprocess_ready_remove(head);
+        kprocess_ready_insert(head);
+        kprocess_ready_insert(kprocess);
         switch_to_process(kprocess);
     }
-
-    //find place for saved kprocess
-    dlist_enum_start((DLIST**)&__KERNEL->processes, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
-        if (kprocess_to_save->base_priority < cur->base_priority)
-        {
-            dlist_add_before((DLIST**)&__KERNEL->processes, (DLIST*)cur, (DLIST*)kprocess_to_save);
-            found = true;
-            break;
-        }
-    if (!found)
-        dlist_add_tail((DLIST**)&__KERNEL->processes, (DLIST*)kprocess_to_save);
+    else
+        kprocess_ready_insert(kprocess);
 }
 
 void kprocess_remove_from_active_list(KPROCESS* kprocess)
 {
     //freeze active task
-    if (kprocess == __KERNEL->processes)
+    if (kprocess == kprocess_ready_head())
     {
-        dlist_remove_head((DLIST**)&__KERNEL->processes);
-        switch_to_process(__KERNEL->processes);
+        kprocess_ready_remove(kprocess);
+        switch_to_process(kprocess_ready_head());
     }
     else
-        dlist_remove((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
+        kprocess_ready_remove(kprocess);
 #if (KERNEL_PROCESS_STAT)
     dlist_add_tail((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
     SYSTIME time;
@@ -234,12 +267,15 @@ void kprocess_set_priority(HANDLE p, unsigned int priority)
     disable_interrupts();
     if (process->base_priority != priority)
     {
-        process->base_priority = priority;
+        //ready queue depends on priority
         if ((process->flags & PROCESS_MODE_MASK) == PROCESS_MODE_ACTIVE)
         {
             kprocess_remove_from_active_list(process);
+            process->base_priority = priority;
             kprocess_add_to_active_list(process);
         }
+        else
+            process->base_priority = priority;
     }
     enable_interrupts();
 }
@@ -353,7 +389,8 @@ void kprocess_init(const REX* rex)
     __KERNEL->next_process = NULL;
     __KERNEL->active_process = NULL;
     __KERNEL->kerror = ERROR_OK;
-    dlist_clear((DLIST**)&__KERNEL->processes);
+    memset(__KERNEL->processes, 0, sizeof(__KERNEL->processes));
+    __KERNEL->ready_mask = 0;
 #if (KERNEL_PROCESS_STAT)
     dlist_clear((DLIST**)&__KERNEL->wait_processes);
 #endif
@@ -476,6 +513,7 @@ static inline void kernel_stat()
 
 void kprocess_info()
 {
+    int i;
     int cnt = 0;
     DLIST_ENUM de;
     KPROCESS* cur;
@@ -486,11 +524,14 @@ void kprocess_info()
 #endif
     printk(STAT_LINE);
     disable_interrupts();
-    dlist_enum_start((DLIST**)&__KERNEL->processes, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
+    for (i = 0; i < KERNEL_READY_QUEUES; ++i)
     {
-        process_stat(cur);
-        ++cnt;
+        dlist_enum_start(&__KERNEL->processes[i], &de);
+        while (dlist_enum(&de, (DLIST**)&cur))
+        {
+            process_stat(cur);
+            ++cnt;
+        }
     }
 #if (KERNEL_PROCESS_STAT)
     dlist_enum_start((DLIST**)&__KERNEL->wait_processes, &de);
@@ -19,7 +19,10 @@ typedef struct {
 }KIRQ;
 
 typedef struct _KTIMER {
-    DLIST list;
+    //pairing heap node. prev is parent for first child
+    struct _KTIMER* child;
+    struct _KTIMER* next;
+    struct _KTIMER* prev;
     SYSTIME time;
     void (*callback)(void*);
     void* param;
@@ -49,4 +52,9 @@ typedef struct _KPROCESS {
     KIPC kipc;
 }KPROCESS;
 
+//Ready queues. Each queue holds (1 << KERNEL_READY_QUEUE_SHIFT) priorities, all lower priorities are in the last queue.
+//Queue is selected by bitmap, so KERNEL_READY_QUEUES can't be more than 32
+#define KERNEL_READY_QUEUES                                 32
+#define KERNEL_READY_QUEUE_SHIFT                            3
+
 #endif // KPROCESS_PRIVATE_H
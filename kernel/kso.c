@@ -68,3 +68,10 @@ unsigned int kso_count(SO* so)
     res = ((const LIB_SO*)__GLOBAL->lib[LIB_ID_SO])->lib_so_count(so, &__KSTD_MEM);
     return res;
 }
+
+SO* kso_reserve(SO* so, unsigned int count)
+{
+    SO* res;
+    res = ((const LIB_SO*)__GLOBAL->lib[LIB_ID_SO])->lib_so_reserve(so, &__KSTD_MEM, count);
+    return res;
+}
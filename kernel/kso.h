@@ -21,5 +21,6 @@ void* kso_get(SO* so, HANDLE handle);
 HANDLE kso_first(SO* so);
 HANDLE kso_next(SO* so, HANDLE prev);
 unsigned int kso_count(SO* so);
+SO* kso_reserve(SO* so, unsigned int count);
 
 #endif // KSO_H
@@ -30,6 +30,8 @@ typedef struct {
     //list actually
     struct _STREAM_HANDLE* write_waiters;
     struct _STREAM_HANDLE* read_waiters;
+    //writer with outstanding reserve
+    struct _STREAM_HANDLE* reserved;
     //item
     HANDLE listener;
     unsigned int listener_param;
@@ -106,6 +108,7 @@ HANDLE kstream_create(unsigned int size)
     rb_init(&stream->rb, size);
     stream->listener = INVALID_HANDLE;
     stream->write_waiters = stream->read_waiters = NULL;
+    stream->reserved = NULL;
     return (HANDLE)stream;
 }
 
@@ -143,6 +146,11 @@ void kstream_close(HANDLE process, HANDLE h)
         error(ERROR_ACCESS_DENIED);
         return;
     }
+    //drop reservation of closed writer
+    disable_interrupts();
+    if (handle->stream->reserved == handle)
+        handle->stream->reserved = NULL;
+    enable_interrupts();
     kfree(handle);
 }
 
@@ -192,11 +200,64 @@ void kstream_stop_listen(HANDLE process, HANDLE s)
     stream->listener = INVALID_HANDLE;
 }
 
-unsigned int kstream_write_no_block_internal(STREAM_HANDLE *handle, char* buf, unsigned int size_max)
+//called with disabled interrupts
+static void kstream_push_writers(STREAM* stream)
+{
+    register STREAM_HANDLE* writer;
+    register unsigned int to_push, chunk;
+    //reserved space can't be overwritten, writers are pushed on commit
+    if (stream->reserved != NULL)
+        return;
+    to_push = rb_free(&stream->rb);
+    while ((writer = stream->write_waiters) != NULL && to_push)
+    {
+        chunk = rb_put_n(&stream->rb, stream->data, writer->buf, writer->size < to_push ? writer->size : to_push);
+        writer->buf += chunk;
+        writer->size -= chunk;
+        to_push -= chunk;
+        //writed all from waiter? Wake him up.
+        if (!writer->size)
+        {
+            dlist_remove_head((DLIST**)&stream->write_waiters);
+            kprocess_wakeup(writer->process);
+            writer->mode = STREAM_MODE_IDLE;
+        }
+    }
+}
+
+//called with disabled interrupts
+static void kstream_feed_readers(STREAM* stream)
+{
+    register STREAM_HANDLE* reader;
+    register unsigned int chunk;
+    while ((reader = stream->read_waiters) != NULL && !rb_is_empty(&stream->rb))
+    {
+        chunk = rb_get_n(&stream->rb, stream->data, reader->buf, reader->size);
+        reader->buf += chunk;
+        reader->size -= chunk;
+        //readed all by waiter? Wake him up.
+        if (!reader->size)
+        {
+            dlist_remove_head((DLIST**)&stream->read_waiters);
+            kprocess_wakeup(reader->process);
+            reader->mode = STREAM_MODE_IDLE;
+        }
+    }
+}
+
+static bool kstream_write_no_block_internal(STREAM_HANDLE *handle, char* buf, unsigned int* size)
 {
     register STREAM_HANDLE* reader;
-    unsigned int to_write = size_max;
+    unsigned int to_write = *size;
     disable_interrupts();
+    //copy will overwrite reserved space or reorder data before commit
+    if (handle->stream->reserved != NULL)
+    {
+        enable_interrupts();
+        *size = 0;
+        error(ERROR_IN_PROGRESS);
+        return false;
+    }
     //write directly to output
     while (to_write && (reader = handle->stream->read_waiters) != NULL)
     {
@@ -221,26 +282,29 @@ unsigned int kstream_write_no_block_internal(STREAM_HANDLE *handle, char* buf, u
         }
     }
     //write rest to stream
-    for(; to_write && !rb_is_full(&handle->stream->rb); --to_write)
-        handle->stream->data[rb_put(&handle->stream->rb)] = *buf++;
+    to_write -= rb_put_n(&handle->stream->rb, handle->stream->data, buf, to_write);
     enable_interrupts();
-    return size_max - to_write;
+    *size -= to_write;
+    return true;
 }
 
 unsigned int kstream_write_no_block(HANDLE h, char* buf, unsigned int size_max)
 {
     STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
     CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
-    unsigned int res = kstream_write_no_block_internal(handle, buf, size_max);
-    kstream_check_inform(handle->stream);
-    return res;
+    if (kstream_write_no_block_internal(handle, buf, &size_max))
+        kstream_check_inform(handle->stream);
+    return size_max;
 }
 
 void kstream_write(HANDLE process, HANDLE h, char* buf, unsigned int size)
 {
     STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
     CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
-    handle->size = size - kstream_write_no_block_internal(handle, buf, size);
+    unsigned int written = size;
+    if (!kstream_write_no_block_internal(handle, buf, &written))
+        return;
+    handle->size = size - written;
     //still more? wait
     if (handle->size)
     {
@@ -257,13 +321,14 @@ void kstream_write(HANDLE process, HANDLE h, char* buf, unsigned int size)
 unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max)
 {
     register STREAM_HANDLE* writer;
-    register unsigned int to_read, to_push;
+    register unsigned int to_read, chunk;
     STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
     CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
     //read from stream
     disable_interrupts();
-    for(to_read = size_max; to_read && !rb_is_empty(&handle->stream->rb); --to_read)
-        *buf++ = handle->stream->data[rb_get(&handle->stream->rb)];
+    chunk = rb_get_n(&handle->stream->rb, handle->stream->data, buf, size_max);
+    buf += chunk;
+    to_read = size_max - chunk;
     //read directly from input
     while (to_read && (writer = handle->stream->write_waiters) != NULL)
     {
@@ -290,21 +355,7 @@ unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max)
     }
     //push data to stream internally after read
     if (to_read < size_max)
-    {
-        to_push = rb_free(&handle->stream->rb);
-        while ((writer = handle->stream->write_waiters) != NULL && to_push)
-        {
-            for(; to_push && writer->size; --writer->size, --to_push)
-                handle->stream->data[rb_put(&handle->stream->rb)] = *writer->buf++;
-            //writed all from waiter? Wake him up.
-            if (!writer->size)
-            {
-                dlist_remove_head((DLIST**)&handle->stream->write_waiters);
-                kprocess_wakeup(writer->process);
-                writer->mode = STREAM_MODE_IDLE;
-            }
-        }
-    }
+        kstream_push_writers(handle->stream);
     enable_interrupts();
     return size_max - to_read;
 }
@@ -325,6 +376,85 @@ void kstream_read(HANDLE process, HANDLE h, char* buf, unsigned int size)
     }
 }
 
+unsigned int kstream_write_reserve(HANDLE h, char** buf)
+{
+    unsigned int size;
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    //only one reservation at time
+    if (handle->stream->reserved != NULL && handle->stream->reserved != handle)
+    {
+        enable_interrupts();
+        *buf = NULL;
+        error(ERROR_IN_PROGRESS);
+        return 0;
+    }
+    handle->stream->reserved = handle;
+    *buf = handle->stream->data + handle->stream->rb.head;
+    size = rb_put_span(&handle->stream->rb);
+    enable_interrupts();
+    return size;
+}
+
+void kstream_write_commit(HANDLE h, unsigned int size)
+{
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    //reservation is lost on flush
+    if (handle->stream->reserved != handle)
+    {
+        enable_interrupts();
+        error(ERROR_INVALID_STATE);
+        return;
+    }
+    //only span, returned by reserve, is written in place
+    if (size > rb_put_span(&handle->stream->rb))
+    {
+        enable_interrupts();
+        error(ERROR_OUT_OF_RANGE);
+        return;
+    }
+    handle->stream->reserved = NULL;
+    rb_put_advance(&handle->stream->rb, size);
+    //readers are waiting only on empty stream, so data is not reordered
+    kstream_feed_readers(handle->stream);
+    //writers, arrived before reserve, are waiting for free space
+    kstream_push_writers(handle->stream);
+    enable_interrupts();
+    kstream_check_inform(handle->stream);
+}
+
+unsigned int kstream_read_peek(HANDLE h, char** buf)
+{
+    unsigned int size;
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    *buf = handle->stream->data + handle->stream->rb.tail;
+    size = rb_get_span(&handle->stream->rb);
+    enable_interrupts();
+    return size;
+}
+
+void kstream_read_consume(HANDLE h, unsigned int size)
+{
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    //only span, returned by peek, is read in place
+    if (size > rb_get_span(&handle->stream->rb))
+    {
+        enable_interrupts();
+        error(ERROR_OUT_OF_RANGE);
+        return;
+    }
+    rb_get_advance(&handle->stream->rb, size);
+    kstream_push_writers(handle->stream);
+    enable_interrupts();
+}
+
 void kstream_flush(HANDLE s)
 {
     STREAM* stream = (STREAM*)s;
@@ -334,6 +464,7 @@ void kstream_flush(HANDLE s)
     //flush stream
     disable_interrupts();
     rb_clear(&stream->rb);
+    stream->reserved = NULL;
     //flush waiters
     while ((handle = stream->write_waiters) != NULL)
     {
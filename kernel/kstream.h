@@ -27,6 +27,10 @@ unsigned int kstream_write_no_block(HANDLE h, char* buf, unsigned int size_max);
 void kstream_write(HANDLE process, HANDLE h, char* buf, unsigned int size);
 unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max);
 void kstream_read(HANDLE process, HANDLE h, char* buf, unsigned int size);
+unsigned int kstream_write_reserve(HANDLE h, char** buf);
+void kstream_write_commit(HANDLE h, unsigned int size);
+unsigned int kstream_read_peek(HANDLE h, char** buf);
+void kstream_read_consume(HANDLE h, unsigned int size);
 void kstream_flush(HANDLE s);
 void kstream_destroy(HANDLE s);
 
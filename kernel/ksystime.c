@@ -63,10 +63,98 @@ void ksystime_get_uptime(SYSTIME* res)
     enable_interrupts();
 }
 
+/*
+    Timers queue is pairing heap: O(1) insert, O(log n) amortized remove.
+    Process and soft timers are started/stopped on every sleep, sync timeout
+    and network retransmission, so sorted list insert is too slow here.
+*/
+
+static inline bool ktimer_less(KTIMER* a, KTIMER* b)
+{
+    return (a->time.sec < b->time.sec) || ((a->time.sec == b->time.sec) && (a->time.usec < b->time.usec));
+}
+
+//a and b are roots. Returns new root
+static KTIMER* ktimer_meld(KTIMER* a, KTIMER* b)
+{
+    KTIMER* tmp;
+    if (ktimer_less(b, a))
+    {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->prev = a;
+    b->next = a->child;
+    if (a->child)
+        a->child->prev = b;
+    a->child = b;
+    a->next = NULL;
+    return a;
+}
+
+//two-pass merge of siblings list. Returns new root
+static KTIMER* ktimer_merge_pairs(KTIMER* first)
+{
+    KTIMER *a, *b, *pairs, *root;
+    //first pass: meld pairs from left to right, store in reverse order
+    for (pairs = NULL; first != NULL; pairs = a)
+    {
+        a = first;
+        b = a->next;
+        if (b != NULL)
+        {
+            first = b->next;
+            a = ktimer_meld(a, b);
+        }
+        else
+            first = NULL;
+        a->next = pairs;
+    }
+    //second pass: meld from right to left
+    for (root = NULL; pairs != NULL; )
+    {
+        a = pairs;
+        pairs = a->next;
+        a->next = NULL;
+        root = (root == NULL) ? a : ktimer_meld(root, a);
+    }
+    if (root != NULL)
+        root->prev = NULL;
+    return root;
+}
+
+static void ktimer_insert(KTIMER* timer)
+{
+    timer->child = timer->next = timer->prev = NULL;
+    __KERNEL->timers = (__KERNEL->timers == NULL) ? timer : ktimer_meld(__KERNEL->timers, timer);
+}
+
+static void ktimer_remove(KTIMER* timer)
+{
+    KTIMER* sub;
+    if (timer == __KERNEL->timers)
+    {
+        __KERNEL->timers = ktimer_merge_pairs(timer->child);
+        return;
+    }
+    //unlink from siblings
+    if (timer->prev->child == timer)
+        timer->prev->child = timer->next;
+    else
+        timer->prev->next = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    sub = ktimer_merge_pairs(timer->child);
+    if (sub != NULL)
+        __KERNEL->timers = ktimer_meld(__KERNEL->timers, sub);
+}
+
 static inline void find_shoot_next()
 {
-    volatile KTIMER* timers_to_shoot = NULL;
-    volatile KTIMER* cur;
+    KTIMER* timers_to_shoot = NULL;
+    KTIMER* last = NULL;
+    KTIMER* cur;
     SYSTIME uptime;
 
     disable_interrupts();
@@ -77,15 +165,25 @@ static inline void find_shoot_next()
         {
             cur = __KERNEL->timers;
             cur->active = false;
-            dlist_remove_head((DLIST**)&__KERNEL->timers);
-            dlist_add_tail((DLIST**)&timers_to_shoot, (DLIST*)cur);
+            ktimer_remove(cur);
+            //shoot in time order
+            cur->next = NULL;
+            if (last)
+                last->next = cur;
+            else
+                timers_to_shoot = cur;
+            last = cur;
         }
         //add to this second events
         else if (__KERNEL->timers->time.sec == uptime.sec)
         {
             __KERNEL->uptime.usec += __KERNEL->cb_ktimer.elapsed(__KERNEL->cb_ktimer_param);
             __KERNEL->cb_ktimer.stop(__KERNEL->cb_ktimer_param);
-            __KERNEL->hpet_value = __KERNEL->timers->time.usec - __KERNEL->uptime.usec;
+            //HPET is read again after compare. If timer is already expired meanwhile, shoot it on next tick
+            if (__KERNEL->timers->time.usec > __KERNEL->uptime.usec)
+                __KERNEL->hpet_value = __KERNEL->timers->time.usec - __KERNEL->uptime.usec;
+            else
+                __KERNEL->hpet_value = 1;
             __KERNEL->cb_ktimer.start(__KERNEL->hpet_value, __KERNEL->cb_ktimer_param);
             break;
         }
@@ -96,7 +194,7 @@ static inline void find_shoot_next()
     while (timers_to_shoot)
     {
         cur = timers_to_shoot;
-        dlist_remove_head((DLIST**)&timers_to_shoot);
+        timers_to_shoot = cur->next;
         cur->callback(cur->param);
     }
 }
@@ -146,24 +244,12 @@ void ksystime_hpet_setup(const CB_SVC_TIMER *cb_ktimer, void *cb_ktimer_param)
 void ksystime_timer_start_internal(KTIMER* timer, SYSTIME *time)
 {
     SYSTIME uptime;
-    DLIST_ENUM de;
-    KTIMER* cur;
-    bool found = false;
     ksystime_get_uptime(&uptime);
     timer->time.sec = time->sec;
     timer->time.usec = time->usec;
     systime_add(&uptime, &timer->time, &timer->time);
     disable_interrupts();
-    dlist_enum_start((DLIST**)&__KERNEL->timers, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
-        if (systime_compare(&cur->time, &timer->time) < 0)
-        {
-            dlist_add_before((DLIST**)&__KERNEL->timers, (DLIST*)cur, (DLIST*)timer);
-            found = true;
-            break;
-        }
-    if (!found)
-        dlist_add_tail((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+    ktimer_insert(timer);
     timer->active = true;
     enable_interrupts();
     find_shoot_next();
@@ -173,7 +259,7 @@ void ksystime_timer_stop_internal(KTIMER* timer)
 {
     if (timer->active)
     {
-        dlist_remove((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+        ktimer_remove(timer);
         timer->active = false;
     }
 }
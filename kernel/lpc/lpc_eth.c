@@ -150,10 +150,10 @@ static void lpc_eth_flush(EXO* exo)
         exo->eth.rx_des[1].size = ETH_RDES1_RCH;
         exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
 
-        exo->eth.tx_des[0].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-        exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-        exo->eth.tx_des[1].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-        exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
+        exo->eth.tx_des[0].ctl = ETH_TDES0_IC;
+        exo->eth.tx_des[0].buf2_ndes = NULL;
+        exo->eth.tx_des[1].ctl = ETH_TDES0_TER | ETH_TDES0_IC;
+        exo->eth.tx_des[1].buf2_ndes = NULL;
 
         __disable_irq();
         exo->eth.rx_des[i].ctl = 0;
@@ -164,7 +164,7 @@ static void lpc_eth_flush(EXO* exo)
             kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
 
         __disable_irq();
-        exo->eth.tx_des[i].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;;
+        exo->eth.tx_des[i].ctl = (i ? ETH_TDES0_TER : 0) | ETH_TDES0_IC;
         io = exo->eth.tx[i];
         exo->eth.tx[i] = NULL;
         __enable_irq();
@@ -369,10 +369,11 @@ static inline void lpc_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE c
     exo->eth.rx_des[1].size = ETH_RDES1_RCH;
     exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
 
-    exo->eth.tx_des[0].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-    exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-    exo->eth.tx_des[1].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-    exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
+    //TX is in ring mode, second buffer is gathered frame tail
+    exo->eth.tx_des[0].ctl = ETH_TDES0_IC;
+    exo->eth.tx_des[0].buf2_ndes = NULL;
+    exo->eth.tx_des[1].ctl = ETH_TDES0_TER | ETH_TDES0_IC;
+    exo->eth.tx_des[1].buf2_ndes = NULL;
 
     exo->eth.cur_rx = exo->eth.cur_tx = 0;
 #else
@@ -380,8 +381,8 @@ static inline void lpc_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE c
     memset(&exo->eth.rx_des, 0, sizeof(ETH_DESCRIPTOR));
     exo->eth.rx_des.size = ETH_RDES1_RCH;
     exo->eth.rx_des.buf2_ndes = &exo->eth.rx_des;
-    exo->eth.tx_des.ctl = ETH_TDES0_TCH;
-    exo->eth.tx_des.buf2_ndes = &exo->eth.tx_des;
+    exo->eth.tx_des.ctl = ETH_TDES0_TER;
+    exo->eth.tx_des.buf2_ndes = NULL;
 #endif
     LPC_ETHERNET->DMA_TRANS_DES_ADDR = (unsigned int)&exo->eth.tx_des;
     LPC_ETHERNET->DMA_REC_DES_ADDR = (unsigned int)&exo->eth.rx_des;
@@ -475,6 +476,18 @@ static inline void lpc_eth_read(EXO* exo, IPC* ipc)
     kerror(ERROR_SYNC);
 }
 
+static inline void lpc_eth_tx_gather(ETH_DESCRIPTOR* des, IPC* ipc)
+{
+    ETH_GATHER* gather;
+    des->buf2_ndes = NULL;
+    if (HAL_ITEM(ipc->cmd) == ETH_WRITE_GATHER)
+    {
+        gather = io_stack((IO*)ipc->param2);
+        des->buf2_ndes = (void*)gather->data;
+        des->size |= ((gather->size << ETH_TDES1_TBS2_POS) & ETH_TDES1_TBS2_MASK);
+    }
+}
+
 static inline void lpc_eth_write(EXO* exo, IPC* ipc)
 {
     IO* io = (IO*)ipc->param2;
@@ -498,7 +511,8 @@ static inline void lpc_eth_write(EXO* exo, IPC* ipc)
     }
     exo->eth.tx_des[i].buf1 = io_data(io);
     exo->eth.tx_des[i].size = ((io->data_size << ETH_TDES1_TBS1_POS) & ETH_TDES1_TBS1_MASK);
-    exo->eth.tx_des[i].ctl = ETH_TDES0_TCH | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
+    lpc_eth_tx_gather(&exo->eth.tx_des[i], ipc);
+    exo->eth.tx_des[i].ctl = ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC | (i ? ETH_TDES0_TER : 0);
     __disable_irq();
     exo->eth.tx[i] = io;
     //give descriptor to DMA
@@ -513,8 +527,9 @@ static inline void lpc_eth_write(EXO* exo, IPC* ipc)
     exo->eth.tx_des.buf1 = io_data(io);
     exo->eth.tx = io;
     exo->eth.tx_des.size = ((io->data_size << ETH_TDES1_TBS1_POS) & ETH_TDES1_TBS1_MASK);
+    lpc_eth_tx_gather(&exo->eth.tx_des, ipc);
     //give descriptor to DMA
-    exo->eth.tx_des.ctl = ETH_TDES0_TCH | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
+    exo->eth.tx_des.ctl = ETH_TDES0_TER | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
     exo->eth.tx_des.ctl |= ETH_TDES0_OWN;
 #endif
     //enable and poll DMA. Value is doesn't matter
@@ -570,6 +585,7 @@ void lpc_eth_request(EXO* exo, IPC* ipc)
         lpc_eth_read(exo, ipc);
         break;
     case IPC_WRITE:
+    case ETH_WRITE_GATHER:
         lpc_eth_write(exo, ipc);
         break;
     case IPC_TIMEOUT:
@@ -241,18 +241,19 @@ static inline void stm32_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE
     exo->eth.rx_des[1].size = ETH_RDES_RCH;
     exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
 
-    exo->eth.tx_des[0].ctl = ETH_TDES_TCH | ETH_TDES_IC;
-    exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-    exo->eth.tx_des[1].ctl = ETH_TDES_TCH | ETH_TDES_IC;
-    exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
+    //TX is in ring mode, second buffer is gathered frame tail
+    exo->eth.tx_des[0].ctl = ETH_TDES_IC;
+    exo->eth.tx_des[0].buf2_ndes = NULL;
+    exo->eth.tx_des[1].ctl = ETH_TDES_TER | ETH_TDES_IC;
+    exo->eth.tx_des[1].buf2_ndes = NULL;
 
     exo->eth.cur_rx = exo->eth.cur_tx = 0;
 #else
     exo->eth.rx_des.ctl = 0;
     exo->eth.rx_des.size = ETH_RDES_RCH;
     exo->eth.rx_des.buf2_ndes = &exo->eth.rx_des;
-    exo->eth.tx_des.ctl = ETH_TDES_TCH;
-    exo->eth.tx_des.buf2_ndes = &exo->eth.tx_des;
+    exo->eth.tx_des.ctl = ETH_TDES_TER;
+    exo->eth.tx_des.buf2_ndes = NULL;
 #endif
     ETH->DMATDLAR = (unsigned int)&exo->eth.tx_des;
     ETH->DMARDLAR = (unsigned int)&exo->eth.rx_des;
@@ -342,6 +343,18 @@ static inline void stm32_eth_read(EXO* exo, IPC* ipc)
     kerror(ERROR_SYNC);
 }
 
+static inline void stm32_eth_tx_gather(ETH_DESCRIPTORS* des, IPC* ipc)
+{
+    ETH_GATHER* gather;
+    des->buf2_ndes = NULL;
+    if (HAL_ITEM(ipc->cmd) == ETH_WRITE_GATHER)
+    {
+        gather = io_stack((IO*)ipc->param2);
+        des->buf2_ndes = (void*)gather->data;
+        des->size |= ((gather->size << ETH_TDES_TBS2_POS) & ETH_TDES_TBS2_MASK);
+    }
+}
+
 static inline void stm32_eth_write(EXO* exo, IPC* ipc)
 {
     IO* io = (IO*)ipc->param2;
@@ -365,7 +378,8 @@ static inline void stm32_eth_write(EXO* exo, IPC* ipc)
     }
     exo->eth.tx_des[i].buf1 = io_data(io);
     exo->eth.tx_des[i].size = ((io->data_size << ETH_TDES_TBS1_POS) & ETH_TDES_TBS1_MASK);
-    exo->eth.tx_des[i].ctl = ETH_TDES_TCH | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC;
+    stm32_eth_tx_gather(&exo->eth.tx_des[i], ipc);
+    exo->eth.tx_des[i].ctl = ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC | (i ? ETH_TDES_TER : 0);
     __disable_irq();
     exo->eth.tx[i] = io;
     //give descriptor to DMA
@@ -380,8 +394,9 @@ static inline void stm32_eth_write(EXO* exo, IPC* ipc)
     exo->eth.tx_des.buf1 = io_data(io);
     exo->eth.tx = io;
     exo->eth.tx_des.size = ((io->data_size << ETH_TDES_TBS1_POS) & ETH_TDES_TBS1_MASK);
+    stm32_eth_tx_gather(&exo->eth.tx_des, ipc);
     //give descriptor to DMA
-    exo->eth.tx_des.ctl = ETH_TDES_TCH | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC;
+    exo->eth.tx_des.ctl = ETH_TDES_TER | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC;
     exo->eth.tx_des.ctl |= ETH_TDES_OWN;
 #endif
     //enable and poll DMA. Value is doesn't matter
@@ -453,6 +468,7 @@ void stm32_eth_request(EXO* exo, IPC* ipc)
             stm32_eth_read(exo, ipc);
             break;
         case IPC_WRITE:
+        case ETH_WRITE_GATHER:
             stm32_eth_write(exo, ipc);
             break;
         case IPC_TIMEOUT:
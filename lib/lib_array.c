@@ -8,6 +8,7 @@
 
 #include "lib_array.h"
 #include "../userspace/error.h"
+#include "kernel_config.h"
 #include <string.h>
 
 typedef struct _ARRAY {
@@ -15,6 +16,18 @@ typedef struct _ARRAY {
 } ARRAY;
 
 #define ARRAY_DATA(ar)                      ((void*)(((uint8_t*)(ar)) + sizeof(ARRAY)))
+//don't shrink small arrays, realloc will not return anything useful
+#define ARRAY_SHRINK_MIN                    8
+
+static bool lib_array_resize(ARRAY** ar, const STD_MEM* std_mem, unsigned int reserved)
+{
+    ARRAY* tmp = std_mem->fn_realloc(*ar, sizeof(ARRAY) + (*ar)->data_size * reserved);
+    if (tmp == NULL)
+        return false;
+    (*ar) = tmp;
+    (*ar)->reserved = reserved;
+    return true;
+}
 
 ARRAY* lib_array_create(ARRAY** ar, const STD_MEM* std_mem, unsigned int data_size, unsigned int reserved)
 {
@@ -55,27 +68,32 @@ unsigned int lib_array_size(ARRAY* ar, const STD_MEM* std_mem)
 
 void* lib_array_append(ARRAY **ar, const STD_MEM* std_mem)
 {
-    ARRAY* tmp;
     if (*ar == NULL)
         return NULL;
-    //already have space
-    if ((*ar)->reserved > (*ar)->size)
-        ++(*ar)->size;
-    else
+    //no space, grow geometrically by 1.5, so N appends costs only O(log N) reallocs
+    if ((*ar)->reserved <= (*ar)->size && !lib_array_resize(ar, std_mem, (*ar)->size + ((*ar)->size >> 1) + 1))
+        return NULL;
+    ++(*ar)->size;
+    return lib_array_at(*ar, std_mem, (*ar)->size - 1);
+}
+
+ARRAY* lib_array_reserve(ARRAY** ar, const STD_MEM* std_mem, unsigned int count)
+{
+    if (*ar == NULL)
+        return NULL;
+    if ((*ar)->size + count < (*ar)->size)
     {
-        ++(*ar)->reserved;
-        ++(*ar)->size;
-        tmp = std_mem->fn_realloc(*ar, sizeof(ARRAY) + (*ar)->data_size * (*ar)->reserved);
-        if (tmp == NULL)
-            return NULL;
-        (*ar) = tmp;
+        error(ERROR_OUT_OF_MEMORY);
+        return NULL;
     }
-    return lib_array_at(*ar, std_mem, (*ar)->size - 1);
+    if ((*ar)->reserved < (*ar)->size + count && !lib_array_resize(ar, std_mem, (*ar)->size + count))
+        return NULL;
+    return (*ar);
 }
 
 void* lib_array_insert(ARRAY **ar, const STD_MEM* std_mem, unsigned int index)
 {
-    if (array_append(ar) == NULL)
+    if (lib_array_append(ar, std_mem) == NULL)
         return NULL;
     if (index >= (*ar)->size)
     {
@@ -105,6 +123,11 @@ ARRAY* lib_array_remove(ARRAY** ar, const STD_MEM* std_mem, unsigned int index)
     }
     memmove(ARRAY_DATA(*ar) + index * (*ar)->data_size, ARRAY_DATA(*ar) + (index + 1) * (*ar)->data_size, ((*ar)->size - index - 1) * (*ar)->data_size);
     --(*ar)->size;
+#if (KERNEL_ARRAY_SHRINK)
+    //less than quarter is used. Half reserved, so next appends will not cause realloc immediately
+    if ((*ar)->reserved >= ARRAY_SHRINK_MIN && (*ar)->size <= ((*ar)->reserved >> 2))
+        lib_array_resize(ar, std_mem, (*ar)->reserved >> 1);
+#endif //KERNEL_ARRAY_SHRINK
     return (*ar);
 }
 
@@ -112,8 +135,7 @@ ARRAY* lib_array_squeeze(ARRAY** ar, const STD_MEM* std_mem)
 {
     if (*ar == NULL)
         return NULL;
-    *ar = std_mem->fn_realloc(*ar, sizeof(ARRAY) + (*ar)->size * (*ar)->data_size);
-    (*ar)->reserved = (*ar)->size;
+    lib_array_resize(ar, std_mem, (*ar)->size);
     return (*ar);
 }
 
@@ -126,5 +148,6 @@ const LIB_ARRAY __LIB_ARRAY = {
     lib_array_insert,
     lib_array_clear,
     lib_array_remove,
-    lib_array_squeeze
+    lib_array_squeeze,
+    lib_array_reserve
 };
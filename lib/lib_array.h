@@ -23,6 +23,7 @@ void* lib_array_insert(ARRAY **ar, const STD_MEM* std_mem, unsigned int index);
 ARRAY* lib_array_clear(ARRAY **ar, const STD_MEM* std_mem);
 ARRAY* lib_array_remove(ARRAY** ar, const STD_MEM* std_mem, unsigned int index);
 ARRAY* lib_array_squeeze(ARRAY** ar, const STD_MEM* std_mem);
+ARRAY* lib_array_reserve(ARRAY** ar, const STD_MEM* std_mem, unsigned int count);
 
 
 #endif // LIB_ARRAY_H
@@ -121,6 +121,17 @@ unsigned int lib_so_count(SO* so, const STD_MEM* std_mem)
     return res;
 }
 
+SO* lib_so_reserve(SO* so, const STD_MEM* std_mem, unsigned int count)
+{
+    unsigned int idx;
+    //free handles will be reused first
+    for (idx = so->first_free; idx != SO_FREE && count; idx = SO_INDEX(SO_AT(so, std_mem, idx)))
+        --count;
+    if (!lib_array_reserve(&so->ar, std_mem, count))
+        return NULL;
+    return so;
+}
+
 const LIB_SO __LIB_SO = {
     lib_so_create,
     lib_so_destroy,
@@ -130,5 +141,6 @@ const LIB_SO __LIB_SO = {
     lib_so_get,
     lib_so_first,
     lib_so_next,
-    lib_so_count
+    lib_so_count,
+    lib_so_reserve
 };
@@ -11,19 +11,33 @@
 #include "../userspace/process.h"
 #include <string.h>
 
+#if (KERNEL_POOL_SEGREGATED)
+
+//next slot, previous slot with free flag
+#define SLOT_LINKS_SIZE                                         (2 * sizeof(void*))
+//free slot is holding next and previous in size class list
+#define SLOT_MIN_DATA_SIZE                                      (2 * sizeof(void*))
+
+#else
+
+#define SLOT_LINKS_SIZE                                         (sizeof(void*))
+#define SLOT_MIN_DATA_SIZE                                      (sizeof(int))
+
+#endif //(KERNEL_POOL_SEGREGATED)
+
 #if (KERNEL_RANGE_CHECKING)
 
-#define SLOT_HEADER_SIZE                                        (sizeof(void*) + sizeof(unsigned int))
+#define SLOT_HEADER_SIZE                                        (SLOT_LINKS_SIZE + sizeof(unsigned int))
 #define SLOT_FOOTER_SIZE                                        (sizeof (unsigned int))
 
 #else
 
-#define SLOT_HEADER_SIZE                                        (sizeof(void*))
+#define SLOT_HEADER_SIZE                                        (SLOT_LINKS_SIZE)
 #define SLOT_FOOTER_SIZE                                        (0)
 
 #endif //(KERNEL_RANGE_CHECKING)
 
-#define MIN_SLOT_FULL_SIZE                                        (SLOT_HEADER_SIZE + sizeof(int) + SLOT_FOOTER_SIZE)
+#define MIN_SLOT_FULL_SIZE                                        (SLOT_HEADER_SIZE + SLOT_MIN_DATA_SIZE + SLOT_FOOTER_SIZE)
 
 #define NEXT_SLOT(ptr)                                            (*(void**)((unsigned int)(ptr) - SLOT_HEADER_SIZE))
 #define NEXT_FREE(ptr)                                            (*(void**)(ptr))
@@ -56,6 +70,295 @@ static const unsigned int RANGE_MARK_POOL_END =                   0xeeeeeeee;
 #endif //(KERNEL_RANGE_CHECKING)
 
 
+#if (KERNEL_POOL_SEGREGATED)
+
+/*
+        segregated fit malloc
+
+        data slot:
+        SLOT_HEADER        <--- next slot (pointing to data AFTER SLOT_HEADER), previous slot | free flag
+        <data>            <--- returned pointer
+        <align to sizeof(int)>
+
+        free slot:
+        SLOT_HEADER        <--- next slot, previous slot | 1
+        <free bytes>    <--- next and previous free slots of same size class
+
+        last slot:
+        SLOT_HEADER        <--- NULL pointer here
+        unused tail
+
+        Free slots are linked in lists by size class: [8, 16) - class 0, [16, 32) - class 1 and so on.
+        Class lists heads are placed at start of pool data, pool->free_slot is pointing to them.
+        Request is rounded up to class, where any slot fits, so malloc and free are O(1).
+        Top class [16K, ...) has no upper bound, requests above 16K are first fit in it.
+        Neighbour free slots are always merged.
+*/
+
+#define POOL_CLASSES                                            12
+#define CLASS_MIN_SIZE(cls)                                     (8u << (cls))
+
+typedef struct {
+    unsigned int map;
+    void* heads[POOL_CLASSES];
+} POOL_CLASS_TABLE;
+
+#define CLASS_TABLE(pool)                                       ((POOL_CLASS_TABLE*)((pool)->free_slot))
+#define PREV_FIELD(ptr)                                         (*(unsigned int*)((unsigned int)(ptr) - SLOT_HEADER_SIZE + sizeof(void*)))
+#define PREV_SLOT(ptr)                                          ((void*)(PREV_FIELD(ptr) & ~1))
+#define IS_FREE(ptr)                                            (PREV_FIELD(ptr) & 1)
+#define PREV_FREE(ptr)                                          (*((void**)(ptr) + 1))
+#define SLOT_SIZE(ptr)                                          (NUM(NEXT_SLOT(ptr)) - NUM(ptr) - SLOT_HEADER_SIZE - SLOT_FOOTER_SIZE)
+#define SET_PREV_SLOT(ptr, prev)                                PREV_FIELD(ptr) = NUM(prev) | IS_FREE(ptr)
+
+static inline unsigned int size_class(unsigned int size)
+{
+    unsigned int res = 28 - __builtin_clz(size);
+    return res < POOL_CLASSES ? res : POOL_CLASSES - 1;
+}
+
+static void free_list_add(POOL* pool, void* ptr)
+{
+    POOL_CLASS_TABLE* table = CLASS_TABLE(pool);
+    unsigned int cls = size_class(SLOT_SIZE(ptr));
+    PREV_FIELD(ptr) |= 1;
+    NEXT_FREE(ptr) = table->heads[cls];
+    PREV_FREE(ptr) = NULL;
+    if (table->heads[cls] != NULL)
+        PREV_FREE(table->heads[cls]) = ptr;
+    table->heads[cls] = ptr;
+    table->map |= 1 << cls;
+}
+
+//must be called before slot size is changed
+static void free_list_remove(POOL* pool, void* ptr)
+{
+    POOL_CLASS_TABLE* table = CLASS_TABLE(pool);
+    unsigned int cls = size_class(SLOT_SIZE(ptr));
+    PREV_FIELD(ptr) &= ~1;
+    if (PREV_FREE(ptr) != NULL)
+        NEXT_FREE(PREV_FREE(ptr)) = NEXT_FREE(ptr);
+    else if ((table->heads[cls] = NEXT_FREE(ptr)) == NULL)
+        table->map &= ~(1 << cls);
+    if (NEXT_FREE(ptr) != NULL)
+        PREV_FREE(NEXT_FREE(ptr)) = PREV_FREE(ptr);
+}
+
+//merge slot with next one. Both must be out of free lists
+static void absorb_next(POOL* pool, void* ptr)
+{
+    void* next = NEXT_SLOT(ptr);
+    CLEAR_MARK(ptr);
+    CLEAR_MARK(next);
+    NEXT_SLOT(ptr) = NEXT_SLOT(next);
+    SET_PREV_SLOT(NEXT_SLOT(ptr), ptr);
+    SET_MARK(ptr);
+}
+
+//put slot to free list, merging with neighbours
+static void release(POOL* pool, void* ptr)
+{
+    void* prev;
+    if (NEXT_SLOT(ptr) != pool->last_slot && IS_FREE(NEXT_SLOT(ptr)))
+    {
+        free_list_remove(pool, NEXT_SLOT(ptr));
+        absorb_next(pool, ptr);
+    }
+    prev = PREV_SLOT(ptr);
+    if (prev != NULL && IS_FREE(prev))
+    {
+        free_list_remove(pool, prev);
+        absorb_next(pool, prev);
+        ptr = prev;
+    }
+    free_list_add(pool, ptr);
+}
+
+//free space at end of used slot
+static void split(POOL* pool, void* ptr, size_t len)
+{
+    void* next = NEXT_SLOT(ptr);
+    void* new_slot = (void*)(NUM(ptr) + SLOT_HEADER_SIZE + len + SLOT_FOOTER_SIZE);
+    if (NUM(new_slot) + MIN_SLOT_FULL_SIZE <= NUM(next))
+    {
+        CLEAR_MARK(ptr);
+        NEXT_SLOT(new_slot) = next;
+        PREV_FIELD(new_slot) = NUM(ptr);
+        NEXT_SLOT(ptr) = new_slot;
+        SET_PREV_SLOT(next, new_slot);
+        SET_MARK(ptr);
+        SET_MARK(new_slot);
+        release(pool, new_slot);
+    }
+}
+
+void pool_init(POOL* pool, void* data)
+{
+    pool->free_slot = (void*)ALIGN(NUM(data));
+    memset(pool->free_slot, 0, sizeof(POOL_CLASS_TABLE));
+    // _sbrk implementation
+    pool->first_slot = pool->last_slot = (void*)(NUM(pool->free_slot) + sizeof(POOL_CLASS_TABLE) + SLOT_HEADER_SIZE);
+    NEXT_SLOT(pool->first_slot) = NULL;
+    PREV_FIELD(pool->first_slot) = 0;
+    SET_MARK(pool->first_slot);
+}
+
+static bool grow(POOL* pool, size_t size, void* sp)
+{
+    register void *new_last, *last;
+    last = pool->last_slot;
+    if (NEXT_SLOT(last) != NULL)
+    {
+        error(ERROR_POOL_CORRUPTED);
+        return false;
+    }
+
+    new_last = (void*)(NUM(last) + SLOT_HEADER_SIZE + size + SLOT_FOOTER_SIZE);
+    //check uint overflow and compare with stack
+    if (NUM(new_last) < NUM(last) || NUM(new_last) >= NUM(sp))
+    {
+        error(ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    //_brk implementation
+    CLEAR_MARK(last);
+    NEXT_SLOT(last) = new_last;
+    NEXT_SLOT(new_last) = NULL;
+    PREV_FIELD(new_last) = NUM(last);
+    SET_MARK(last);
+    SET_MARK(new_last);
+
+    pool->last_slot = new_last;
+    release(pool, last);
+    return true;
+}
+
+void* pool_malloc(POOL* pool, size_t size, void* sp)
+{
+    size_t len;
+    register void *cur;
+    unsigned int cls, fit, map;
+    int i;
+
+    len = ALIGN(size);
+    if (size == 0)
+        return NULL;
+    if (len < SLOT_MIN_DATA_SIZE)
+        len = SLOT_MIN_DATA_SIZE;
+    if (NUM(pool->last_slot) + len < NUM(pool->last_slot))
+    {
+        error(ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    cls = size_class(len);
+    //lowest class, where any slot fits
+    fit = len > CLASS_MIN_SIZE(cls) ? cls + 1 : cls;
+
+    for (i = 0; i < 2; ++i)
+    {
+        map = CLASS_TABLE(pool)->map & ~((1 << fit) - 1);
+        if (map)
+            cur = CLASS_TABLE(pool)->heads[__builtin_ctz(map)];
+        //only head of own class is tried, it may fit
+        else if ((cur = CLASS_TABLE(pool)->heads[cls]) != NULL && SLOT_SIZE(cur) < len)
+        {
+            //no upper class for top one
+            if (cls == POOL_CLASSES - 1)
+                for (cur = NEXT_FREE(cur); cur != NULL && SLOT_SIZE(cur) < len; cur = NEXT_FREE(cur)) {}
+            else
+                cur = NULL;
+        }
+        if (cur != NULL)
+        {
+            free_list_remove(pool, cur);
+            split(pool, cur, len);
+            return cur;
+        }
+        //try to allocate more space
+        if (!grow(pool, len, sp))
+            break;
+    }
+    return NULL;
+}
+
+size_t pool_slot_size(POOL* poll, void* ptr)
+{
+    if (ptr == NULL)
+        return 0;
+    return SLOT_SIZE(ptr);
+}
+
+void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
+{
+    void *res;
+    unsigned int cur_size;
+    unsigned int len = ALIGN(size);
+    int i;
+
+    if (ptr == NULL)
+        return pool_malloc(pool, len, sp);
+    if (len == 0)
+    {
+        pool_free(pool, ptr);
+        return NULL;
+    }
+    if (len < SLOT_MIN_DATA_SIZE)
+        len = SLOT_MIN_DATA_SIZE;
+    cur_size = SLOT_SIZE(ptr);
+
+    for (i = 0; i < 2; ++i)
+    {
+        //next is free? append!
+        if (NEXT_SLOT(ptr) != pool->last_slot && IS_FREE(NEXT_SLOT(ptr)))
+        {
+            free_list_remove(pool, NEXT_SLOT(ptr));
+            absorb_next(pool, ptr);
+        }
+        //at end of pool? grow!
+        if (len <= SLOT_SIZE(ptr) || NEXT_SLOT(ptr) != pool->last_slot)
+            break;
+        if (!grow(pool, len - SLOT_SIZE(ptr), sp))
+            break;
+    }
+
+    //slot enough size?
+    if (len <= SLOT_SIZE(ptr))
+    {
+        split(pool, ptr, len);
+        return ptr;
+    }
+
+    //can't extend. Allocate in other place and copy.
+    res = pool_malloc(pool, size, sp);
+    if (res)
+    {
+        memcpy(res, ptr, cur_size);
+        pool_free(pool, ptr);
+    }
+    return res;
+}
+
+void pool_free(POOL* pool, void* ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    if (
+         //not in pool or already free?
+         NUM(ptr) < NUM(pool->first_slot) || NUM(ptr) >= NUM(pool->last_slot) || IS_FREE(ptr)
+         //next after current slot is broken?
+         || NUM(NEXT_SLOT(ptr)) <= NUM(ptr) || NUM(NEXT_SLOT(ptr)) > NUM(pool->last_slot) || PREV_SLOT(NEXT_SLOT(ptr)) != ptr
+         //previous slot is broken?
+         || (PREV_SLOT(ptr) != NULL && NEXT_SLOT(PREV_SLOT(ptr)) != ptr))
+    {
+        error(ERROR_POOL_CORRUPTED);
+        return;
+    }
+    release(pool, ptr);
+}
+
+#else
+
 /*
         malloc
 
@@ -297,6 +600,8 @@ void pool_free(POOL* pool, void* ptr)
     }
 }
 
+#endif //KERNEL_POOL_SEGREGATED
+
 #if (KERNEL_PROFILING)
 
 void* pool_free_ptr(POOL* pool)
@@ -304,13 +609,29 @@ void* pool_free_ptr(POOL* pool)
     return pool->last_slot + SLOT_HEADER_SIZE;
 }
 
+#if (KERNEL_RANGE_CHECKING)
+static bool check_marks(void* cur)
+{
+    //check header
+    if (*((unsigned int*)(cur) - 1) != RANGE_MARK)
+        return false;
+    //check footer
+    if (NEXT_SLOT(cur))
+        return *(unsigned int*)((unsigned int)NEXT_SLOT(cur) - SLOT_HEADER_SIZE - SLOT_FOOTER_SIZE) == RANGE_MARK_END;
+    //last slot
+    return *(unsigned int*)(cur) == RANGE_MARK_POOL_END;
+}
+#endif //(KERNEL_RANGE_CHECKING)
+
+#if (KERNEL_POOL_SEGREGATED)
+
 bool pool_check(POOL* pool, void* sp)
 {
     register void *before, *cur;
+    unsigned int cls, free_count;
     //basic check
-    if (pool->first_slot == NULL || pool->last_slot == NULL ||
-         NUM(pool->first_slot) > NUM(pool->last_slot) ||
-         NUM(pool->free_slot) > NUM(pool->last_slot) || NEXT_SLOT(pool->last_slot) != NULL)
+    if (pool->first_slot == NULL || pool->last_slot == NULL || NUM(pool->free_slot) >= NUM(pool->first_slot) ||
+         NUM(pool->first_slot) > NUM(pool->last_slot) || NEXT_SLOT(pool->last_slot) != NULL)
     {
         error(ERROR_POOL_CORRUPTED);
         return false;
@@ -321,44 +642,105 @@ bool pool_check(POOL* pool, void* sp)
         return false;
     }
     //check all slots first
-    for (before = NULL, cur = pool->first_slot; cur != NULL; before = cur, cur = NEXT_SLOT(cur))
+    for (free_count = 0, before = NULL, cur = pool->first_slot; cur != NULL; before = cur, cur = NEXT_SLOT(cur))
     {
-        if (NUM(cur) < NUM(before) || NUM(cur) > NUM(pool->last_slot))
+        if (NUM(cur) < NUM(before) || NUM(cur) > NUM(pool->last_slot) || PREV_SLOT(cur) != before)
         {
             error(ERROR_POOL_CORRUPTED);
             return false;
         }
 #if (KERNEL_RANGE_CHECKING)
-        //check header
-        if (*((unsigned int*)(cur) - 1) != RANGE_MARK)
+        if (!check_marks(cur))
         {
             error(ERROR_POOL_RANGE_CHECK_FAILED);
             return false;
         }
+#endif //(KERNEL_RANGE_CHECKING)
+        if (IS_FREE(cur))
+            ++free_count;
+    }
 
-        if (NEXT_SLOT(cur))
+    //check free slots. Each free slot must be in list of own class
+    for (cls = 0; cls < POOL_CLASSES; ++cls)
+    {
+        if ((CLASS_TABLE(pool)->heads[cls] == NULL) != ((CLASS_TABLE(pool)->map & (1 << cls)) == 0))
+        {
+            error(ERROR_POOL_CORRUPTED);
+            return false;
+        }
+        for (before = NULL, cur = CLASS_TABLE(pool)->heads[cls]; cur != NULL; before = cur, cur = NEXT_FREE(cur))
         {
-            //check footer
-            if (*(unsigned int*)((unsigned int)NEXT_SLOT(cur) - SLOT_HEADER_SIZE - SLOT_FOOTER_SIZE) != RANGE_MARK_END)
+            if (free_count-- == 0 || NUM(cur) < NUM(pool->first_slot) || NUM(cur) >= NUM(pool->last_slot) ||
+                !IS_FREE(cur) || PREV_FREE(cur) != before || size_class(SLOT_SIZE(cur)) != cls)
             {
-                error(ERROR_POOL_RANGE_CHECK_FAILED);
+                error(ERROR_POOL_CORRUPTED);
                 return false;
             }
         }
-        //last slot
-        else
+    }
+    if (free_count)
+    {
+        error(ERROR_POOL_CORRUPTED);
+        return false;
+    }
+    return true;
+}
+
+void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
+{
+    void *cur;
+    unsigned int size;
+    memset(stat, 0, sizeof(POOL_STAT));
+    if (pool_check(pool, sp))
+    {
+        for (cur = pool->first_slot; cur != pool->last_slot; cur = NEXT_SLOT(cur))
         {
-            if (*(unsigned int*)(cur) != RANGE_MARK_POOL_END)
+            size = SLOT_SIZE(cur);
+            if (IS_FREE(cur))
             {
-                error(ERROR_POOL_RANGE_CHECK_FAILED);
-                return false;
+                ++stat->free_slots;
+                if (size > stat->largest_free)
+                    stat->largest_free = size;
+                stat->free += size;
+            }
+            else
+            {
+                ++stat->used_slots;
+                stat->used += size;
             }
         }
-#endif //(KERNEL_RANGE_CHECKING)
     }
+    //space between last_slot and sp possibly can grow
+    if (NUM(sp) >= NUM(pool->last_slot) + sizeof(unsigned int) + MIN_SLOT_FULL_SIZE)
+    {
+        size = NUM(sp) - NUM(pool->last_slot) - MIN_SLOT_FULL_SIZE;
+        ++stat->free_slots;
+        if (size > stat->largest_free)
+            stat->largest_free = size;
+        stat->free += size;
+    }
+}
 
-    //check free slots
-    for (before = NULL, cur = pool->free_slot; cur != NULL; before = cur, cur = NEXT_FREE(cur))
+#else
+
+bool pool_check(POOL* pool, void* sp)
+{
+    register void *before, *cur;
+    //basic check
+    if (pool->first_slot == NULL || pool->last_slot == NULL ||
+         NUM(pool->first_slot) > NUM(pool->last_slot) ||
+         NUM(pool->free_slot) > NUM(pool->last_slot) || NEXT_SLOT(pool->last_slot) != NULL)
+    {
+        error(ERROR_POOL_CORRUPTED);
+        return false;
+    }
+    if (NUM(sp) < NUM(pool->last_slot))
+    {
+        error(ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    //check all slots first
+    for (before = NULL, cur = pool->first_slot; cur != NULL; before = cur, cur = NEXT_SLOT(cur))
     {
         if (NUM(cur) < NUM(before) || NUM(cur) > NUM(pool->last_slot))
         {
@@ -366,30 +748,27 @@ bool pool_check(POOL* pool, void* sp)
             return false;
         }
 #if (KERNEL_RANGE_CHECKING)
-        //check header
-        if (*((unsigned int*)(cur) - 1) != RANGE_MARK)
+        if (!check_marks(cur))
         {
             error(ERROR_POOL_RANGE_CHECK_FAILED);
             return false;
         }
+#endif //(KERNEL_RANGE_CHECKING)
+    }
 
-        if (NEXT_SLOT(cur))
+    //check free slots
+    for (before = NULL, cur = pool->free_slot; cur != NULL; before = cur, cur = NEXT_FREE(cur))
+    {
+        if (NUM(cur) < NUM(before) || NUM(cur) > NUM(pool->last_slot))
         {
-            //check footer
-            if (*(unsigned int*)((unsigned int)NEXT_SLOT(cur) - SLOT_HEADER_SIZE - SLOT_FOOTER_SIZE) != RANGE_MARK_END)
-            {
-                error(ERROR_POOL_RANGE_CHECK_FAILED);
-                return false;
-            }
+            error(ERROR_POOL_CORRUPTED);
+            return false;
         }
-        //last slot
-        else
+#if (KERNEL_RANGE_CHECKING)
+        if (!check_marks(cur))
         {
-            if (*(unsigned int*)(cur) != RANGE_MARK_POOL_END)
-            {
-                error(ERROR_POOL_RANGE_CHECK_FAILED);
-                return false;
-            }
+            error(ERROR_POOL_RANGE_CHECK_FAILED);
+            return false;
         }
 #endif //(KERNEL_RANGE_CHECKING)
     }
@@ -434,4 +813,6 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
     }
 }
 
+#endif //KERNEL_POOL_SEGREGATED
+
 #endif //KERNEL_PROFILING
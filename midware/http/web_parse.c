@@ -15,6 +15,8 @@ const char* const __HTTP_URL_HEAD =       "http://";
 
 const char* const __HTTP_VER =            "HTTP/";
 
+const char* const __HTTP_CONTENT_LENGTH = "content-length";
+
 const char* const __HTTP_METHODS[HTTP_METHODS_COUNT] =
                                          {"GET",
                                           "HEAD",
@@ -210,7 +212,7 @@ bool web_url_to_relative(char** url, unsigned int* url_size)
     //absolute?
     if ((*url)[0] != '/')
     {
-        if (!web_stricmp((*url), (*url_size), __HTTP_URL_HEAD))
+        if ((*url_size) < HTTP_URL_HEAD_LEN || !web_stricmp((*url), HTTP_URL_HEAD_LEN, __HTTP_URL_HEAD))
             return false;
         (*url_size) -= HTTP_URL_HEAD_LEN;
         (*url) += HTTP_URL_HEAD_LEN;
@@ -18,6 +18,9 @@ extern const char* const __HTTP_URL_HEAD;
 #define HTTP_VER_LEN                            5
 extern const char* const __HTTP_VER;
 
+#define HTTP_CONTENT_LENGTH_LEN                 14
+extern const char* const __HTTP_CONTENT_LENGTH;
+
 #define HTTP_METHODS_COUNT                      8
 extern const char* const __HTTP_METHODS[HTTP_METHODS_COUNT];
 
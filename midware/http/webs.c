@@ -36,11 +36,27 @@ typedef enum {
     WEBS_SESSION_STATE_TX
 } WEBS_SESSION_STATE;
 
+typedef enum {
+    WEBS_PARSE_REQUEST_LINE,
+    WEBS_PARSE_HEADERS,
+    WEBS_PARSE_BODY
+} WEBS_PARSE_STATE;
+
 typedef struct {
+    //response header and tx
     IO* io;
+    //received from connection, processed up to rx_pos. Rest belongs to body or to next request
+    IO* rx;
+    //handler read, waiting for body from connection
+    IO* user_io;
+    //request line and headers. Allocated once with session
     char* req;
     char* url;
-    unsigned int req_size, header_size, status_line_size, data_size, url_size, processed;
+    char* tx;
+    unsigned int req_size, scanned, parsed, header_size, status_line_size, data_size, url_size;
+    //body part, taken by handler from req, body received from connection, body left unread by handler on previous request
+    unsigned int body_pos, body_rx, skip;
+    unsigned int rx_pos, user_size, tx_size, processed;
     HANDLE conn, node_handle, self;
 #if (WEBS_SESSION_TIMEOUT_S)
     HANDLE timer;
@@ -49,8 +65,10 @@ typedef struct {
     IP remote_addr;
 #endif //WEBS_DEBUG_SESSION
     WEBS_SESSION_STATE state;
+    WEBS_PARSE_STATE parse;
     HTTP_VERSION version;
     WEB_METHOD method;
+    bool close;
 } WEBS_SESSION;
 
 typedef struct {
@@ -127,12 +145,12 @@ static const unsigned int __CODE_SIZE[] =             {2, 7, 8, 27, 6};
 
 #define HTTP_STATUS_LINE_SIZE                   15
 
-static inline void web_free_req(WEBS_SESSION* session)
+static inline void web_free_tx(WEBS_SESSION* session)
 {
-    if(session->req == NULL)
+    if(session->tx == NULL)
         return;
-    free(session->req);
-    session->req = NULL;
+    free(session->tx);
+    session->tx = NULL;
 }
 
 static inline void webs_init(WEBS* webs)
@@ -161,8 +179,13 @@ static const char* webs_get_response_text(WEB_RESPONSE code)
 
 static void webs_session_reset(WEBS_SESSION* session)
 {
-    web_free_req(session);
-    session->req_size = session->header_size = session->data_size = 0;
+    web_free_tx(session);
+    //body, not read by handler, is skipped before next request
+    if (session->data_size > session->body_rx)
+        session->skip += session->data_size - session->body_rx;
+    session->req_size = session->scanned = session->parsed = session->header_size = session->data_size = 0;
+    session->body_pos = session->body_rx = 0;
+    session->parse = WEBS_PARSE_REQUEST_LINE;
     session->state = WEBS_SESSION_STATE_IDLE;
 }
 
@@ -181,13 +204,22 @@ static inline WEBS_SESSION* webs_create_session(WEBS* webs)
     session = so_get(&webs->sessions, h);
     if (session == NULL)
         return NULL;
-    session->state = WEBS_SESSION_STATE_IDLE;
-    session->req = NULL;
-    session->req_size = session->header_size = session->data_size = 0;
+    session->user_io = NULL;
+    session->tx = NULL;
+    session->data_size = session->body_rx = session->skip = 0;
+    session->close = false;
+    webs_session_reset(session);
+    session->rx_pos = 0;
     session->io = io_create(WEBS_IO_SIZE + sizeof(TCP_STACK));
+    session->rx = io_create(WEBS_IO_SIZE + sizeof(TCP_STACK));
+    //header is parsed after each chunk is appended, so whole chunk always fits
+    session->req = malloc(WEBS_HEADER_SIZE + WEBS_IO_SIZE);
     session->self = h;
-    if (session->io == NULL)
+    if (session->io == NULL || session->rx == NULL || session->req == NULL)
     {
+        io_destroy(session->io);
+        io_destroy(session->rx);
+        free(session->req);
         so_free(&webs->sessions, h);
         return NULL;
     }
@@ -200,15 +232,43 @@ static inline WEBS_SESSION* webs_create_session(WEBS* webs)
 
 static void webs_destroy_session(WEBS* webs, WEBS_SESSION* session)
 {
-    web_free_req(session);
+    web_free_tx(session);
+    free(session->req);
 #if (WEBS_SESSION_TIMEOUT_S)
     timer_stop(session->timer, session->self, HAL_WEBS);
     timer_destroy(session->timer);
 #endif //WEBS_SESSION_TIMEOUT_S
     io_destroy(session->io);
+    io_destroy(session->rx);
     so_free(&webs->sessions, session->self);
 }
 
+static inline unsigned int webs_rx_avail(WEBS_SESSION* session)
+{
+    return session->rx->data_size - session->rx_pos;
+}
+
+//all received data is processed
+static void webs_rx(WEBS* webs, WEBS_SESSION* session)
+{
+    session->rx_pos = session->rx->data_size = 0;
+    tcp_read(webs->tcpip, session->conn, session->rx, WEBS_IO_SIZE);
+}
+
+//body from rx to handler. Data after body is kept for next request
+static void webs_body_copy(WEBS* webs, WEBS_SESSION* session, IO* io, unsigned int size)
+{
+    if (size > session->data_size - session->body_rx)
+        size = session->data_size - session->body_rx;
+    if (size > webs_rx_avail(session))
+        size = webs_rx_avail(session);
+    memcpy(io_data(io), (uint8_t*)io_data(session->rx) + session->rx_pos, size);
+    io->data_size = size;
+    session->rx_pos += size;
+    session->body_rx += size;
+    io_complete(webs->process, HAL_IO_CMD(HAL_WEBS, IPC_READ), session->self, io);
+}
+
 static inline void webs_open_session(WEBS* webs, HANDLE conn)
 {
     WEBS_SESSION* session = webs_create_session(webs);
@@ -232,7 +292,7 @@ static inline void webs_open_session(WEBS* webs, HANDLE conn)
     timer_start_ms(session->timer, WEBS_SESSION_TIMEOUT_S * 1000);
 #endif //WEBS_SESSION_TIMEOUT_S
 
-    tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
+    webs_rx(webs, session);
 }
 
 static inline void webs_close_session(WEBS* webs, WEBS_SESSION* session)
@@ -275,14 +335,14 @@ static void webs_tx(WEBS* webs, WEBS_SESSION* session)
     TCP_STACK* tcp_stack;
     tcp_stack = io_push(session->io, sizeof(TCP_STACK));
     session->io->data_size = WEBS_IO_SIZE;
-    if (session->req_size - session->processed < WEBS_IO_SIZE)
+    if (session->tx_size - session->processed < WEBS_IO_SIZE)
     {
         tcp_stack->flags = 0;
-        session->io->data_size = session->req_size - session->processed;
+        session->io->data_size = session->tx_size - session->processed;
     }
     else
         tcp_stack->flags = TCP_PSH;
-    memcpy(io_data(session->io), session->req + session->processed, session->io->data_size);
+    memcpy(io_data(session->io), session->tx + session->processed, session->io->data_size);
     tcp_write(webs->tcpip, session->conn, session->io);
 }
 
@@ -305,23 +365,23 @@ static void webs_send_response(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE c
     status_line_size = HTTP_STATUS_LINE_SIZE + strlen(webs_get_response_text(code));
     webs_generate_params(session, data_size);
     header_size = status_line_size + session->io->data_size + 2;
-    web_free_req(session);
-    session->req = malloc(header_size + data_size);
+    web_free_tx(session);
+    session->tx = malloc(header_size + data_size);
 
-    if (session->req == NULL)
+    if (session->tx == NULL)
     {
         webs_out_of_memory(webs, session);
         return;
     }
 
     //status line
-    sprintf(session->req, "HTTP/%d.%d %d %s\r\n", session->version >> 4, session->version & 0xf, code, webs_get_response_text(code));
+    sprintf(session->tx, "HTTP/%d.%d %d %s\r\n", session->version >> 4, session->version & 0xf, code, webs_get_response_text(code));
 
     //header, generated in io
-    memcpy(session->req + status_line_size, io_data(session->io), session->io->data_size);
-    sprintf(session->req + status_line_size + session->io->data_size, "\r\n");
-    memcpy(session->req + header_size, data, data_size);
-    session->req_size = header_size + data_size;
+    memcpy(session->tx + status_line_size, io_data(session->io), session->io->data_size);
+    sprintf(session->tx + status_line_size + session->io->data_size, "\r\n");
+    memcpy(session->tx + header_size, data, data_size);
+    session->tx_size = header_size + data_size;
     session->processed = 0;
     session->state = WEBS_SESSION_STATE_TX;
 
@@ -330,7 +390,7 @@ static void webs_send_response(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE c
 #endif //WEBS_DEBUG_REQUESTS
 #if (WEBS_DEBUG_FLOW)
     printf("WEBS TX:\n");
-    web_print(session->req, session->req_size);
+    web_print(session->tx, session->tx_size);
 #endif //WEBS_DEBUG_FLOW
 
 #if (WEBS_SESSION_TIMEOUT_S)
@@ -407,16 +467,49 @@ static inline void webs_close(WEBS* webs, HANDLE process)
     webs->process = INVALID_HANDLE;
 }
 
-static inline void webs_user_read(WEBS* webs, WEBS_SESSION* session, IO* io)
+static inline void webs_user_read(WEBS* webs, WEBS_SESSION* session, IO* io, unsigned int size_max)
 {
+    unsigned int size = io_get_free(io);
     io->data_size = 0;
-    if (io_get_free(io) < session->data_size)
+    if (size > size_max)
+        size = size_max;
+    if (session->user_io != NULL)
+    {
+        error(ERROR_IN_PROGRESS);
+        return;
+    }
+    //zero size on end of body
+    if (session->body_pos == session->req_size && session->body_rx == session->data_size)
+    {
+        io_complete(webs->process, HAL_IO_CMD(HAL_WEBS, IPC_READ), session->self, io);
+        error(ERROR_SYNC);
+        return;
+    }
+    if (size == 0)
     {
         error(ERROR_IO_BUFFER_TOO_SMALL);
         return;
     }
-    memcpy(io_data(io), session->req + session->header_size, session->data_size);
-    io->data_size = session->data_size;
+    //body part, received with header
+    if (session->body_pos < session->req_size)
+    {
+        if (size > session->req_size - session->body_pos)
+            size = session->req_size - session->body_pos;
+        memcpy(io_data(io), session->req + session->body_pos, size);
+        io->data_size = size;
+        session->body_pos += size;
+        io_complete(webs->process, HAL_IO_CMD(HAL_WEBS, IPC_READ), session->self, io);
+    }
+    else if (webs_rx_avail(session))
+        webs_body_copy(webs, session, io, size);
+    else
+    {
+        //wait for rest of body from connection
+        session->user_io = io;
+        session->user_size = size;
+        webs_rx(webs, session);
+    }
+    error(ERROR_SYNC);
 }
 
 static inline void webs_user_write(WEBS* webs, WEBS_SESSION* session, IO* io)
@@ -436,7 +529,7 @@ static inline void webs_user_write(WEBS* webs, WEBS_SESSION* session, IO* io)
             webs->busy = true;
             cur_session->state = WEBS_SESSION_STATE_REQUEST;
             ipc_post_inline(webs->process, HAL_CMD(HAL_WEBS, (WEBS_GET + cur_session->method)), cur_session->self,
-                            cur_session->node_handle, cur_session->req_size);
+                            cur_session->node_handle, cur_session->data_size);
             break;
         }
     }
@@ -585,7 +678,7 @@ static inline void webs_session_request(WEBS* webs, IPC* ipc)
     switch (HAL_ITEM(ipc->cmd))
     {
     case IPC_READ:
-        webs_user_read(webs, session, (IO*)ipc->param2);
+        webs_user_read(webs, session, (IO*)ipc->param2, ipc->param3);
         break;
     case IPC_WRITE:
         webs_user_write(webs, session, (IO*)ipc->param2);
@@ -631,156 +724,241 @@ static inline void webs_request(WEBS* webs, IPC* ipc)
     }
 }
 
-static inline void webs_req_received(WEBS* webs, WEBS_SESSION* session)
+static bool webs_parse_request_line(WEBS_SESSION* session, char* str, unsigned int size)
 {
-    char* str;
-    unsigned int pos, size;
-    do {
-        io_reset(session->io);
-        //parse status line
-        //<METHOD> <URL> HTTP/<VERSION>
-        str = session->req;
-        size = web_get_line_size(session->req, session->header_size) - 2;
-
-        //method
-        if ((pos = web_get_word(str, size, ' ')) == 0)
-            break;
-        if (!web_get_method(str, pos, &session->method))
-            break;
-        size -= pos + 1;
-        str += pos + 1;
+    unsigned int pos;
+    //<METHOD> <URL> HTTP/<VERSION>
+    //method
+    if ((pos = web_get_word(str, size, ' ')) == 0 || pos == size)
+        return false;
+    if (!web_get_method(str, pos, &session->method))
+        return false;
+    size -= pos + 1;
+    str += pos + 1;
+
+    //URL. Pointing to req, which is never reallocated
+    session->url = str;
+    if ((pos = web_get_word(str, size, ' ')) == 0 || pos == size)
+        return false;
+    session->url_size = pos;
+    if (!web_url_to_relative(&session->url, &session->url_size))
+        return false;
+    size -= pos + 1;
+    str += pos + 1;
+
+    //version
+    return size > HTTP_VER_LEN && web_get_version(str, size, &session->version);
+}
 
-        //URL
-        session->url = str;
-        if ((pos = web_get_word(str, size, ' ')) == 0)
-            break;
-        session->url_size = pos;
-        if (!web_url_to_relative(&session->url, &session->url_size))
-            break;
-        size -= pos + 1;
-        str += pos + 1;
+static bool webs_parse_header_line(WEBS_SESSION* session, char* str, unsigned int size)
+{
+    char* delim;
+    unsigned int value_size;
+    if ((delim = memchr(str, ':', size)) == NULL)
+        return false;
+    //body framing is only required by server itself. Rest of params are found on handler request
+    if ((delim - str == HTTP_CONTENT_LENGTH_LEN) && web_stricmp(str, delim - str, __HTTP_CONTENT_LENGTH))
+    {
+        value_size = size - (delim - str) - 1;
+        delim = web_trim(delim + 1, &value_size);
+        return web_atou(delim, value_size, &session->data_size);
+    }
+    return true;
+}
 
-        //version
-        if (!web_get_version(str, size, &session->version))
-            break;
-        if (session->version > HTTP_1_1)
+//parse lines, completed since last call. WEB_RESPONSE_CONTINUE if header is still not received
+static WEB_RESPONSE webs_parse(WEBS_SESSION* session)
+{
+    char* str;
+    char* end;
+    unsigned int size;
+    while ((end = memchr(session->req + session->scanned, '\n', session->req_size - session->scanned)) != NULL)
+    {
+        str = session->req + session->parsed;
+        size = end - str + 1;
+        session->parsed = session->scanned = session->parsed + size;
+        //CRLF terminated
+        if (size < 2 || end[-1] != '\r')
+            return WEB_RESPONSE_BAD_REQUEST;
+        size -= 2;
+        switch (session->parse)
         {
-            session->version = HTTP_1_1;
-            webs_respond_error(webs, session, WEB_RESPONSE_HTTP_VERSION_NOT_SUPPORTED);
-            return;
+        case WEBS_PARSE_REQUEST_LINE:
+            //empty lines before request line are ignored, RFC 7230 3.5
+            if (size == 0)
+                break;
+            if (!webs_parse_request_line(session, str, size))
+                return WEB_RESPONSE_BAD_REQUEST;
+            if (session->version > HTTP_1_1)
+            {
+                session->version = HTTP_1_1;
+                return WEB_RESPONSE_HTTP_VERSION_NOT_SUPPORTED;
+            }
+            session->status_line_size = session->parsed;
+            session->parse = WEBS_PARSE_HEADERS;
+            break;
+        default:
+            //Header ends with double CRLF
+            if (size == 0)
+            {
+                session->header_size = session->parsed;
+                session->parse = WEBS_PARSE_BODY;
+                return WEB_RESPONSE_OK;
+            }
+            if (!webs_parse_header_line(session, str, size))
+                return WEB_RESPONSE_BAD_REQUEST;
         }
+    }
+    session->scanned = session->req_size;
+    return WEB_RESPONSE_CONTINUE;
+}
+
+//request can't be continued. Connection is closed after response
+static void webs_reject(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE code)
+{
+    session->close = true;
+    session->data_size = 0;
+    //response header is generated in io
+    io_reset(session->io);
+    webs_respond_error(webs, session, code);
+}
+
+static inline void webs_req_received(WEBS* webs, WEBS_SESSION* session)
+{
+    io_reset(session->io);
 
 #if (WEBS_DEBUG_REQUESTS)
-        printf("WEBS: %s ", __HTTP_METHODS[session->method]);
-        web_print(session->url, session->url_size);
-        printf("\n");
+    printf("WEBS: %s ", __HTTP_METHODS[session->method]);
+    web_print(session->url, session->url_size);
+    printf("\n");
 #endif //WEBS_DEBUG_REQUESTS
 
-        //check url path and method
-        session->node_handle = web_node_find_path(&webs->web_node, session->url, session->url_size);
-        if (session->node_handle == INVALID_HANDLE)
-        {
-            webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
-            return;
-        }
-        if (!web_node_check_flag(&webs->web_node, session->node_handle, 1 << session->method))
-        {
-            webs_respond_error(webs, session, WEB_RESPONSE_METHOD_NOT_ALLOWED);
-            return;
-        }
+    //check url path and method
+    session->node_handle = web_node_find_path(&webs->web_node, session->url, session->url_size);
+    if (session->node_handle == INVALID_HANDLE)
+    {
+        webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
+        return;
+    }
+    if (!web_node_check_flag(&webs->web_node, session->node_handle, 1 << session->method))
+    {
+        webs_respond_error(webs, session, WEB_RESPONSE_METHOD_NOT_ALLOWED);
+        return;
+    }
 
-        if (webs->busy)
-            session->state = WEBS_SESSION_STATE_PENDING;
-        else
-        {
-            webs->busy = true;
-            session->state = WEBS_SESSION_STATE_REQUEST;
-            ipc_post_inline(webs->process, HAL_CMD(HAL_WEBS, (WEBS_GET + session->method)), session->self, session->node_handle, session->req_size);
-        }
+    if (webs->busy)
+        session->state = WEBS_SESSION_STATE_PENDING;
+    else
+    {
+        webs->busy = true;
+        session->state = WEBS_SESSION_STATE_REQUEST;
+        ipc_post_inline(webs->process, HAL_CMD(HAL_WEBS, (WEBS_GET + session->method)), session->self, session->node_handle, session->data_size);
+    }
+}
+
+static void webs_session_parse_rx(WEBS* webs, WEBS_SESSION* session)
+{
+    unsigned int len;
+    WEB_RESPONSE code;
+    //tail of previous request body
+    len = webs_rx_avail(session);
+    if (session->skip)
+    {
+        if (len > session->skip)
+            len = session->skip;
+        session->skip -= len;
+        session->rx_pos += len;
+        len = webs_rx_avail(session);
+    }
+    if (len == 0)
+    {
+        webs_rx(webs, session);
+        return;
+    }
+    session->state = WEBS_SESSION_STATE_RX;
+
+    //only new data is scanned
+    memcpy(session->req + session->req_size, (uint8_t*)io_data(session->rx) + session->rx_pos, len);
+    session->req_size += len;
+    session->rx_pos += len;
+    code = webs_parse(session);
+
+    if (code == WEB_RESPONSE_CONTINUE && session->req_size < WEBS_HEADER_SIZE)
+    {
+        webs_rx(webs, session);
+        return;
+    }
+    if (code == WEB_RESPONSE_CONTINUE || session->header_size > WEBS_HEADER_SIZE || session->data_size > WEBS_MAX_PAYLOAD)
+        code = WEB_RESPONSE_PAYLOAD_TOO_LARGE;
+    if (code != WEB_RESPONSE_OK)
+    {
+        webs_reject(webs, session, code);
         return;
-    } while (false);
-    webs_respond_error(webs, session, WEB_RESPONSE_BAD_REQUEST);
+    }
+
+    //body part, received with header. Next request is returned to rx
+    if (session->req_size > session->header_size + session->data_size)
+    {
+        len = session->req_size - session->header_size - session->data_size;
+        session->req_size -= len;
+        session->rx_pos -= len;
+    }
+    session->body_pos = session->header_size;
+    session->body_rx = session->req_size - session->header_size;
+
+#if (WEBS_DEBUG_FLOW)
+    printf("WEBS RX:\n");
+    web_print(session->req, session->header_size);
+#endif //WEBS_DEBUG_FLOW
+
+#if (WEBS_SESSION_TIMEOUT_S)
+    timer_stop(session->timer, session->self, HAL_WEBS);
+#endif //WEBS_SESSION_TIMEOUT_S
+
+    webs_req_received(webs, session);
 }
 
 static inline void webs_session_rx(WEBS* webs, WEBS_SESSION* session, int size)
 {
+    IO* io = session->user_io;
+    session->user_io = NULL;
     if (size < 0)
     {
-        //any error will cause connection termination
 #if (WEBS_DEBUG_ERRORS)
         printf("WEBS:error %d\n", size);
 #endif //WEBS_DEBUG_ERRORS
+        //handler is still processing request. Session is destroyed on connection close
+        if (io != NULL)
+        {
+            io_complete_ex(webs->process, HAL_IO_CMD(HAL_WEBS, IPC_READ), session->self, io, size);
+            return;
+        }
+        //any error will cause connection termination
         webs_close_session(webs, session);
         return;
     }
 
     //we don't need TCP flags analyse
-    io_pop(session->io, sizeof(TCP_STACK));
-
-    if (session->req_size + session->io->data_size > WEBS_MAX_PAYLOAD)
+    io_pop(session->rx, sizeof(TCP_STACK));
+    session->rx_pos = 0;
+    if (io != NULL)
     {
-        webs_respond_error(webs, session, WEB_RESPONSE_PAYLOAD_TOO_LARGE);
+        webs_body_copy(webs, session, io, session->user_size);
         return;
     }
 
     switch (session->state)
     {
     case WEBS_SESSION_STATE_IDLE:
-        session->req = malloc(size);
-        session->state = WEBS_SESSION_STATE_RX;
-        break;
     case WEBS_SESSION_STATE_RX:
-        session->req = realloc(session->req, session->req_size + size);
+        webs_session_parse_rx(webs, session);
         break;
     default:
 #if (WEBS_DEBUG_ERRORS)
         printf("WEBS: Invalid session state on RX: %d\n", session->state);
 #endif //WEBS_DEBUG_ERRORS
         webs_close_session(webs, session);
-        return;
-    }
-
-    if (session->req == NULL)
-    {
-        webs_out_of_memory(webs, session);
-        return;
-    }
-
-    memcpy(session->req + session->req_size, io_data(session->io), session->io->data_size);
-    session->req_size += session->io->data_size;
-
-    //Header ends with double CRLF
-    if (session->header_size == 0)
-    {
-        session->header_size = web_get_header_size(session->req, session->req_size);
-        //still no header received
-        if (session->header_size == 0)
-        {
-            tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
-            return;
-        }
     }
-
-    session->status_line_size = web_get_line_size(session->req, session->header_size);
-    //Make sure all data received
-    if (session->data_size == 0)
-        session->data_size = web_get_int_param(session->req + session->status_line_size, session->header_size, "content-length");
-    if (session->data_size + session->header_size > session->req_size)
-    {
-        tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
-        return;
-    }
-
-#if (WEBS_DEBUG_FLOW)
-    printf("WEBS RX:\n");
-    web_print(session->req, session->req_size);
-#endif //WEBS_DEBUG_FLOW
-
-#if (WEBS_SESSION_TIMEOUT_S)
-    timer_stop(session->timer, session->self, HAL_WEBS);
-#endif //WEBS_SESSION_TIMEOUT_S
-
-    webs_req_received(webs, session);
 }
 
 static inline void webs_session_tx_complete(WEBS* webs, WEBS_SESSION* session, int size)
@@ -792,11 +970,17 @@ static inline void webs_session_tx_complete(WEBS* webs, WEBS_SESSION* session, i
         return;
     }
     session->processed += size;
-    if (session->processed >= session->req_size)
+    if (session->processed >= session->tx_size)
     {
+        if (session->close)
+        {
+            webs_close_session(webs, session);
+            return;
+        }
 #if (WEBS_SESSION_TIMEOUT_S)
         webs_session_reset(session);
-        tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
+        //next request may be already received
+        webs_session_parse_rx(webs, session);
 #else
         webs_close_session(webs, session);
 #endif //WEBS_SESSION_TIMEOUT_S
@@ -11,25 +11,22 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
+#include "../../userspace/stdlib.h"
 #include "macs.h"
 #include "ips.h"
 
-#define ARP_CACHE_ITEM(tcpips, i)                    ((ARP_CACHE_ENTRY*)array_at((tcpips)->arps.cache, i))
-
-typedef struct {
-    IP ip;
-    //zero MAC means unresolved yet
-    MAC mac;
-    //time to live. Zero means static ARP
-    unsigned int ttl;
-} ARP_CACHE_ENTRY;
-
 static const MAC __MAC_BROADCAST =                  {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
 static const MAC __MAC_REQUEST =                    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
-void arps_init(TCPIPS* tcpips)
+bool arps_init(TCPIPS* tcpips)
 {
-    array_create(&tcpips->arps.cache, sizeof(ARP_CACHE_ENTRY), 1);
+    unsigned int i;
+    tcpips->arps.count = tcpips->arps.last = tcpips->arps.misses = 0;
+    if ((tcpips->arps.cache = malloc(ARP_HASH_SIZE * sizeof(ARP_CACHE_ENTRY))) == NULL)
+        return false;
+    for (i = 0; i < ARP_HASH_SIZE; ++i)
+        tcpips->arps.cache[i].ip.u32.ip = 0;
+    return true;
 }
 
 static void arps_cmd_request(TCPIPS* tcpips, const IP* ip)
@@ -102,13 +99,24 @@ static inline void arps_cmd_reply(TCPIPS* tcpips, MAC* mac, IP* ip)
     macs_tx(tcpips, io, mac, ETHERTYPE_ARP);
 }
 
+static inline unsigned int arps_hash(const IP* ip)
+{
+    //Fibonacci hashing. Hosts of flat network are different in last octet only
+    return ((ip->u32.ip * 2654435761u) >> 16) % ARP_HASH_SIZE;
+}
+
+static inline unsigned int arps_next(unsigned int idx)
+{
+    return idx + 1 < ARP_HASH_SIZE ? idx + 1 : 0;
+}
+
 static int arps_index(TCPIPS* tcpips, const IP* ip)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    unsigned int idx;
+    for (idx = arps_hash(ip); tcpips->arps.cache[idx].ip.u32.ip; idx = arps_next(idx))
     {
-        if (ARP_CACHE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-            return i;
+        if (tcpips->arps.cache[idx].ip.u32.ip == ip->u32.ip)
+            return idx;
     }
     return -1;
 }
@@ -116,59 +124,68 @@ static int arps_index(TCPIPS* tcpips, const IP* ip)
 static void arps_remove_item(TCPIPS* tcpips, int idx)
 {
     IP ip;
+    unsigned int i, j, home;
+    ARP_CACHE_ENTRY* cache = tcpips->arps.cache;
     ip.u32.ip = 0;
-    if (mac_compare(&ARP_CACHE_ITEM(tcpips, idx)->mac, &__MAC_REQUEST))
-        ip.u32.ip = ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip;
+    if (mac_compare(&cache[idx].mac, &__MAC_REQUEST))
+        ip.u32.ip = cache[idx].ip.u32.ip;
 #if (ARP_DEBUG)
     else
     {
         printf("ARP: route to ");
-        ip_print(&ARP_CACHE_ITEM(tcpips, idx)->ip);
+        ip_print(&cache[idx].ip);
         printf(" removed\n");
     }
 #endif
-    array_remove(&tcpips->arps.cache, idx);
+    //backward shift deletion: move up entries of probe chain, that can't be found after hole
+    for (i = idx, j = arps_next(idx); cache[j].ip.u32.ip; j = arps_next(j))
+    {
+        home = arps_hash(&cache[j].ip);
+        //home is cyclically in (i, j]
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        cache[i] = cache[j];
+        i = j;
+    }
+    cache[i].ip.u32.ip = 0;
+    --tcpips->arps.count;
 
     //inform route on incomplete ARP if not resolved
     if (ip.u32.ip)
         routes_not_resolved(tcpips, &ip);
 }
 
-static void arps_insert_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, unsigned int timeout)
+//oldest dynamic entry or -1 if all static
+static int arps_oldest(TCPIPS* tcpips)
 {
     int i, idx;
-    unsigned int ttl;
+    for (i = 0, idx = -1; i < ARP_HASH_SIZE; ++i)
+        if (tcpips->arps.cache[i].ip.u32.ip && tcpips->arps.cache[i].ttl &&
+           ((idx < 0) || (tcpips->arps.cache[i].ttl < tcpips->arps.cache[idx].ttl)))
+            idx = i;
+    return idx;
+}
+
+static void arps_insert_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, unsigned int timeout)
+{
+    int idx;
     //don't add dups
-    if (arps_index(tcpips, ip) >= 0)
+    if (ip->u32.ip == 0 || arps_index(tcpips, ip) >= 0)
         return;
-    //remove first non-static if no place
-    if (array_size(tcpips->arps.cache) == ARP_CACHE_SIZE_MAX)
+    //remove oldest non-static if no place
+    if (tcpips->arps.count == ARP_CACHE_SIZE_MAX)
     {
-        //first is static, can't remove
-        if (ARP_CACHE_ITEM(tcpips, 0)->ttl == 0)
+        //all static, can't remove
+        if ((idx = arps_oldest(tcpips)) < 0)
             return;
-        arps_remove_item(tcpips, 0);
-    }
-    idx = array_size(tcpips->arps.cache);
-    ttl = 0;
-    //add all static routes to the end of cache
-    if (timeout)
-    {
-        ttl = tcpips->seconds + timeout;
-        for (i = 0; i < array_size(tcpips->arps.cache); ++i)
-            if ((ARP_CACHE_ITEM(tcpips, i)->ttl > ttl) || (ARP_CACHE_ITEM(tcpips, i)->ttl == 0))
-            {
-                idx = i;
-                break;
-            }
-    }
-    if (array_insert(&tcpips->arps.cache, idx))
-    {
-        ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip = ip->u32.ip;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
-        ARP_CACHE_ITEM(tcpips, idx)->ttl = ttl;
+        arps_remove_item(tcpips, idx);
     }
+    for (idx = arps_hash(ip); tcpips->arps.cache[idx].ip.u32.ip; idx = arps_next(idx)) {}
+    tcpips->arps.cache[idx].ip.u32.ip = ip->u32.ip;
+    tcpips->arps.cache[idx].mac.u32.hi = mac->u32.hi;
+    tcpips->arps.cache[idx].mac.u32.lo = mac->u32.lo;
+    tcpips->arps.cache[idx].ttl = timeout ? tcpips->seconds + timeout : 0;
+    ++tcpips->arps.count;
 #if (ARP_DEBUG)
     if (mac->u32.hi && mac->u32.lo)
     {
@@ -186,9 +203,9 @@ static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac)
     int idx = arps_index(tcpips, ip);
     if (idx < 0)
         return;
-    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
-    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
-    ARP_CACHE_ITEM(tcpips, idx)->ttl = tcpips->seconds + ARP_CACHE_TIMEOUT;
+    tcpips->arps.cache[idx].mac.u32.hi = mac->u32.hi;
+    tcpips->arps.cache[idx].mac.u32.lo = mac->u32.lo;
+    tcpips->arps.cache[idx].ttl = tcpips->seconds + ARP_CACHE_TIMEOUT;
 #if (ARP_DEBUG)
     printf("ARP: route resolved ");
     ip_print(ip);
@@ -198,22 +215,32 @@ static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac)
 #endif
 }
 
+//true if entry exists, even if it's not resolved yet
 static bool arps_lookup(TCPIPS* tcpips, const IP* ip, MAC* mac)
 {
-    int idx = arps_index(tcpips, ip);
-    if (idx >= 0)
+    int idx;
+    ARP_CACHE_ENTRY* entry = &tcpips->arps.cache[tcpips->arps.last];
+    //last resolved. Slot can be reused or moved, so key is compared anyway
+    if (entry->ip.u32.ip != ip->u32.ip || ip->u32.ip == 0)
     {
-        mac->u32.hi = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi;
-        mac->u32.lo = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo;
-        return true;
+        if ((idx = arps_index(tcpips, ip)) < 0)
+        {
+            mac->u32.hi = 0;
+            mac->u32.lo = 0;
+            return false;
+        }
+        entry = &tcpips->arps.cache[idx];
+        if (!mac_compare(&entry->mac, &__MAC_REQUEST))
+            tcpips->arps.last = idx;
     }
-    mac->u32.hi = 0;
-    mac->u32.lo = 0;
-    return false;
+    mac->u32.hi = entry->mac.u32.hi;
+    mac->u32.lo = entry->mac.u32.lo;
+    return true;
 }
 
 void arps_link_changed(TCPIPS* tcpips, bool link)
 {
+    unsigned int i;
     if (link)
     {
         //announce IP
@@ -222,16 +249,27 @@ void arps_link_changed(TCPIPS* tcpips, bool link)
     }
     else
     {
-        //flush ARP cache, except static routes
-        while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl)
-            arps_remove_item(tcpips, 0);
+        //flush ARP cache, except static routes. Shifted entry is rechecked
+        for (i = 0; i < ARP_HASH_SIZE; )
+        {
+            if (tcpips->arps.cache[i].ip.u32.ip && tcpips->arps.cache[i].ttl)
+                arps_remove_item(tcpips, i);
+            else
+                ++i;
+        }
     }
 }
 
 void arps_timer(TCPIPS* tcpips, unsigned int seconds)
 {
-    while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl && (ARP_CACHE_ITEM(tcpips, 0)->ttl <= seconds))
-        arps_remove_item(tcpips, 0);
+    unsigned int i;
+    for (i = 0; i < ARP_HASH_SIZE; )
+    {
+        if (tcpips->arps.cache[i].ip.u32.ip && tcpips->arps.cache[i].ttl && (tcpips->arps.cache[i].ttl <= seconds))
+            arps_remove_item(tcpips, i);
+        else
+            ++i;
+    }
 }
 
 static inline void arps_add_static(TCPIPS* tcpips, IPC* ipc)
@@ -266,8 +304,10 @@ static inline void arps_remove(TCPIPS* tcpips, IP* ip)
 
 static void arps_flush(TCPIPS* tcpips)
 {
-    while (array_size(tcpips->arps.cache))
-        arps_remove_item(tcpips, 0);
+    unsigned int i;
+    for (i = 0; i < ARP_HASH_SIZE; ++i)
+        while (tcpips->arps.cache[i].ip.u32.ip)
+            arps_remove_item(tcpips, i);
 }
 
 #if (ARP_DEBUG)
@@ -275,16 +315,18 @@ static inline void arps_show_table(TCPIPS* tcpips)
 {
     int i;
     ARP_CACHE_ENTRY* arp;
-    if (array_size(tcpips->arps.cache) == 0)
+    if (tcpips->arps.count == 0)
     {
         printf("ARP: table is empty\n");
         return;
     }
     printf("       IP             MAC          TTL\n");
     printf("-----------------------------------------\n");
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    for (i = 0; i < ARP_HASH_SIZE; ++i)
     {
-        arp = ARP_CACHE_ITEM(tcpips, i);
+        arp = &tcpips->arps.cache[i];
+        if (arp->ip.u32.ip == 0)
+            continue;
         printf("  ");
         ip_print(&arp->ip);
         printf("  ");
@@ -380,8 +422,15 @@ bool arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac)
         mac->u32.hi = __MAC_BROADCAST.u32.hi;
         return true;
     }
+    //still requesting, route is queueing
     if (arps_lookup(tcpips, ip, mac))
-        return true;
+    {
+        if (!mac_compare(mac, &__MAC_REQUEST))
+            return true;
+        ++tcpips->arps.misses;
+        return false;
+    }
+    ++tcpips->arps.misses;
     //request mac
     arps_insert_item(tcpips, ip, &__MAC_REQUEST, ARP_CACHE_INCOMPLETE_TIMEOUT);
     arps_cmd_request(tcpips, ip);
@@ -11,7 +11,6 @@
 
 #include "tcpips.h"
 #include "../../userspace/eth.h"
-#include "../../userspace/array.h"
 #include "../../userspace/ipc.h"
 #include "../../userspace/arp.h"
 #include <stdint.h>
@@ -42,11 +41,27 @@ typedef struct {
 #define RARP_REPLY                      4
 
 typedef struct {
-    ARRAY* cache;
+    IP ip;
+    //zero MAC means unresolved yet
+    MAC mac;
+    //time to live. Zero means static ARP
+    unsigned int ttl;
+} ARP_CACHE_ENTRY;
+
+//open addressed hash, keyed by IP. Zero IP is free slot. Load factor is kept below 2/3
+#define ARP_HASH_SIZE                   (ARP_CACHE_SIZE_MAX + (ARP_CACHE_SIZE_MAX >> 1) + 1)
+
+typedef struct {
+    //ARP_HASH_SIZE entries, allocated once on init
+    ARP_CACHE_ENTRY* cache;
+    //last resolved slot. Fast path for stream of frames to same host
+    unsigned int count, last;
+    //resolve requests, not answered from cache
+    unsigned int misses;
 } ARPS;
 
 //from tcpip
-void arps_init(TCPIPS* tcpips);
+bool arps_init(TCPIPS* tcpips);
 void arps_link_changed(TCPIPS* tcpips, bool link);
 void arps_timer(TCPIPS* tcpips, unsigned int seconds);
 void arps_request(TCPIPS* tcpips, IPC* ipc);
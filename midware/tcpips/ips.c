@@ -11,6 +11,8 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
+#include "../../userspace/stdlib.h"
+#include "../../userspace/systime.h"
 #include "icmps.h"
 #include <string.h>
 #include "udps.h"
@@ -18,32 +20,30 @@
 
 #if (IP_FRAGMENTATION)
 
-typedef struct _ASSEMBLY_SLOT {
-    struct _ASSEMBLY_SLOT* next;
-    unsigned int size;
-} ASSEMBLY_SLOT;
-
+//data is collected after space for longest header. Header of first fragment is copied right before data
+#define IP_HEADER_MAX_SIZE                      60
 #define LONG_IP_FRAME_MAX_DATA_SIZE             (IP_MAX_LONG_SIZE - sizeof(IP_HEADER))
-#define LONG_IP_FRAME_MAX_SIZE                  (IP_MAX_LONG_SIZE + sizeof(MAC_HEADER) + sizeof(IP_STACK) + sizeof(ASSEMBLY_SLOT))
+#define LONG_IP_FRAME_MAX_SIZE                  (IP_MAX_LONG_SIZE + sizeof(MAC_HEADER) + sizeof(IP_STACK) + IP_HEADER_MAX_SIZE - sizeof(IP_HEADER))
+#define IP_HOLE_END                             0xffff
 
+//RFC 815 hole descriptor, kept in the hole itself. Hole is [offset of descriptor, end)
 typedef struct {
-    IO* io;
-    ASSEMBLY_SLOT* head;
-    unsigned int ttl;
-    IP src;
-    uint16_t id;
-    bool got_last;
-} IPS_ASSEMBLY;
+    uint16_t end, next;
+} IP_HOLE;
 #endif //IP_FRAGMENTATION
 
 #define IP_DF                                   (1 << 6)
 #define IP_MF                                   (1 << 5)
 #define IP_FLAGS_MASK                           (7 << 5)
 
-void ips_init(TCPIPS* tcpips)
+bool ips_init(TCPIPS* tcpips)
 {
+#if (IP_FRAGMENTATION)
+    unsigned int i;
+#endif //IP_FRAGMENTATION
     tcpips->ips.ip.u32.ip = IP_MAKE(0, 0, 0, 0);
     tcpips->ips.up = false;
+    tcpips->ips.rx_frames = tcpips->ips.header_errors = tcpips->ips.addr_drops = tcpips->ips.proto_drops = 0;
 
 #if (IP_FIREWALL)
     tcpips->ips.firewall_enabled = false;
@@ -52,8 +52,15 @@ void ips_init(TCPIPS* tcpips)
 #if (IP_FRAGMENTATION)
     tcpips->ips.io_allocated = 0;
     array_create(&tcpips->ips.free_io, sizeof(IO*), 1);
-    array_create(&tcpips->ips.assembly_io, sizeof(IPS_ASSEMBLY), 1);
+    tcpips->ips.assembly_count = 0;
+    tcpips->ips.assembled = tcpips->ips.assembly_timeouts = tcpips->ips.assembly_evictions = 0;
+    tcpips->ips.assembly_drops = tcpips->ips.fragment_dups = 0;
+    if ((tcpips->ips.assembly = malloc(IP_ASSEMBLY_HASH_SIZE * sizeof(IPS_ASSEMBLY))) == NULL)
+        return false;
+    for (i = 0; i < IP_ASSEMBLY_HASH_SIZE; ++i)
+        tcpips->ips.assembly[i].io = NULL;
 #endif //IP_FRAGMENTATION
+    return true;
 }
 
 #if (IP_FRAGMENTATION)
@@ -67,7 +74,7 @@ static IO* ips_allocate_long(TCPIPS* tcpips)
     }
     else if (tcpips->ips.io_allocated < IP_MAX_LONG_PACKETS)
     {
-        io = io_create(LONG_IP_FRAME_MAX_SIZE);
+        io = io_create(LONG_IP_FRAME_MAX_SIZE + TCP_FRAME_HEADROOM);
         if (io != NULL)
             ++tcpips->ips.io_allocated;
     }
@@ -85,107 +92,150 @@ static void ips_release_long(TCPIPS* tcpips, IO* io)
         *iop = io;
 }
 
-static inline IPS_ASSEMBLY* ips_allocate_assembly(TCPIPS* tcpips, const IP* src, uint16_t id)
+static inline unsigned int ips_assembly_hash(const IP* src, uint16_t id, uint8_t proto)
 {
-    IO* io;
+    //Fibonacci hashing. Same host is sending sequential ids
+    return (((src->u32.ip ^ ((unsigned int)proto << 16) ^ id) * 2654435761u) >> 16) % IP_ASSEMBLY_HASH_SIZE;
+}
+
+static inline unsigned int ips_assembly_next(unsigned int idx)
+{
+    return idx + 1 < IP_ASSEMBLY_HASH_SIZE ? idx + 1 : 0;
+}
+
+static inline uint8_t* ips_assembly_data(IPS_ASSEMBLY* as)
+{
+    return (uint8_t*)io_data(as->io) + IP_HEADER_MAX_SIZE;
+}
+
+static inline IP_HOLE* ips_hole(IPS_ASSEMBLY* as, unsigned int offset)
+{
+    return (IP_HOLE*)(ips_assembly_data(as) + offset);
+}
+
+static int ips_find_assembly(TCPIPS* tcpips, const IP* src, uint16_t id, uint8_t proto)
+{
+    unsigned int idx;
     IPS_ASSEMBLY* as;
-    ASSEMBLY_SLOT* asl;
-    if (array_size(tcpips->ips.assembly_io) >= IP_MAX_LONG_PACKETS)
+    for (idx = ips_assembly_hash(src, id, proto); (as = &tcpips->ips.assembly[idx])->io != NULL; idx = ips_assembly_next(idx))
     {
-        error(ERROR_TOO_MANY_HANDLES);
-        return NULL;
+        if (as->src.u32.ip == src->u32.ip && as->id == id && as->proto == proto)
+            return idx;
     }
-    io = ips_allocate_long(tcpips);
-    if (io == NULL)
-        return NULL;
-    as = array_append(&tcpips->ips.assembly_io);
-    as->got_last = false;
-    as->io = io;
-    as->head = io_data(io);
-    asl = io_data(io);
-    asl->next = NULL;
-    asl->size = LONG_IP_FRAME_MAX_DATA_SIZE;
-    as->ttl = tcpips->seconds + IP_FRAGMENTATION_ASSEMBLY_TIMEOUT;
-    as->src.u32.ip = src->u32.ip;
-    as->id = id;
-    as->got_last = false;
-    return as;
+    return -1;
 }
 
-static inline void ips_free_assembly(TCPIPS* tcpips, const IP* src, uint16_t id)
+//entry only. Long frame is released or passed up by caller
+static void ips_remove_assembly(TCPIPS* tcpips, unsigned int idx)
 {
-    int i;
-    IPS_ASSEMBLY* as;
-    for (i = 0; i < array_size(tcpips->ips.assembly_io); ++i)
+    unsigned int i, j, home;
+    IPS_ASSEMBLY* assembly = tcpips->ips.assembly;
+    //backward shift deletion: move up entries of probe chain, that can't be found after hole
+    for (i = idx, j = ips_assembly_next(idx); assembly[j].io != NULL; j = ips_assembly_next(j))
     {
-        as = array_at(tcpips->ips.assembly_io, i);
-        if (as->src.u32.ip == src->u32.ip && as->id == id)
-        {
-            array_remove(&tcpips->ips.assembly_io, i);
-            return;
-        }
+        home = ips_assembly_hash(&assembly[j].src, assembly[j].id, assembly[j].proto);
+        //home is cyclically in (i, j]
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        assembly[i] = assembly[j];
+        i = j;
     }
+    assembly[i].io = NULL;
+    --tcpips->ips.assembly_count;
+}
+
+static void ips_drop_assembly(TCPIPS* tcpips, unsigned int idx)
+{
+    ips_release_long(tcpips, tcpips->ips.assembly[idx].io);
+    ips_remove_assembly(tcpips, idx);
+}
+
+//closest to timeout
+static unsigned int ips_oldest_assembly(TCPIPS* tcpips)
+{
+    unsigned int i, idx;
+    for (i = idx = 0; i < IP_ASSEMBLY_HASH_SIZE; ++i)
+        if (tcpips->ips.assembly[i].io != NULL &&
+           ((tcpips->ips.assembly[idx].io == NULL) || (tcpips->ips.assembly[i].ttl < tcpips->ips.assembly[idx].ttl)))
+            idx = i;
+    return idx;
 }
 
-static IPS_ASSEMBLY* ips_find_assembly(TCPIPS* tcpips, const IP* src, uint16_t id)
+static int ips_create_assembly(TCPIPS* tcpips, const IP* src, uint16_t id, uint8_t proto)
 {
-    int i;
+    IO* io;
+    IP_HOLE* hole;
     IPS_ASSEMBLY* as;
-    for (i = 0; i < array_size(tcpips->ips.assembly_io); ++i)
+    unsigned int idx;
+    //long frames are shared with transmit. Make place by oldest assembly
+    if (tcpips->ips.assembly_count >= IP_MAX_LONG_PACKETS || (io = ips_allocate_long(tcpips)) == NULL)
     {
-        as = array_at(tcpips->ips.assembly_io, i);
-        if (as->src.u32.ip == src->u32.ip && as->id == id)
-            return as;
+        if (tcpips->ips.assembly_count == 0)
+            return -1;
+#if (IP_DEBUG)
+        printf("IP: fragment assembly evicted\n");
+#endif //IP_DEBUG
+        ++tcpips->ips.assembly_evictions;
+        ips_drop_assembly(tcpips, ips_oldest_assembly(tcpips));
+        if ((io = ips_allocate_long(tcpips)) == NULL)
+            return -1;
     }
-    //not found? allocate
-    return ips_allocate_assembly(tcpips, src, id);
+    for (idx = ips_assembly_hash(src, id, proto); tcpips->ips.assembly[idx].io != NULL; idx = ips_assembly_next(idx)) {}
+    as = &tcpips->ips.assembly[idx];
+    as->io = io;
+    as->src.u32.ip = src->u32.ip;
+    as->id = id;
+    as->proto = proto;
+    as->ttl = tcpips->seconds + IP_FRAGMENTATION_ASSEMBLY_TIMEOUT;
+    as->hdr_size = as->size = 0;
+    //whole buffer is one hole
+    as->hole = 0;
+    hole = ips_hole(as, 0);
+    hole->end = LONG_IP_FRAME_MAX_DATA_SIZE;
+    hole->next = IP_HOLE_END;
+    ++tcpips->ips.assembly_count;
+    return idx;
 }
 
-static bool ips_insert_assembly(IPS_ASSEMBLY* as, IO* io, unsigned int offset)
+//RFC 815: fragment [first, end) is deleting all holes it is covering, uncovered parts are new holes. Returns false if no hole is filled
+static bool ips_fill_holes(IPS_ASSEMBLY* as, unsigned int first, unsigned int end, bool more)
 {
-    ASSEMBLY_SLOT* asl;
-    ASSEMBLY_SLOT* prev;
-    ASSEMBLY_SLOT* n;
-    unsigned int cur_offset;
-    for (asl = as->head, prev = NULL; asl != NULL; prev = asl, asl = asl->next)
+    IP_HOLE* hole;
+    uint16_t* prev;
+    unsigned int hole_first, hole_end, next;
+    bool filled = false;
+    for (prev = &as->hole; *prev != IP_HOLE_END; )
     {
-        cur_offset = (unsigned int)asl - (unsigned int)io_data(as->io);
-        if (cur_offset > offset)
-            break;
-        //fit
-        if (cur_offset <= offset && cur_offset - offset + asl->size >= io->data_size)
+        hole_first = *prev;
+        hole = ips_hole(as, hole_first);
+        hole_end = hole->end;
+        next = hole->next;
+        //last fragment is closing all holes after it
+        if ((first >= hole_end || end <= hole_first) && (more || hole_first < end))
         {
-            //insert in top of free slot
-            if (cur_offset == offset)
-            {
-                n = (ASSEMBLY_SLOT*)((unsigned int)asl + io->data_size);
-                if (prev)
-                    prev->next = n;
-                else
-                    as->head = n;
-                n->next = asl->next;
-                n->size = asl->size - io->data_size;
-            }
-            //no need to change prev
-            else
-            {
-                //bottom
-                if (offset - cur_offset + io->data_size == asl->size)
-                    asl->size -= io->data_size;
-                //in the middle
-                else
-                {
-                    n = (ASSEMBLY_SLOT*)((unsigned int)asl + io->data_size + offset - cur_offset);
-                    n->next = asl->next;
-                    n->size = asl->size - (offset - cur_offset) - io->data_size;
-                    asl->size = offset - cur_offset;
-                }
-            }
-            memcpy((void*)((unsigned int)asl + io->data_size + offset - cur_offset), io_data(io), io->data_size);
-            return true;
+            prev = &hole->next;
+            continue;
+        }
+        filled |= (first < hole_end && end > hole_first);
+        *prev = next;
+        if (first > hole_first && first < hole_end)
+        {
+            //same descriptor, head of hole
+            hole->end = first;
+            hole->next = next;
+            *prev = hole_first;
+            prev = &hole->next;
+        }
+        if (end > hole_first && end < hole_end && more)
+        {
+            hole = ips_hole(as, end);
+            hole->end = hole_end;
+            hole->next = next;
+            *prev = end;
+            prev = &hole->next;
         }
     }
-    return false;
+    return filled;
 }
 #endif //IP_FRAGMENTATION
 
@@ -262,22 +312,38 @@ void ips_link_changed(TCPIPS* tcpips, bool link)
     }
 }
 
+void ips_get_stats(TCPIPS* tcpips, TCPIP_STATS* stats)
+{
+    stats->ip_rx = tcpips->ips.rx_frames;
+    stats->ip_header_errors = tcpips->ips.header_errors;
+    stats->ip_addr_drops = tcpips->ips.addr_drops;
+    stats->ip_proto_drops = tcpips->ips.proto_drops;
+#if (IP_FRAGMENTATION)
+    stats->ip_assembled = tcpips->ips.assembled;
+    stats->ip_assembly_timeouts = tcpips->ips.assembly_timeouts;
+    stats->ip_assembly_evictions = tcpips->ips.assembly_evictions;
+    stats->ip_assembly_drops = tcpips->ips.assembly_drops;
+    stats->ip_fragment_dups = tcpips->ips.fragment_dups;
+#endif //IP_FRAGMENTATION
+}
+
 #if (IP_FRAGMENTATION)
 void ips_timer(TCPIPS* tcpips, unsigned int seconds)
 {
-    int i;
-    IPS_ASSEMBLY* as;
-    for (i = 0; i < array_size(tcpips->ips.assembly_io); ++i)
+    unsigned int i;
+    for (i = 0; tcpips->ips.assembly_count && i < IP_ASSEMBLY_HASH_SIZE; )
     {
-        as = array_at(tcpips->ips.assembly_io, i);
-        if (as->ttl < seconds)
+        if (tcpips->ips.assembly[i].io != NULL && tcpips->ips.assembly[i].ttl < seconds)
         {
 #if (IP_DEBUG)
             printf("IP: Fragment assembly timeout\n");
 #endif //IP_DEBUG
-            ips_release_long(tcpips, as->io);
-            ips_free_assembly(tcpips, &as->src, as->id);
+            ++tcpips->ips.assembly_timeouts;
+            //next entry can be shifted to this place
+            ips_drop_assembly(tcpips, i);
+            continue;
         }
+        ++i;
     }
 }
 #endif //IP_FRAGMENTATION
@@ -331,6 +397,27 @@ void ips_release_io(TCPIPS* tcpips, IO* io)
         tcpips_release_io(tcpips, io);
 }
 
+#if (TCPIP_TX_GATHER)
+void ips_gather(IO* io, const void* data, unsigned int size)
+{
+    ETH_GATHER* gather;
+    IP_STACK ip_stack = *((IP_STACK*)io_stack(io));
+    //put under IP stack, so it's left for ETH driver after IP stack is popped
+    io_pop(io, sizeof(IP_STACK));
+    gather = io_push(io, sizeof(ETH_GATHER));
+    gather->data = data;
+    gather->size = size;
+    *((IP_STACK*)io_push(io, sizeof(IP_STACK))) = ip_stack;
+}
+
+unsigned int ips_gather_size(IO* io)
+{
+    if (io->stack_size <= sizeof(IP_STACK))
+        return 0;
+    return ((ETH_GATHER*)((uint8_t*)io_stack(io) + sizeof(IP_STACK)))->size;
+}
+#endif //TCPIP_TX_GATHER
+
 static void ips_tx_internal(TCPIPS* tcpips, IO* io, const IP* dst, unsigned int hdr_size)
 {
     IP_HEADER* hdr;
@@ -341,7 +428,12 @@ static void ips_tx_internal(TCPIPS* tcpips, IO* io, const IP* dst, unsigned int
     //DSCP, ECN
     hdr->tos = 0;
     //total len
+#if (TCPIP_TX_GATHER)
+    //only ETH gather is left on stack
+    short2be(hdr->total_len_be, io->stack_size ? io->data_size + ((ETH_GATHER*)io_stack(io))->size : io->data_size);
+#else
     short2be(hdr->total_len_be, io->data_size);
+#endif //TCPIP_TX_GATHER
     //ttl
     hdr->ttl = 0xff;
     //src
@@ -379,7 +471,7 @@ void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst)
     {
         for (offset = ip_stack->hdr_size; offset < io->data_size; offset += cur)
         {
-            fragment = tcpips_allocate_io(tcpips);
+            fragment = macs_allocate_io(tcpips);
             if (fragment == NULL)
             {
 #if (IP_DEBUG)
@@ -390,21 +482,24 @@ void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst)
                 ips_release_io(tcpips, io);
                 return;
             }
-            cur = IP_FRAME_MAX_DATA_SIZE;
+            //all fragments, except last, are 8 bytes aligned
+            cur = (TCPIP_MTU - ip_stack->hdr_size) & ~7;
             if (offset + cur > io->data_size)
                 cur = io->data_size - offset;
             //hdr
             memcpy(io_data(fragment), io_data(io), ip_stack->hdr_size);
             //data
             memcpy((uint8_t*)io_data(fragment) + ip_stack->hdr_size, (uint8_t*)io_data(io) + offset, cur);
+            fragment->data_size = ip_stack->hdr_size + cur;
 
             hdr = io_data(fragment);
             short2be(hdr->id_be, tcpips->ips.id);
             hdr->proto = ip_stack->proto;
-            short2be(hdr->flags_offset_be, offset >> 3);
+            short2be(hdr->flags_offset_be, (offset - ip_stack->hdr_size) >> 3);
             //MF
             if (offset + cur < io->data_size)
-                hdr->flags_offset_be[0] |= IP_FLAGS_MASK;
+                hdr->flags_offset_be[0] |= IP_MF;
+            ips_tx_internal(tcpips, fragment, dst, ip_stack->hdr_size);
         }
         ips_release_io(tcpips, io);
         ++tcpips->ips.id;
@@ -422,6 +517,9 @@ void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst)
 
 static void ips_process(TCPIPS* tcpips, IO* io, IP* src)
 {
+#if (TCPIP_PROFILE)
+    SYSTIME uptime;
+#endif //TCPIP_PROFILE
     IP_STACK* ip_stack = io_stack(io);
 #if (IP_DEBUG_FLOW)
     printf("IP: from ");
@@ -437,11 +535,23 @@ static void ips_process(TCPIPS* tcpips, IO* io, IP* src)
 #endif //ICMP
 #if (UDP)
     case PROTO_UDP:
+#if (TCPIP_PROFILE)
+        get_uptime(&uptime);
+        udps_rx(tcpips, io, src);
+        tcpips->udp_rx_us += systime_elapsed_us(&uptime);
+#else
         udps_rx(tcpips, io, src);
+#endif //TCPIP_PROFILE
         break;
 #endif //UDP
     case PROTO_TCP:
+#if (TCPIP_PROFILE)
+        get_uptime(&uptime);
         tcps_rx(tcpips, io, src);
+        tcpips->tcp_rx_us += systime_elapsed_us(&uptime);
+#else
+        tcps_rx(tcpips, io, src);
+#endif //TCPIP_PROFILE
         break;
     default:
 #if (IP_DEBUG)
@@ -452,6 +562,7 @@ static void ips_process(TCPIPS* tcpips, IO* io, IP* src)
 #if (ICMP)
         icmps_tx_error(tcpips, io, ICMP_ERROR_PROTOCOL, 0);
 #endif //ICMP
+        ++tcpips->ips.proto_drops;
         ips_release_io(tcpips, io);
     }
 }
@@ -462,22 +573,34 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
     IP_HEADER* hdr;
     IPS_ASSEMBLY* as;
     IO* assembled;
+    uint16_t crc;
+    int idx;
     IP_STACK* ip_stack = io_stack(io);
     hdr = (IP_HEADER*)(((uint8_t*)io_data(io)) - ip_stack->hdr_size);
-    as = ips_find_assembly(tcpips, &hdr->src, be2short(hdr->id_be));
-    if (as == NULL)
+#if (IP_DEBUG_FLOW)
+    printf("IP: fragmented frame insert: offset %d, more: %d\n", offset, more);
+#endif //IP_DEBUG
+    //all fragments, except last, are 8 bytes aligned
+    if (io->data_size == 0 || (more && (io->data_size & 7)))
+    {
+        ++tcpips->ips.assembly_drops;
+        tcpips_release_io(tcpips, io);
+        return;
+    }
+    if ((idx = ips_find_assembly(tcpips, &hdr->src, be2short(hdr->id_be), hdr->proto)) < 0 &&
+        (idx = ips_create_assembly(tcpips, &hdr->src, be2short(hdr->id_be), hdr->proto)) < 0)
     {
 #if (IP_DEBUG)
         printf("IP: too many fragmented frames\n");
 #endif //IP_DEBUG
+        ++tcpips->ips.assembly_drops;
         tcpips_release_io(tcpips, io);
         return;
     }
-#if (IP_DEBUG_FLOW)
-    printf("IP: fragmented frame insert: offset %d, more: %d\n", offset, more);
-#endif //IP_DEBUG
-    //fit?
-    if (io->data_size + offset > LONG_IP_FRAME_MAX_DATA_SIZE)
+    as = &tcpips->ips.assembly[idx];
+    //fit? Hole after not last fragment is keeping descriptor. Nothing after last fragment
+    if ((offset + io->data_size + (more ? sizeof(IP_HOLE) : 0) > LONG_IP_FRAME_MAX_DATA_SIZE) ||
+        (as->size && offset + io->data_size > as->size) || (!more && as->size && offset + io->data_size != as->size))
     {
 #if (IP_DEBUG)
         printf("IP: fragmented frame too big to fit\n");
@@ -486,55 +609,55 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
         icmps_tx_error(tcpips, io, ICMP_ERROR_PARAMETER, 2);
 #endif //ICMP
         tcpips_release_io(tcpips, io);
-        //assembly drop
-        ips_release_long(tcpips, as->io);
-        ips_free_assembly(tcpips, &as->src, as->id);
+        ++tcpips->ips.assembly_drops;
+        ips_drop_assembly(tcpips, idx);
         return;
     }
-    //first frame?
-    if (offset == 0)
-    {
-        //unhide header
-        io->data_offset -= ip_stack->hdr_size;
-        io->data_size += ip_stack->hdr_size;
-    }
-    if (!ips_insert_assembly(as, io, offset))
+    if (!ips_fill_holes(as, offset, offset + io->data_size, more))
     {
 #if (IP_DEBUG)
-        printf("IP: possible duplicated frame\n");
+        printf("IP: duplicated fragment\n");
 #endif //IP_DEBUG
+        ++tcpips->ips.fragment_dups;
         tcpips_release_io(tcpips, io);
         return;
     }
-    tcpips_release_io(tcpips, io);
-    if (!more)
-        as->got_last = true;
-    //got last and no fragments? received all
-    if (as->got_last && as->head->next->next == NULL)
+    //overlapped parts are overwritten by same data
+    memcpy(ips_assembly_data(as) + offset, io_data(io), io->data_size);
+    if (offset == 0)
     {
+        as->hdr_size = ip_stack->hdr_size;
+        memcpy(ips_assembly_data(as) - as->hdr_size, hdr, as->hdr_size);
+    }
+    if (!more)
+        as->size = offset + io->data_size;
+    tcpips_release_io(tcpips, io);
+    //no holes left
+    if (as->hole != IP_HOLE_END)
+        return;
 #if (IP_DEBUG_FLOW)
-        printf("IP: Assembly complete\n");
+    printf("IP: Assembly complete\n");
 #endif //IP_DEBUG_FLOW
-        assembled = as->io;
-        assembled->data_size = (unsigned int)as->head - (unsigned int)io_data(as->io);
-        ips_free_assembly(tcpips, &as->src, as->id);
-        hdr = io_data(assembled);
-        ip_stack = io_push(assembled, sizeof(IP_STACK));
-        ip_stack->hdr_size = (hdr->ver_ihl & 0xf) << 2;
-        ip_stack->proto = hdr->proto;
-        ip_stack->is_long = true;
-        //update header
-        io->data_offset += ip_stack->hdr_size;
-        io->data_size -= ip_stack->hdr_size;
-        //total len
-        short2be(hdr->total_len_be, io->data_size);
-        //flags, offset
-        hdr->flags_offset_be[0] = hdr->flags_offset_be[1] = 0;
-        //update checksum
-        short2be(hdr->header_crc_be, 0);
-        short2be(hdr->header_crc_be, ip_checksum(io_data(assembled), ip_stack->hdr_size));
-        ips_process(tcpips, assembled, &hdr->src);
-    }
+    ++tcpips->ips.assembled;
+    assembled = as->io;
+    assembled->data_offset += IP_HEADER_MAX_SIZE;
+    assembled->data_size = as->size;
+    ip_stack = io_push(assembled, sizeof(IP_STACK));
+    ip_stack->hdr_size = as->hdr_size;
+    ip_stack->is_long = true;
+    ips_remove_assembly(tcpips, idx);
+    hdr = (IP_HEADER*)((uint8_t*)io_data(assembled) - ip_stack->hdr_size);
+    ip_stack->proto = hdr->proto;
+    //incremental checksum update, header is already verified
+    crc = be2short(hdr->header_crc_be);
+    //total len
+    crc = ip_checksum_update(crc, be2short(hdr->total_len_be), ip_stack->hdr_size + assembled->data_size);
+    short2be(hdr->total_len_be, ip_stack->hdr_size + assembled->data_size);
+    //flags, offset
+    crc = ip_checksum_update(crc, be2short(hdr->flags_offset_be), 0);
+    hdr->flags_offset_be[0] = hdr->flags_offset_be[1] = 0;
+    short2be(hdr->header_crc_be, crc);
+    ips_process(tcpips, assembled, &hdr->src);
 }
 #endif //IP_FRAGMENTATION
 
@@ -545,8 +668,10 @@ void ips_rx(TCPIPS* tcpips, IO* io)
     uint8_t flags;
     IP_STACK* ip_stack;
     IP_HEADER* hdr = io_data(io);
+    ++tcpips->ips.rx_frames;
     if (io->data_size < sizeof(IP_HEADER))
     {
+        ++tcpips->ips.header_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -563,6 +688,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
     //drop if checksum is invalid
     if (ip_checksum(io_data(io), ip_stack->hdr_size))
     {
+        ++tcpips->ips.header_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -576,6 +702,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
         ip_print(&hdr->src);
         printf(" Firewall condition\n");
 #endif //IP_DEBUG
+        ++tcpips->ips.addr_drops;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -590,6 +717,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
 #if (ICMP)
         icmps_tx_error(tcpips, io, ICMP_ERROR_PARAMETER, 2);
 #endif //ICMP
+        ++tcpips->ips.header_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -602,6 +730,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
 #if (ICMP)
         icmps_tx_error(tcpips, io, ICMP_ERROR_PARAMETER, 0);
 #endif //ICMP
+        ++tcpips->ips.header_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -612,6 +741,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
     if (tcpips->ips.ip.u32.ip != hdr->dst.u32.ip)
 #endif
     {
+        ++tcpips->ips.addr_drops;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -622,6 +752,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
 #if (ICMP)
         icmps_tx_error(tcpips, io, ICMP_ERROR_TTL_EXCEED, 0);
 #endif //ICMP
+        ++tcpips->ips.header_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
@@ -637,6 +768,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
 #if (ICMP)
         icmps_tx_error(tcpips, io, ICMP_ERROR_PARAMETER, 6);
 #endif //ICMP
+        ++tcpips->ips.proto_drops;
         tcpips_release_io(tcpips, io);
 #endif //IP_FRAGMENTATION
         return;
@@ -13,14 +13,32 @@
 #include "../../userspace/ip.h"
 #include "../../userspace/ipc.h"
 #include "../../userspace/array.h"
+#include "../../userspace/tcpip.h"
 #include "sys_config.h"
 
 #define IP_FRAME_MAX_DATA_SIZE                          (TCPIP_MTU - sizeof(IP_HEADER))
 
+#if (IP_FRAGMENTATION)
+#define IP_ASSEMBLY_HASH_SIZE                           (IP_MAX_LONG_PACKETS * 2 + 1)
+
+typedef struct {
+    //long frame, collecting data. NULL if entry is free
+    IO* io;
+    IP src;
+    unsigned int ttl;
+    uint16_t id;
+    //first hole offset. Header size, 0 before first fragment. Data size, 0 before last fragment
+    uint16_t hole, hdr_size, size;
+    uint8_t proto;
+} IPS_ASSEMBLY;
+#endif //IP_FRAGMENTATION
+
 typedef struct {
     IP ip;
     uint16_t id;
     bool up;
+    //received frames. Dropped: malformed or invalid checksum, not for this host, no handler for protocol
+    unsigned int rx_frames, header_errors, addr_drops, proto_drops;
 #if (IP_FIREWALL)
     bool firewall_enabled;
     IP src, mask;
@@ -28,7 +46,11 @@ typedef struct {
 #if (IP_FRAGMENTATION)
     unsigned int io_allocated;
     ARRAY* free_io;
-    ARRAY* assembly_io;
+    //keyed by (src, id, proto). IP_ASSEMBLY_HASH_SIZE entries, allocated once on init
+    IPS_ASSEMBLY* assembly;
+    unsigned int assembly_count;
+    //reassembly stats: completed, timed out, evicted by new one, dropped as malformed or too big, fragments with no new data
+    unsigned int assembled, assembly_timeouts, assembly_evictions, assembly_drops, fragment_dups;
 #endif //IP_FRAGMENTATION
 } IPS;
 
@@ -64,9 +86,10 @@ typedef struct {
 } IP_STACK;
 
 //from tcpip
-void ips_init(TCPIPS* tcpips);
+bool ips_init(TCPIPS* tcpips);
 void ips_request(TCPIPS* tcpips, IPC* ipc);
 void ips_link_changed(TCPIPS* tcpips, bool link);
+void ips_get_stats(TCPIPS* tcpips, TCPIP_STATS* stats);
 #if (IP_FRAGMENTATION)
 void ips_timer(TCPIPS* tcpips, unsigned int seconds);
 #endif //IP_FRAGMENTATION
@@ -76,6 +99,11 @@ IO* ips_allocate_io(TCPIPS* tcpips, unsigned int size, uint8_t proto);
 //release previously allocated io. IO is not actually freed, just put in queue of free ios
 void ips_release_io(TCPIPS* tcpips, IO* io);
 void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst);
+#if (TCPIP_TX_GATHER)
+//transmit data by reference after io data. Data must be valid until frame is released
+void ips_gather(IO* io, const void* data, unsigned int size);
+unsigned int ips_gather_size(IO* io);
+#endif //TCPIP_TX_GATHER
 
 //from mac
 void ips_rx(TCPIPS* tcpips, IO* io);
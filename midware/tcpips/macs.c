@@ -11,12 +11,14 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
+#include "../../userspace/systime.h"
 #include "arps.h"
 #include <string.h>
 
 void macs_init(TCPIPS* tcpips)
 {
     memset(&tcpips->macs.mac, 0, sizeof(MAC));
+    tcpips->macs.rx_drops = 0;
 #if (MAC_FIREWALL)
     tcpips->macs.firewall_enabled = false;
 #endif //MAC_FIREWALL
@@ -77,13 +79,22 @@ void macs_link_changed(TCPIPS* tcpips, bool link)
     }
 }
 
+static void macs_drop(TCPIPS* tcpips, IO* io)
+{
+    ++tcpips->macs.rx_drops;
+    tcpips_release_io(tcpips, io);
+}
+
 void macs_rx(TCPIPS* tcpips, IO* io)
 {
+#if (TCPIP_PROFILE)
+    SYSTIME uptime;
+#endif //TCPIP_PROFILE
     uint16_t lentype;
     MAC_HEADER* hdr = io_data(io);
     if (io->data_size < sizeof(MAC_HEADER))
     {
-        tcpips_release_io(tcpips, io);
+        macs_drop(tcpips, io);
         return;
     }
     lentype = be2short(hdr->lentype_be);
@@ -95,19 +106,19 @@ void macs_rx(TCPIPS* tcpips, IO* io)
         //enable broadcast only for ARP
         if (lentype != ETHERTYPE_ARP)
         {
-            tcpips_release_io(tcpips, io);
+            macs_drop(tcpips, io);
             return;
         }
         break;
     case MAC_MULTICAST_ADDRESS:
         //drop all multicast
-        tcpips_release_io(tcpips, io);
+        macs_drop(tcpips, io);
         return;
     default:
         //enable unicast only on address compare
         if (!mac_compare(&tcpips->macs.mac, &hdr->dst))
         {
-            tcpips_release_io(tcpips, io);
+            macs_drop(tcpips, io);
             return;
         }
         break;
@@ -122,7 +133,7 @@ void macs_rx(TCPIPS* tcpips, IO* io)
         mac_print(&hdr->src);
         printf(" Firewall condition\n");
 #endif //TCPIP_MAC_DEBUG
-        tcpips_release_io(tcpips, io);
+        macs_drop(tcpips, io);
         return;
     }
 #endif //MAC_FIREWALL
@@ -139,7 +150,13 @@ void macs_rx(TCPIPS* tcpips, IO* io)
     switch (lentype)
     {
     case ETHERTYPE_IP:
+#if (TCPIP_PROFILE)
+        get_uptime(&uptime);
+        ips_rx(tcpips, io);
+        tcpips->ip_rx_us += systime_elapsed_us(&uptime);
+#else
         ips_rx(tcpips, io);
+#endif //TCPIP_PROFILE
         break;
     case ETHERTYPE_ARP:
         arps_rx(tcpips, io);
@@ -148,7 +165,7 @@ void macs_rx(TCPIPS* tcpips, IO* io)
 #if ((TCPIP_MAC_DEBUG))
         printf("MAC: dropped lentype: %04X\n", lentype);
 #endif //TCPIP_MAC_DEBUG
-        tcpips_release_io(tcpips, io);
+        macs_drop(tcpips, io);
         break;
     }
 }
@@ -16,6 +16,8 @@
 
 typedef struct {
     MAC mac;
+    //frames dropped by filter, firewall or with unknown len/type
+    unsigned int rx_drops;
 #if (MAC_FIREWALL)
     MAC src;
     bool firewall_enabled;
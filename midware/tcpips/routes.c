@@ -11,28 +11,22 @@
 #include "arps.h"
 #include "macs.h"
 #include "icmps.h"
+#include "../../userspace/stdlib.h"
 
-#define ROUTE_QUEUE_ITEM(tcpips, i)                    ((ROUTE_QUEUE_ENTRY*)array_at((tcpips)->routes.tx_queue, i))
-
-typedef struct {
-    IO* io;
-    IP ip;
-} ROUTE_QUEUE_ENTRY;
-
-void routes_init(TCPIPS* tcpips)
+bool routes_init(TCPIPS* tcpips)
 {
-    array_create(&tcpips->routes.tx_queue, sizeof(ROUTE_QUEUE_ENTRY), 1);
+    rb_init(&tcpips->routes.tx_rb, TCPIP_MAX_FRAMES_COUNT + 1);
+    tcpips->routes.drops = 0;
+    tcpips->routes.tx_queue = malloc((TCPIP_MAX_FRAMES_COUNT + 1) * sizeof(ROUTE_QUEUE_ENTRY));
+    return tcpips->routes.tx_queue != NULL;
 }
 
 bool routes_drop(TCPIPS* tcpips)
 {
-    if (array_size(tcpips->routes.tx_queue))
-    {
-        tcpips_release_io(tcpips, ROUTE_QUEUE_ITEM(tcpips, 0)->io);
-        array_remove(&tcpips->routes.tx_queue, 0);
-        return true;
-    }
-    return false;
+    if (rb_is_empty(&tcpips->routes.tx_rb))
+        return false;
+    tcpips_release_io(tcpips, tcpips->routes.tx_queue[rb_get(&tcpips->routes.tx_rb)].io);
+    return true;
 }
 
 void routes_link_changed(TCPIPS* tcpips, bool link)
@@ -44,31 +38,42 @@ void routes_link_changed(TCPIPS* tcpips, bool link)
     }
 }
 
-void routes_resolved(TCPIPS* tcpips, const IP* ip, const MAC* mac)
+/*
+    forward or drop all frames to ip in single pass. Rest are rotated to head, keeping order.
+    Frames, queued or dropped while processing, are not affecting pass
+*/
+static void routes_flush(TCPIPS* tcpips, const IP* ip, const MAC* mac)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->routes.tx_queue); ++i)
-        if (ROUTE_QUEUE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-        {
+    ROUTE_QUEUE_ENTRY item;
+    unsigned int count;
+    for (count = rb_size(&tcpips->routes.tx_rb); count && !rb_is_empty(&tcpips->routes.tx_rb); --count)
+    {
+        item = tcpips->routes.tx_queue[rb_get(&tcpips->routes.tx_rb)];
+        if (item.ip.u32.ip != ip->u32.ip)
+            tcpips->routes.tx_queue[rb_put(&tcpips->routes.tx_rb)] = item;
+        else if (mac != NULL)
             //forward to MAC
-            macs_tx(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io, mac, ETHERTYPE_IP);
-            array_remove(&tcpips->routes.tx_queue, i);
-        }
-}
-
-void routes_not_resolved(TCPIPS* tcpips, const IP* ip)
-{
-    int i;
-    for (i = 0; i < array_size(tcpips->routes.tx_queue); ++i)
-        if (ROUTE_QUEUE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
+            macs_tx(tcpips, item.io, mac, ETHERTYPE_IP);
+        else
         {
 #if (ICMP)
-            icmps_no_route(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io);
+            icmps_no_route(tcpips, item.io);
 #endif //ICMP
             //drop if not resolved
-            tcpips_release_io(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io);
-            array_remove(&tcpips->routes.tx_queue, i);
+            ++tcpips->routes.drops;
+            tcpips_release_io(tcpips, item.io);
         }
+    }
+}
+
+void routes_resolved(TCPIPS* tcpips, const IP* ip, const MAC* mac)
+{
+    routes_flush(tcpips, ip, mac);
+}
+
+void routes_not_resolved(TCPIPS* tcpips, const IP* ip)
+{
+    routes_flush(tcpips, ip, NULL);
 }
 
 void routes_tx(TCPIPS* tcpips, IO* io, const IP* target)
@@ -80,9 +85,8 @@ void routes_tx(TCPIPS* tcpips, IO* io, const IP* target)
         macs_tx(tcpips, io, &mac, ETHERTYPE_IP);
     else
     {
-        //queue before address is resolved
-        array_append(&tcpips->routes.tx_queue);
-        item = ROUTE_QUEUE_ITEM(tcpips, array_size(tcpips->routes.tx_queue) - 1);
+        //queue before address is resolved. Can't overflow: every queued io is frame from pool
+        item = &tcpips->routes.tx_queue[rb_put(&tcpips->routes.tx_rb)];
         item->io = io;
         item->ip.u32.ip = target->u32.ip;
     }
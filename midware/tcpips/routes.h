@@ -16,14 +16,24 @@
 #include "tcpips.h"
 #include "../../userspace/eth.h"
 #include "../../userspace/ip.h"
-#include "../../userspace/array.h"
+#include "../../userspace/rb.h"
+#include "sys_config.h"
 
 typedef struct {
-    ARRAY* tx_queue;
+    IO* io;
+    IP ip;
+} ROUTE_QUEUE_ENTRY;
+
+typedef struct {
+    //frames, waiting for ARP resolve. Never more, than frames in pool. Allocated once on init
+    ROUTE_QUEUE_ENTRY* tx_queue;
+    RB tx_rb;
+    //frames dropped, because ARP is not resolved
+    unsigned int drops;
 } ROUTES;
 
 //called from tcpip
-void routes_init(TCPIPS* tcpips);
+bool routes_init(TCPIPS* tcpips);
 bool routes_drop(TCPIPS* tcpips);
 void routes_link_changed(TCPIPS* tcpips, bool link);
 
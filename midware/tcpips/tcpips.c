@@ -14,6 +14,8 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/systime.h"
 #include "../../userspace/sys.h"
+#include "../../userspace/stdlib.h"
+#include <string.h>
 #include "sys_config.h"
 #include "macs.h"
 #include "arps.h"
@@ -57,6 +59,13 @@ static void print_conn_status(TCPIPS* tcpips, const char* head, ETH_CONN_TYPE co
 }
 #endif
 
+static inline void tcpips_update_io_used(TCPIPS* tcpips)
+{
+    unsigned int used = tcpips->io_allocated - array_size(tcpips->free_io);
+    if (used > tcpips->io_used_max)
+        tcpips->io_used_max = used;
+}
+
 static IO* tcpips_allocate_io_internal(TCPIPS* tcpips)
 {
     IO* io = NULL;
@@ -64,7 +73,25 @@ static IO* tcpips_allocate_io_internal(TCPIPS* tcpips)
     {
         io = *((IO**)array_at(tcpips->free_io, array_size(tcpips->free_io) - 1));
         array_remove(&tcpips->free_io, array_size(tcpips->free_io) - 1);
+        tcpips_update_io_used(tcpips);
+    }
+    return io;
+}
+
+static IO* tcpips_create_io(TCPIPS* tcpips)
+{
+    //frame is read with FRAME_MAX_SIZE, headroom is left free for upper layers
+    IO* io = io_create(FRAME_MAX_SIZE + TCP_FRAME_HEADROOM + tcpips->eth_header_size);
+    if (io != NULL)
+    {
+        ++tcpips->io_allocated;
+        io->data_offset += tcpips->eth_header_size;
+        tcpips_update_io_used(tcpips);
     }
+#if (TCPIP_DEBUG_ERRORS)
+    else
+        printf("TCPIP: out of memory\n");
+#endif
     return io;
 }
 
@@ -74,30 +101,21 @@ IO* tcpips_allocate_io(TCPIPS* tcpips)
     if (io == NULL)
     {
         if (tcpips->io_allocated < TCPIP_MAX_FRAMES_COUNT)
-        {
-            io = io_create(FRAME_MAX_SIZE + tcpips->eth_header_size);
-            if (io != NULL)
-            {
-                ++tcpips->io_allocated;
-                io->data_offset += tcpips->eth_header_size;
-            }
-#if (TCPIP_DEBUG_ERRORS)
-            else
-                printf("TCPIP: out of memory\n");
-#endif
-        }
+            io = tcpips_create_io(tcpips);
         //try to drop first in queue, waiting for resolve
         else if (routes_drop(tcpips))
         {
+            ++tcpips->io_drops;
             io = tcpips_allocate_io_internal(tcpips);
 #if (TCPIP_DEBUG)
             printf("TCPIP warning: io dropped from route queue\n");
 #endif
         }
-        else if (array_size(tcpips->tx_queue))
+        else if (!rb_is_empty(&tcpips->tx_rb))
         {
-            io = *((IO**)array_at(tcpips->tx_queue, 0));
-            array_remove(&tcpips->tx_queue, 0);
+            io = tcpips->tx_queue[rb_get(&tcpips->tx_rb)];
+            --tcpips->tx_count;
+            ++tcpips->io_drops;
             tcpips_release_io(tcpips, io);
             io = tcpips_allocate_io_internal(tcpips);
 #if (TCPIP_DEBUG)
@@ -115,9 +133,39 @@ IO* tcpips_allocate_io(TCPIPS* tcpips)
     return io;
 }
 
+unsigned int tcpips_io_available(TCPIPS* tcpips)
+{
+    return array_size(tcpips->free_io) + TCPIP_MAX_FRAMES_COUNT - tcpips->io_allocated;
+}
+
+/*
+    keep TCPIP_RX_FRAMES posted to driver. Only last one can drop queued tx frames. Others are posted only if
+    same count of frames is left for replies, otherwise received burst will drop own replies
+*/
+static void tcpips_rx_refill(TCPIPS* tcpips)
+{
+    IO* io;
+    while (tcpips->connected && tcpips->rx_count < TCPIP_RX_FRAMES)
+    {
+        if (tcpips->rx_count == 0)
+            io = tcpips_allocate_io(tcpips);
+        else if (tcpips_io_available(tcpips) <= TCPIP_RX_FRAMES)
+            return;
+        else if ((io = tcpips_allocate_io_internal(tcpips)) == NULL)
+            io = tcpips_create_io(tcpips);
+        if (io == NULL)
+            return;
+        ++tcpips->rx_count;
+        io_read(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_READ), tcpips->eth_handle, io, FRAME_MAX_SIZE);
+    }
+}
+
 void tcpips_release_io(TCPIPS* tcpips, IO* io)
 {
     IO** iop;
+#if (TCPIP_TX_GATHER)
+    tcps_gather_released(tcpips, io);
+#endif //TCPIP_TX_GATHER
     io_reset(io);
     io->data_offset += tcpips->eth_header_size;
     iop = array_append(&tcpips->free_io);
@@ -125,28 +173,27 @@ void tcpips_release_io(TCPIPS* tcpips, IO* io)
         *iop = io;
 }
 
-static void tcpips_rx_next(TCPIPS* tcpips)
+static void tcpips_eth_tx(TCPIPS* tcpips, IO* io)
 {
-    IO* io = tcpips_allocate_io(tcpips);
-    if (io == NULL)
+#if (TCPIP_TX_GATHER)
+    //transmitted frame is having stack only with ETH gather
+    if (io->stack_size)
+    {
+        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, ETH_WRITE_GATHER), tcpips->eth_handle, io);
         return;
-    io_read(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_READ), tcpips->eth_handle, io, FRAME_MAX_SIZE);
+    }
+#endif //TCPIP_TX_GATHER
+    io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, io);
 }
 
 void tcpips_tx(TCPIPS* tcpips, IO *io)
 {
-#if (ETH_DOUBLE_BUFFERING)
-    if (++tcpips->tx_count > 2)
-#else
-    if (++tcpips->tx_count > 1)
-#endif
-    {
-        //add to queue
-        array_append(&tcpips->tx_queue);
-        *((IO**)array_at(tcpips->tx_queue, array_size(tcpips->tx_queue) - 1)) = io;
-    }
+    ++tcpips->tx_frames;
+    //add to queue. Can't overflow: every queued io is frame from pool
+    if (++tcpips->tx_count > TCPIP_TX_FRAMES)
+        tcpips->tx_queue[rb_put(&tcpips->tx_rb)] = io;
     else
-        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, io);
+        tcpips_eth_tx(tcpips, io);
 }
 
 static inline void tcpips_open(TCPIPS* tcpips, unsigned int eth_handle, HANDLE eth, ETH_CONN_TYPE conn, HANDLE app)
@@ -185,31 +232,41 @@ static inline void tcpips_close(TCPIPS* tcpips)
 
 static inline void tcpips_eth_rx(TCPIPS* tcpips, IO* io, int param3)
 {
-    if (tcpips->connected)
-        tcpips_rx_next(tcpips);
+    --tcpips->rx_count;
     if (param3 < 0)
     {
+        //cancelled or driver is out of buffers. Don't repost right now, ring is refilled after request processing
+        ++tcpips->rx_errors;
         tcpips_release_io(tcpips, io);
         return;
     }
+#if (TCPIP_PROFILE)
+    SYSTIME uptime;
+#endif //TCPIP_PROFILE
+    ++tcpips->rx_frames;
+    //repost before processing, so back-to-back frames are not dropped by driver
+    tcpips_rx_refill(tcpips);
+    if (tcpips->rx_count < TCPIP_RX_FRAMES)
+        ++tcpips->rx_starved;
     //forward to MAC
+#if (TCPIP_PROFILE)
+    get_uptime(&uptime);
     macs_rx(tcpips, io);
+    tcpips->rx_us += systime_elapsed_us(&uptime);
+#else
+    macs_rx(tcpips, io);
+#endif //TCPIP_PROFILE
 }
 
 static inline void tcpips_eth_tx_complete(TCPIPS* tcpips, IO* io, int param3)
 {
     IO* queue_io;
     tcpips_release_io(tcpips, io);
-#if (ETH_DOUBLE_BUFFERING)
-    if (--tcpips->tx_count >= 2)
-#else
-    if (--tcpips->tx_count >= 1)
-#endif
+    //send next in queue
+    if (--tcpips->tx_count >= TCPIP_TX_FRAMES)
     {
-        //send next in queue
-        queue_io = *((IO**)array_at(tcpips->tx_queue, 0));
-        array_remove(&tcpips->tx_queue, 0);
-        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, queue_io);
+        queue_io = tcpips->tx_queue[rb_get(&tcpips->tx_rb)];
+        tcpips_eth_tx(tcpips, queue_io);
     }
 }
 
@@ -223,18 +280,14 @@ static void tcpips_link_changed_internal(TCPIPS* tcpips, ETH_CONN_TYPE conn)
 
     if (tcpips->connected)
     {
-        tcpips_rx_next(tcpips);
-#if (ETH_DOUBLE_BUFFERING)
-        tcpips_rx_next(tcpips);
-#endif
+        tcpips_rx_refill(tcpips);
     }
     else
     {
         //flush TX queue
-        while (array_size(tcpips->tx_queue))
+        while (!rb_is_empty(&tcpips->tx_rb))
         {
-            tcpips_release_io(tcpips, array_at(tcpips->tx_queue, 0));
-            array_remove(&tcpips->tx_queue, 0);
+            tcpips_release_io(tcpips, tcpips->tx_queue[rb_get(&tcpips->tx_rb)]);
             --tcpips->tx_count;
         }
     }
@@ -273,7 +326,7 @@ static inline void tcpips_eth_remote_close(TCPIPS* tcpips)
     tcpips_close_internal(tcpips);
 }
 
-void tcpips_init(TCPIPS* tcpips)
+static bool tcpips_init(TCPIPS* tcpips)
 {
     tcpips->app = INVALID_HANDLE;
     tcpips->timer = INVALID_HANDLE;
@@ -281,19 +334,21 @@ void tcpips_init(TCPIPS* tcpips)
     tcpips->connected = false;
     tcpips->io_allocated = 0;
     tcpips->eth_header_size = 0;
-#if (ETH_DOUBLE_BUFFERING)
-    //2 rx + 2 tx + 1 for processing
-    array_create(&tcpips->free_io, sizeof(IO*), 5);
-#else
-    //1 rx + 1 tx + 1 for processing
-    array_create(&tcpips->free_io, sizeof(IO*), 3);
-#endif
-    array_create(&tcpips->tx_queue, sizeof(IO*), 1);
+    tcpips->rx_count = tcpips->rx_errors = tcpips->rx_starved = 0;
+    tcpips->rx_frames = tcpips->tx_frames = tcpips->io_used_max = tcpips->io_drops = 0;
+#if (TCPIP_PROFILE)
+    tcpips->rx_us = tcpips->ip_rx_us = tcpips->tcp_rx_us = tcpips->udp_rx_us = 0;
+#endif //TCPIP_PROFILE
+    //rx + tx + 1 for processing
+    array_create(&tcpips->free_io, sizeof(IO*), TCPIP_RX_FRAMES + TCPIP_TX_FRAMES + 1);
+    rb_init(&tcpips->tx_rb, TCPIP_MAX_FRAMES_COUNT + 1);
     tcpips->tx_count = 0;
+    //fixed size tables are on heap, not in process stack with TCPIPS
+    if ((tcpips->tx_queue = malloc((TCPIP_MAX_FRAMES_COUNT + 1) * sizeof(IO*))) == NULL)
+        return false;
     macs_init(tcpips);
-    arps_init(tcpips);
-    routes_init(tcpips);
-    ips_init(tcpips);
+    if (!arps_init(tcpips) || !routes_init(tcpips) || !ips_init(tcpips))
+        return false;
 #if (ICMP)
     icmps_init(tcpips);
 #endif //ICMP
@@ -307,6 +362,7 @@ void tcpips_init(TCPIPS* tcpips)
     dnss_init(tcpips);
 #endif //UDP
     tcps_init(tcpips);
+    return true;
 }
 
 static inline void tcpips_timer(TCPIPS* tcpips)
@@ -330,6 +386,42 @@ static inline void tcpips_get_conn_state(TCPIPS* tcpips, HANDLE process)
     error(ERROR_SYNC);
 }
 
+static inline void tcpips_get_stats(TCPIPS* tcpips, IPC* ipc)
+{
+    IO* io = (IO*)ipc->param2;
+    TCPIP_STATS* stats;
+    if (io_get_free(io) < sizeof(TCPIP_STATS))
+    {
+        error(ERROR_IO_BUFFER_TOO_SMALL);
+        return;
+    }
+    stats = io_data(io);
+    memset(stats, 0, sizeof(TCPIP_STATS));
+    stats->rx_frames = tcpips->rx_frames;
+    stats->tx_frames = tcpips->tx_frames;
+    stats->rx_errors = tcpips->rx_errors;
+    stats->rx_starved = tcpips->rx_starved;
+    stats->io_allocated = tcpips->io_allocated;
+    stats->io_used_max = tcpips->io_used_max;
+    stats->io_drops = tcpips->io_drops;
+    stats->mac_drops = tcpips->macs.rx_drops;
+    ips_get_stats(tcpips, stats);
+    stats->arp_misses = tcpips->arps.misses;
+    stats->arp_drops = tcpips->routes.drops;
+    tcps_get_stats(tcpips, stats);
+#if (UDP)
+    stats->udp_rx = tcpips->udps.rx;
+#endif //UDP
+#if (TCPIP_PROFILE)
+    stats->rx_us = tcpips->rx_us;
+    stats->ip_rx_us = tcpips->ip_rx_us;
+    stats->tcp_rx_us = tcpips->tcp_rx_us;
+    stats->udp_rx_us = tcpips->udp_rx_us;
+#endif //TCPIP_PROFILE
+    io->data_size = sizeof(TCPIP_STATS);
+    ipc->param3 = sizeof(TCPIP_STATS);
+}
+
 static inline void tcpips_request(TCPIPS* tcpips, IPC* ipc)
 {
     switch (HAL_ITEM(ipc->cmd))
@@ -346,6 +438,9 @@ static inline void tcpips_request(TCPIPS* tcpips, IPC* ipc)
     case TCPIP_GET_CONN_STATE:
         tcpips_get_conn_state(tcpips, ipc->process);
         break;
+    case TCPIP_GET_STATS:
+        tcpips_get_stats(tcpips, ipc);
+        break;
     default:
         error(ERROR_NOT_SUPPORTED);
         break;
@@ -378,10 +473,16 @@ void tcpips_main()
 {
     IPC ipc;
     TCPIPS tcpips;
-    tcpips_init(&tcpips);
 #if (TCPIP_DEBUG)
     open_stdout();
 #endif
+    if (!tcpips_init(&tcpips))
+    {
+#if (TCPIP_DEBUG)
+        printf("TCPIP: out of memory\n");
+#endif
+        process_exit();
+    }
     for (;;)
     {
         ipc_read(&ipc);
@@ -430,5 +531,8 @@ void tcpips_main()
             break;
         }
         ipc_write(&ipc);
+        //receive ring was starving on frames, held by stack
+        if (tcpips.rx_count < TCPIP_RX_FRAMES)
+            tcpips_rx_refill(&tcpips);
     }
 }
@@ -24,6 +24,8 @@ extern const IP __BROADCAST;
 
 //allocate io. Find in queue of free io, or allocate new. Handle must be checked on return
 IO* tcpips_allocate_io(TCPIPS* tcpips);
+//count of ios, which can be allocated without dropping queued frames
+unsigned int tcpips_io_available(TCPIPS* tcpips);
 //release previously allocated io. Io is not actually freed, just put in queue of free ios
 void tcpips_release_io(TCPIPS* tcpips, IO* io);
 //transmit. If tx operation is in place (2 tx for double buffering), io will be putted in queue for later processing
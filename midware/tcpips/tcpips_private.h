@@ -10,6 +10,7 @@
 #define TCPIPS_PRIVATE_H
 
 #include "../../userspace/array.h"
+#include "../../userspace/rb.h"
 #include "../../userspace/eth.h"
 #include "../../userspace/mac.h"
 #include "../../userspace/ip.h"
@@ -31,8 +32,18 @@ typedef struct _TCPIPS {
     ETH_CONN_TYPE conn;
     //stack itself - private use
     unsigned int io_allocated, tx_count, eth_handle, eth_header_size;
+    //receive frames, posted to driver. Completed with error, frames received with ring not full
+    unsigned int rx_count, rx_errors, rx_starved;
+    //stats: frames received and sent, highest frames in use, frames dropped from queues on pool exhaust
+    unsigned int rx_frames, tx_frames, io_used_max, io_drops;
+#if (TCPIP_PROFILE)
+    //time in receive path, including upper layers: from MAC, from IP, from TCP, from UDP. us
+    unsigned int rx_us, ip_rx_us, tcp_rx_us, udp_rx_us;
+#endif //TCPIP_PROFILE
     ARRAY* free_io;
-    ARRAY* tx_queue;
+    //frames, waiting for driver. Never more, than frames in pool. Allocated once on init
+    IO** tx_queue;
+    RB tx_rb;
     bool connected;
     MACS macs;
     IPS ips;
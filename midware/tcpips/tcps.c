@@ -18,8 +18,19 @@
 
 #define TCP_MSS_MAX                                      (IP_FRAME_MAX_DATA_SIZE - sizeof(TCP_HEADER))
 #define TCP_MSS_MIN                                      536
+//no window scaling
+#define TCP_CWND_MAX                                     0xffff
+#define TCP_DUP_ACK_THRESHOLD                            3
+//frames, left for rx and control segments on burst transmit and out of order queue
+#define TCP_FRAMES_RESERVE                               2
+//option space is 40 bytes
+#define TCP_SACK_BLOCKS_MAX                              4
+//smaller segments are copied, it's cheaper than gather bookkeeping
+#define TCP_GATHER_MIN                                   128
 
 #define MSL_MS                                           60000
+//RFC 6298 initial retransmission timeout, ms
+#define TCP_RTO_INITIAL                                  1000
 
 #pragma pack(push, 1)
 typedef struct {
@@ -43,7 +54,7 @@ typedef struct {
 #pragma pack(pop)
 
 typedef struct {
-    HANDLE process;
+    HANDLE process, next;
     uint16_t port;
 } TCP_LISTEN_HANDLE;
 
@@ -60,21 +71,69 @@ typedef enum {
     TCP_STATE_MAX
 } TCP_STATE;
 
+//single timer per connection: delayed ACK, retransmission or state timeout
+typedef enum {
+    TCP_TIMER_IDLE = 0,
+    TCP_TIMER_ACK,
+    TCP_TIMER_RTO,
+    TCP_TIMER_STATE
+} TCP_TIMER;
+
 typedef struct {
     HANDLE process;
     IP remote_addr;
     IO* rx;
     IO* rx_tmp;
-    IO* tx;
+    //user write IOs, starting from tx_head. Head is partially acked on tx_cur
+    ARRAY* tx_queue;
+    unsigned int tx_head;
     HANDLE timer;
-    unsigned int tx_cur, rx_cur;
-    uint32_t snd_una, snd_nxt, rcv_nxt;
+    TCP_TIMER timer_mode;
+    //retransmission timeout, ms. Doubled on each timeout until new RTT sample. Counted from rto_start
+    unsigned int rto;
+    SYSTIME rto_start;
+    //hash chains: by 4-tuple and by local port
+    HANDLE hash_next, port_next;
+    unsigned int tx_cur, rx_cur, cwnd, ssthresh;
+    //snd_nxt is end of queued data, snd_pos is next to transmit, snd_max is highest transmitted
+    uint32_t snd_una, snd_nxt, snd_pos, snd_max, recover, rcv_nxt;
 
     TCP_STATE state;
-    uint16_t remote_port, local_port, mss, rx_wnd, tx_wnd, retry;
-    bool active, transmit, fin;
+    //ack_segs - received segments, not acknowledged yet
+    uint16_t remote_port, local_port, mss, rx_wnd, tx_wnd, retry, dup_acks, ack_segs;
+    bool active, transmit, fin, recovery, wnd_changed;
+    //one segment is timed per RTT, until ACK of rtt_seq
+    bool rtt_timing;
+    uint32_t rtt_seq;
+    SYSTIME rtt_start;
+    //RTT estimation, us. SRTT is scaled by 8, RTTVAR by 4. Zero SRTT - no samples yet
+    unsigned int srtt, rttvar;
+#if (TCP_OOO_MAX)
+    //future segments, sorted by seq
+    IO* ooo[TCP_OOO_MAX];
+    unsigned int ooo_count;
+    uint32_t ooo_last;
+    bool sack;
+#endif //TCP_OOO_MAX
+#if (TCP_ZERO_COPY_FRAMES)
+    //zero copy receive: frames, not requested by user yet. Held - queued and passed to user, not released
+    ARRAY* rx_frames;
+    unsigned int rx_held, rx_reqs;
+    bool zero_copy;
+#endif //TCP_ZERO_COPY_FRAMES
 } TCP_TCB;
 
+#if (TCPIP_TX_GATHER)
+typedef struct {
+    IO* frame;
+    //user write IO, referenced by frame. Completion is parked until all referencing frames are released
+    IO* io;
+    HANDLE process, tcb_handle;
+    int param3;
+    bool parked;
+} TCP_GATHER;
+#endif //TCPIP_TX_GATHER
+
 #if (TCP_DEBUG_PACKETS)
 static const char* __TCP_FLAGS[TCP_FLAGS_COUNT] =                   {"FIN", "SYN", "RST", "PSH", "ACK", "URG"};
 #endif //TCP_DEBUG_PACKETS
@@ -196,6 +255,49 @@ static void tcps_append_mss(IO* io)
     tcps_append_opt(io, TCP_OPTS_MSS, mss_be, 2 + 2);
 }
 
+#if (TCP_OOO_MAX)
+static void tcps_append_sack(IO* io, TCP_TCB* tcb)
+{
+    uint8_t data[TCP_SACK_BLOCKS_MAX * 8];
+    uint32_t left[TCP_SACK_BLOCKS_MAX];
+    uint32_t right[TCP_SACK_BLOCKS_MAX];
+    uint32_t seq, end;
+    unsigned int i, j, count, recent;
+    if (!tcb->sack)
+        return;
+    //merge queued segments to blocks
+    for (i = count = recent = 0; i < tcb->ooo_count; ++i)
+    {
+        seq = be2int(((TCP_HEADER*)io_data(tcb->ooo[i]))->seq_be);
+        end = seq + tcps_data_len(tcb->ooo[i]);
+        if (count && tcps_diff(right[count - 1], seq) <= 0)
+        {
+            if (tcps_diff(right[count - 1], end) > 0)
+                right[count - 1] = end;
+        }
+        else if (count < TCP_SACK_BLOCKS_MAX)
+        {
+            left[count] = seq;
+            right[count++] = end;
+        }
+        else
+            break;
+        if (seq == tcb->ooo_last)
+            recent = count - 1;
+    }
+    if (count == 0)
+        return;
+    //block with most recently received segment goes first
+    for (i = 0; i < count; ++i)
+    {
+        j = (i == 0) ? recent : ((i <= recent) ? i - 1 : i);
+        int2be(data + i * 8, left[j]);
+        int2be(data + i * 8 + 4, right[j]);
+    }
+    tcps_append_opt(io, TCP_OPTS_SACK, data, 2 + count * 8);
+}
+#endif //TCP_OOO_MAX
+
 #if (TCP_DEBUG_PACKETS)
 static void tcps_debug(IO* io, const IP* src, const IP* dst)
 {
@@ -245,6 +347,14 @@ static void tcps_debug(IO* io, const IP* src, const IP* dst)
             case TCP_OPTS_MSS:
                 printf("MSS:%d", be2short(opt->data));
                 break;
+            case TCP_OPTS_SACK_PERMITTED:
+                printf("SACK_PERM");
+                break;
+            case TCP_OPTS_SACK:
+                printf("SACK");
+                for (j = 0; j + 8 <= opt->len - 2; j += 8)
+                    printf(":%u-%u", be2int(opt->data + j), be2int(opt->data + j + 4));
+                break;
             default:
                 printf("K%d", opt->kind);
                 for (j = 0; j < opt->len - 2; ++j)
@@ -285,31 +395,176 @@ static uint32_t tcps_gen_isn()
     return (uptime.sec % 17179) + (uptime.usec >> 2);
 }
 
+//RFC 5681 initial window
+static unsigned int tcps_initial_cwnd(uint16_t mss)
+{
+    if (mss > 2190)
+        return 2 * mss;
+    if (mss > 1095)
+        return 3 * mss;
+    return 4 * mss;
+}
+
 static bool tcps_update_rx_wnd(TCP_TCB* tcb)
 {
-    bool need_update = tcb->rx_wnd < (TCP_MSS_MAX / 2);
-    tcb->rx_wnd = TCP_MSS_MAX;
-    if (tcb->rx != NULL)
-        tcb->rx_wnd += io_get_free(tcb->rx);
-    if (tcb->rx_tmp != NULL)
-        tcb->rx_wnd = io_get_free(tcb->rx_tmp);
-    return need_update;
+    unsigned int wnd = tcb->rx_wnd;
+#if (TCP_ZERO_COPY_FRAMES)
+    //one frame per segment, frames held by user are closing window
+    if (tcb->zero_copy)
+        tcb->rx_wnd = tcb->rx_held < TCP_ZERO_COPY_FRAMES ? (TCP_ZERO_COPY_FRAMES - tcb->rx_held) * TCP_MSS_MAX : 0;
+    else
+#endif //TCP_ZERO_COPY_FRAMES
+    {
+        tcb->rx_wnd = TCP_MSS_MAX;
+        if (tcb->rx != NULL)
+            tcb->rx_wnd += io_get_free(tcb->rx);
+        if (tcb->rx_tmp != NULL)
+            tcb->rx_wnd = io_get_free(tcb->rx_tmp);
+    }
+    //receiver SWS avoidance, RFC 1122 4.2.3.3: update, if window is opened at least by min(MSS, buffer / 2)
+    if (tcb->rx_wnd <= wnd)
+        return false;
+    return tcb->rx_wnd - wnd >= (tcb->rx_wnd / 2 < TCP_MSS_MAX ? tcb->rx_wnd / 2 : TCP_MSS_MAX);
 }
 
-static void tcps_timer_start(TCP_TCB* tcb)
+//RFC 6298 5.1: retransmission timer is running, while sent data is not acked. Zero window is probed on same timer
+static bool tcps_rto_pending(TCP_TCB* tcb)
 {
     switch (tcb->state)
     {
+    case TCP_STATE_SYN_SENT:
+    case TCP_STATE_SYN_RECEIVED:
+        return true;
+    default:
+        break;
+    }
+    return (tcb->snd_una != tcb->snd_max) || (tcb->tx_wnd == 0 && tcb->snd_pos != tcb->snd_nxt);
+}
+
+static void tcps_timer_stop(TCP_TCB* tcb, HANDLE tcb_handle)
+{
+    if (tcb->timer_mode == TCP_TIMER_IDLE)
+        return;
+    timer_stop(tcb->timer, tcb_handle, HAL_TCP);
+    tcb->timer_mode = TCP_TIMER_IDLE;
+}
+
+//arm timer for current connection state. Running timer of same kind is not restarted,
+//retransmission deadline is moved only by ACK of new data
+static void tcps_timer_start(TCP_TCB* tcb, HANDLE tcb_handle)
+{
+    TCP_TIMER mode = TCP_TIMER_IDLE;
+    unsigned int ms = 0;
+#if (TCP_DELAYED_ACK_MS)
+    if (tcb->ack_segs)
+    {
+        mode = TCP_TIMER_ACK;
+        ms = TCP_DELAYED_ACK_MS;
+    }
+    else
+#endif //TCP_DELAYED_ACK_MS
+    if (tcps_rto_pending(tcb))
+    {
+        mode = TCP_TIMER_RTO;
+        ms = tcb->rto;
+    }
+    else switch (tcb->state)
+    {
     case TCP_STATE_ESTABLISHED:
 #if !(TCP_KEEP_ALIVE)
-        if (!tcb->transmit)
-            break;
+        break;
 #endif //!TCP_KEEP_ALIVE
     default:
-        timer_start_ms(tcb->timer, TCP_TIMEOUT);
+        mode = TCP_TIMER_STATE;
+        ms = TCP_TIMEOUT;
+    }
+    if (mode == tcb->timer_mode)
+        return;
+    tcps_timer_stop(tcb, tcb_handle);
+    if (mode == TCP_TIMER_IDLE)
+        return;
+    if (mode == TCP_TIMER_RTO)
+        get_uptime(&tcb->rto_start);
+    tcb->timer_mode = mode;
+    timer_start_ms(tcb->timer, ms);
+}
+
+//acked user IO is skipped by head. Storage is compacted, when more than half is acked
+static void tcps_tx_queue_pop(TCP_TCB* tcb)
+{
+    unsigned int size;
+    if (++tcb->tx_head == array_size(tcb->tx_queue))
+    {
+        array_clear(&tcb->tx_queue);
+        tcb->tx_head = 0;
+        return;
+    }
+    size = array_size(tcb->tx_queue) - tcb->tx_head;
+    if (tcb->tx_head < size)
+        return;
+    memmove(array_at(tcb->tx_queue, 0), array_at(tcb->tx_queue, tcb->tx_head), size * sizeof(IO*));
+    //tail removal is not moving anything
+    for (; tcb->tx_head; --tcb->tx_head)
+        array_remove(&tcb->tx_queue, array_size(tcb->tx_queue) - 1);
+}
+
+#if (TCP_ZERO_COPY_FRAMES)
+//hide headers and apply flags. Frame is ready for user
+static void tcps_frame_prepare(IO* io, HANDLE tcb_handle)
+{
+    TCP_STACK* tcp_stack;
+    TCP_HEADER* tcp = io_data(io);
+    uint8_t flags = tcp->flags;
+    uint16_t urg = be2short(tcp->urgent_pointer_be);
+    io_hide(io, tcps_data_offset(io));
+    //room is reserved by TCP_FRAME_HEADROOM
+    tcp_stack = io_push(io, sizeof(TCP_STACK));
+    tcp_stack->flags = 0;
+    tcp_stack->urg_len = 0;
+    tcp_stack->owner = tcb_handle;
+    if (flags & TCP_FLAG_PSH)
+        tcp_stack->flags |= TCP_PSH;
+    if (flags & TCP_FLAG_URG)
+    {
+        tcp_stack->flags |= TCP_URG;
+        tcp_stack->urg_len = urg > io->data_size ? io->data_size : urg;
     }
 }
 
+static void tcps_release_frame(TCPIPS* tcpips, IO* io)
+{
+    io_pop(io, sizeof(TCP_STACK));
+    ips_release_io(tcpips, io);
+}
+
+static void tcps_deliver_frames(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    while (tcb->rx_reqs && array_size(tcb->rx_frames))
+    {
+        io = *((IO**)array_at(tcb->rx_frames, 0));
+        array_remove(&tcb->rx_frames, 0);
+        --tcb->rx_reqs;
+        io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, TCP_READ_FRAME), tcb_handle, io);
+    }
+}
+
+static bool tcps_queue_frame(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
+{
+    IO** iop;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //frame from foreign pool, without headroom
+    if (io_get_free(io) < sizeof(TCP_STACK) || (iop = array_append(&tcb->rx_frames)) == NULL)
+        return false;
+    *iop = io;
+    ++tcb->rx_held;
+    tcps_frame_prepare(io, tcb_handle);
+    tcps_deliver_frames(tcpips, tcb_handle);
+    return true;
+}
+#endif //TCP_ZERO_COPY_FRAMES
+
 static void tcps_rx_flush(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_STACK* tcp_stack;
@@ -331,13 +586,31 @@ static void tcps_rx_flush(TCPIPS* tcpips, HANDLE tcb_handle)
         ips_release_io(tcpips, tcb->rx_tmp);
         tcb->rx_tmp = NULL;
     }
+#if (TCP_ZERO_COPY_FRAMES)
+    //no more frames, queue is empty if user is waiting
+    for (; tcb->rx_reqs; --tcb->rx_reqs)
+        ipc_post_inline(tcb->process, HAL_CMD(HAL_TCP, TCP_READ_FRAME), tcb_handle, 0, ERROR_CONNECTION_CLOSED);
+#endif //TCP_ZERO_COPY_FRAMES
+}
+
+static inline unsigned int tcps_hash(uint32_t remote_ip, uint16_t remote_port, uint16_t local_port)
+{
+    uint32_t res = remote_ip ^ (((uint32_t)remote_port << 16) | local_port);
+    res ^= res >> 16;
+    res ^= res >> 8;
+    return res & (TCP_HASH_SIZE - 1);
+}
+
+static inline unsigned int tcps_port_hash(uint16_t port)
+{
+    return (port ^ (port >> 8)) & (TCP_HASH_SIZE - 1);
 }
 
 static HANDLE tcps_find_listener(TCPIPS* tcpips, uint16_t port)
 {
     HANDLE handle;
     TCP_LISTEN_HANDLE* tlh;
-    for (handle = so_first(&tcpips->tcps.listen); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.listen, handle))
+    for (handle = tcpips->tcps.listen_hash[tcps_port_hash(port)]; handle != INVALID_HANDLE; handle = tlh->next)
     {
         tlh = so_get(&tcpips->tcps.listen, handle);
         if (tlh->port == port)
@@ -346,11 +619,26 @@ static HANDLE tcps_find_listener(TCPIPS* tcpips, uint16_t port)
     return INVALID_HANDLE;
 }
 
+static void tcps_unlink_listener(TCPIPS* tcpips, HANDLE handle)
+{
+    HANDLE* cur;
+    TCP_LISTEN_HANDLE* tlh = so_get(&tcpips->tcps.listen, handle);
+    for (cur = &tcpips->tcps.listen_hash[tcps_port_hash(tlh->port)]; *cur != INVALID_HANDLE;
+         cur = &((TCP_LISTEN_HANDLE*)so_get(&tcpips->tcps.listen, *cur))->next)
+    {
+        if (*cur == handle)
+        {
+            *cur = tlh->next;
+            return;
+        }
+    }
+}
+
 static HANDLE tcps_find_tcb(TCPIPS* tcpips, const IP* src, uint16_t remote_port, uint16_t local_port)
 {
     HANDLE handle;
     TCP_TCB* tcb;
-    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    for (handle = tcpips->tcps.tcb_hash[tcps_hash(src->u32.ip, remote_port, local_port)]; handle != INVALID_HANDLE; handle = tcb->hash_next)
     {
         tcb = so_get(&tcpips->tcps.tcbs, handle);
         if (tcb->remote_port == remote_port && tcb->local_port == local_port && tcb->remote_addr.u32.ip == src->u32.ip)
@@ -363,7 +651,7 @@ static HANDLE tcps_find_tcb_local_port(TCPIPS* tcpips, uint16_t local_port)
 {
     HANDLE handle;
     TCP_TCB* tcb;
-    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    for (handle = tcpips->tcps.port_hash[tcps_port_hash(local_port)]; handle != INVALID_HANDLE; handle = tcb->port_next)
     {
         tcb = so_get(&tcpips->tcps.tcbs, handle);
         if (tcb->local_port == local_port)
@@ -372,10 +660,35 @@ static HANDLE tcps_find_tcb_local_port(TCPIPS* tcpips, uint16_t local_port)
     return INVALID_HANDLE;
 }
 
+static void tcps_unlink_tcb(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    HANDLE* cur;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    for (cur = &tcpips->tcps.tcb_hash[tcps_hash(tcb->remote_addr.u32.ip, tcb->remote_port, tcb->local_port)]; *cur != INVALID_HANDLE;
+         cur = &((TCP_TCB*)so_get(&tcpips->tcps.tcbs, *cur))->hash_next)
+    {
+        if (*cur == tcb_handle)
+        {
+            *cur = tcb->hash_next;
+            break;
+        }
+    }
+    for (cur = &tcpips->tcps.port_hash[tcps_port_hash(tcb->local_port)]; *cur != INVALID_HANDLE;
+         cur = &((TCP_TCB*)so_get(&tcpips->tcps.tcbs, *cur))->port_next)
+    {
+        if (*cur == tcb_handle)
+        {
+            *cur = tcb->port_next;
+            break;
+        }
+    }
+}
+
 static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, uint16_t remote_port, uint16_t local_port)
 {
     TCP_TCB* tcb;
     HANDLE handle;
+    unsigned int bucket;
     if (so_count(&tcpips->tcps.tcbs) > TCP_HANDLES_LIMIT)
     {
         error(ERROR_TOO_MANY_HANDLES);
@@ -397,7 +710,7 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->retry = 0;
     tcb->process = INVALID_HANDLE;
     tcb->remote_addr.u32.ip = remote_addr->u32.ip;
-    tcb->snd_una = tcb->snd_nxt = 0;
+    tcb->snd_una = tcb->snd_nxt = tcb->snd_pos = tcb->snd_max = tcb->recover = 0;
     tcb->rcv_nxt = 0;
     tcb->state = TCP_STATE_CLOSED;
     tcb->remote_port = remote_port;
@@ -406,24 +719,93 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->active = false;
     tcb->transmit = false;
     tcb->fin = false;
-    tcb->rx = tcb->tx = tcb->rx_tmp = NULL;
-    tcb->tx_cur = 0;
+    tcb->recovery = false;
+    tcb->wnd_changed = false;
+    tcb->rtt_timing = false;
+    tcb->srtt = tcb->rttvar = 0;
+    tcb->rx = tcb->rx_tmp = NULL;
+    tcb->tx_queue = NULL;
+    tcb->tx_head = tcb->tx_cur = 0;
+    tcb->timer_mode = TCP_TIMER_IDLE;
+    tcb->rto = TCP_RTO_INITIAL;
+    tcb->cwnd = tcps_initial_cwnd(TCP_MSS_MAX);
+    tcb->ssthresh = TCP_CWND_MAX;
+    tcb->dup_acks = tcb->ack_segs = 0;
+#if (TCP_OOO_MAX)
+    tcb->ooo_count = 0;
+    tcb->sack = false;
+#endif //TCP_OOO_MAX
+#if (TCP_ZERO_COPY_FRAMES)
+    tcb->rx_frames = NULL;
+    tcb->rx_held = tcb->rx_reqs = 0;
+    tcb->zero_copy = false;
+#endif //TCP_ZERO_COPY_FRAMES
     tcps_update_rx_wnd(tcb);
     tcb->tx_wnd = 0;
+    //link to demux chains
+    bucket = tcps_hash(remote_addr->u32.ip, remote_port, local_port);
+    tcb->hash_next = tcpips->tcps.tcb_hash[bucket];
+    tcpips->tcps.tcb_hash[bucket] = handle;
+    bucket = tcps_port_hash(local_port);
+    tcb->port_next = tcpips->tcps.port_hash[bucket];
+    tcpips->tcps.port_hash[bucket] = handle;
     return handle;
 }
 
+//return write IO to user
+static void tcps_tx_complete(TCPIPS* tcpips, HANDLE process, HANDLE tcb_handle, IO* io, int param3)
+{
+#if (TCPIP_TX_GATHER)
+    unsigned int i;
+    TCP_GATHER* gather;
+    bool parked = false;
+    for (i = 0; i < array_size(tcpips->tcps.gather); ++i)
+    {
+        gather = array_at(tcpips->tcps.gather, i);
+        if (gather->io == io)
+        {
+            gather->process = process;
+            gather->tcb_handle = tcb_handle;
+            gather->param3 = param3;
+            gather->parked = parked = true;
+        }
+    }
+    if (parked)
+        return;
+#endif //TCPIP_TX_GATHER
+    io_complete_ex(process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, io, param3);
+}
+
 static void tcps_destroy_tcb(TCPIPS* tcpips, HANDLE tcb_handle)
 {
+    unsigned int i;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 #if (TCP_DEBUG_FLOW)
     printf("%s -> 0\n", __TCP_STATES[tcb->state]);
 #endif //TCP_DEBUG_FLOW
-    timer_stop(tcb->timer, tcb_handle, HAL_TCP);
+    tcps_timer_stop(tcb, tcb_handle);
     timer_destroy(tcb->timer);
     tcps_rx_flush(tcpips, tcb_handle);
-    if (tcb->tx)
-        io_complete_ex(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx, ERROR_CONNECTION_CLOSED);
+    if (tcb->tx_queue != NULL)
+    {
+        for (i = tcb->tx_head; i < array_size(tcb->tx_queue); ++i)
+            tcps_tx_complete(tcpips, tcb->process, tcb_handle, *((IO**)array_at(tcb->tx_queue, i)), ERROR_CONNECTION_CLOSED);
+        array_destroy(&tcb->tx_queue);
+    }
+#if (TCP_OOO_MAX)
+    for (i = 0; i < tcb->ooo_count; ++i)
+        ips_release_io(tcpips, tcb->ooo[i]);
+#endif //TCP_OOO_MAX
+#if (TCP_ZERO_COPY_FRAMES)
+    //frames, passed to user, are released by user
+    if (tcb->rx_frames != NULL)
+    {
+        for (i = 0; i < array_size(tcb->rx_frames); ++i)
+            tcps_release_frame(tcpips, *((IO**)array_at(tcb->rx_frames, i)));
+        array_destroy(&tcb->rx_frames);
+    }
+#endif //TCP_ZERO_COPY_FRAMES
+    tcps_unlink_tcb(tcpips, tcb_handle);
     so_free(&tcpips->tcps.tcbs, tcb_handle);
 }
 
@@ -482,6 +864,7 @@ static inline bool tcps_set_mss(TCP_TCB* tcb, uint16_t mss)
     if (mss < TCP_MSS_MIN || mss > TCP_MSS_MAX)
         return false;
     tcb->mss = mss;
+    tcb->cwnd = tcps_initial_cwnd(mss);
     return true;
 }
 
@@ -502,6 +885,12 @@ static void tcps_apply_options(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
             tcps_set_mss(tcpips, tcb, be2short(opt->data));
 #endif //ICMP
             break;
+#if (TCP_OOO_MAX)
+        case TCP_OPTS_SACK_PERMITTED:
+            if (((TCP_HEADER*)io_data(io))->flags & TCP_FLAG_SYN)
+                tcb->sack = true;
+            break;
+#endif //TCP_OOO_MAX
         default:
             break;
         }
@@ -527,11 +916,31 @@ static IO* tcps_allocate_io(TCPIPS* tcpips, TCP_TCB* tcb)
     return io;
 }
 
-static void tcps_tx(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
+//sum is partial sum of payload, filled while copying or gathering
+static void tcps_tx(TCPIPS* tcpips, IO* io, TCP_TCB* tcb, uint32_t sum)
 {
     TCP_HEADER* tcp = io_data(io);
+    unsigned int hdr_size = io->data_size - tcps_data_len(io);
+    unsigned int size = io->data_size;
+#if (TCPIP_TX_GATHER)
+    size += ips_gather_size(io);
+#endif //TCPIP_TX_GATHER
     short2be(tcp->window_be, tcb->rx_wnd);
-    short2be(tcp->checksum_be, tcp_checksum(io_data(io), io->data_size, &tcpips->ips.ip, &tcb->remote_addr));
+    if (tcp->flags & TCP_FLAG_ACK)
+    {
+        //pure ACK is covering all pending, data is saving them all
+        if ((size > hdr_size) || (tcp->flags & (TCP_FLAG_SYN | TCP_FLAG_FIN | TCP_FLAG_RST)))
+            tcpips->tcps.ack_saved += tcb->ack_segs;
+        else
+        {
+            ++tcpips->tcps.ack_tx;
+            if (tcb->ack_segs > 1)
+                tcpips->tcps.ack_saved += tcb->ack_segs - 1;
+        }
+        tcb->ack_segs = 0;
+    }
+    short2be(tcp->checksum_be, tcp_checksum_hdr(io_data(io), hdr_size, size, &tcpips->ips.ip, &tcb->remote_addr, sum));
+    ++tcpips->tcps.tx_segs;
 #if (TCP_DEBUG_PACKETS)
     tcps_debug(io, &tcpips->ips.ip, &tcb->remote_addr);
 #endif //TCP_DEBUG_PACKETS
@@ -550,7 +959,7 @@ static void tcps_tx_rst(TCPIPS* tcpips, HANDLE tcb_handle, uint32_t seq)
     tcp_tx = io_data(tx);
     tcp_tx->flags |= TCP_FLAG_RST;
     int2be(tcp_tx->seq_be, seq);
-    tcps_tx(tcpips, tx, tcb);
+    tcps_tx(tcpips, tx, tcb, 0);
 }
 
 static void tcps_tx_rst_ack(TCPIPS* tcpips, HANDLE tcb_handle, uint32_t ack)
@@ -566,7 +975,7 @@ static void tcps_tx_rst_ack(TCPIPS* tcpips, HANDLE tcb_handle, uint32_t ack)
     tcp_tx->flags |= TCP_FLAG_RST | TCP_FLAG_ACK;
     int2be(tcp_tx->seq_be, 0);
     int2be(tcp_tx->ack_be, ack);
-    tcps_tx(tcpips, tx, tcb);
+    tcps_tx(tcpips, tx, tcb, 0);
 }
 
 static void tcps_tx_ack(TCPIPS* tcpips, HANDLE tcb_handle)
@@ -581,54 +990,179 @@ static void tcps_tx_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     tcp_tx = io_data(tx);
 
     tcp_tx->flags |= TCP_FLAG_ACK;
-    int2be(tcp_tx->seq_be, tcb->snd_nxt);
+    int2be(tcp_tx->seq_be, tcb->snd_pos);
     int2be(tcp_tx->ack_be, tcb->rcv_nxt);
-    tcps_tx(tcpips, tx, tcb);
-    tcps_timer_start(tcb);
+#if (TCP_OOO_MAX)
+    tcps_append_sack(tx, tcb);
+#endif //TCP_OOO_MAX
+    tcps_tx(tcpips, tx, tcb, 0);
+    tcps_timer_start(tcb, tcb_handle);
 }
 
-static void tcps_tx_text_ack_fin(TCPIPS* tcpips, HANDLE tcb_handle)
+#if (TCPIP_TX_GATHER)
+//reference user write IO data by frame instead of copy
+static bool tcps_gather(TCPIPS* tcpips, IO* frame, IO* io, unsigned int offset, unsigned int size)
+{
+    TCP_GATHER* gather;
+    if (tcpips->tcps.gather == NULL && array_create(&tcpips->tcps.gather, sizeof(TCP_GATHER), 1) == NULL)
+        return false;
+    if ((gather = array_append(&tcpips->tcps.gather)) == NULL)
+        return false;
+    gather->frame = frame;
+    gather->io = io;
+    gather->parked = false;
+    ips_gather(frame, (uint8_t*)io_data(io) + offset, size);
+    return true;
+}
+
+void tcps_gather_released(TCPIPS* tcpips, IO* frame)
+{
+    unsigned int i;
+    TCP_GATHER gather;
+    for (i = 0; i < array_size(tcpips->tcps.gather); ++i)
+    {
+        if (((TCP_GATHER*)array_at(tcpips->tcps.gather, i))->frame != frame)
+            continue;
+        gather = *((TCP_GATHER*)array_at(tcpips->tcps.gather, i));
+        array_remove(&tcpips->tcps.gather, i);
+        if (!gather.parked)
+            return;
+        //last frame, referencing IO
+        for (i = 0; i < array_size(tcpips->tcps.gather); ++i)
+            if (((TCP_GATHER*)array_at(tcpips->tcps.gather, i))->io == gather.io)
+                return;
+        io_complete_ex(gather.process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), gather.tcb_handle, gather.io, gather.param3);
+        return;
+    }
+}
+#endif //TCPIP_TX_GATHER
+
+//unsent data size. FIN is last virtual byte and not in data
+static unsigned int tcps_tx_unsent(TCP_TCB* tcb)
+{
+    unsigned int res = tcps_delta(tcb->snd_pos, tcb->snd_nxt);
+    if (tcb->fin && res)
+        --res;
+    return res;
+}
+
+static bool tcps_tx_segment(TCPIPS* tcpips, HANDLE tcb_handle, uint32_t seq, unsigned int size, bool fin)
 {
     IO* io;
+    IO* tx;
     TCP_HEADER* tcp;
     TCP_STACK* tcp_stack;
-    unsigned int size;
+    unsigned int i, offset, chunk;
+    uint32_t sum = 0;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 
     if ((io = tcps_allocate_io(tcpips, tcb)) == NULL)
-        return;
+        return false;
 
     tcp = io_data(io);
     tcp->flags |= TCP_FLAG_ACK;
-    int2be(tcp->seq_be, tcb->snd_una);
+    int2be(tcp->seq_be, seq);
     int2be(tcp->ack_be, tcb->rcv_nxt);
-    //if no transmit window, request window update, wait timeout, than try again
-    if (tcb->tx_wnd)
+    //segment can span over few user IOs
+    offset = tcb->tx_cur + tcps_delta(tcb->snd_una, seq);
+    for (i = tcb->tx_head; size && i < array_size(tcb->tx_queue); ++i)
     {
-        if (tcb->tx != NULL)
+        tx = *((IO**)array_at(tcb->tx_queue, i));
+        if (offset >= tx->data_size)
         {
-            size = tcb->tx->data_size - tcb->tx_cur;
-            if (size > tcb->tx_wnd)
-                size = tcb->tx_wnd;
-            memcpy((uint8_t*)io_data(io) + io->data_size, (uint8_t*)io_data(tcb->tx) + tcb->tx_cur, size);
-            io->data_size += size;
-            //apply flags
-            tcp_stack = io_stack(tcb->tx);
-            if ((tcp_stack->flags & TCP_PSH) && (tcb->tx_cur + size >= tcb->tx->data_size))
-                tcp->flags |= TCP_FLAG_PSH;
-            if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > tcb->tx_cur))
-            {
-                tcp->flags |= TCP_FLAG_URG;
-                short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - tcb->tx_cur);
-            }
+            offset -= tx->data_size;
+            continue;
         }
-        else
-            size = 0;
-        if (tcb->fin && (tcb->snd_una != tcb->snd_nxt) && (size < tcb->tx_wnd))
-            tcp->flags |= TCP_FLAG_FIN;
-        tcps_tx(tcpips, io, tcb);
+        chunk = tx->data_size - offset;
+        if (chunk > size)
+            chunk = size;
+        //apply flags
+        tcp_stack = io_stack(tx);
+        if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > offset) && (io->data_size == sizeof(TCP_HEADER)))
+        {
+            tcp->flags |= TCP_FLAG_URG;
+            short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - offset);
+        }
+        if ((tcp_stack->flags & TCP_PSH) && (offset + chunk >= tx->data_size))
+            tcp->flags |= TCP_FLAG_PSH;
+#if (TCPIP_TX_GATHER)
+        //whole segment is inside one user IO. Only header is built in frame
+        if ((chunk == size) && (chunk >= TCP_GATHER_MIN) && (io->data_size == sizeof(TCP_HEADER)) && tcps_gather(tcpips, io, tx, offset, chunk))
+        {
+            sum = ip_checksum_sum((uint8_t*)io_data(tx) + offset, chunk, sum);
+            break;
+        }
+#endif //TCPIP_TX_GATHER
+        sum = ip_checksum_copy((uint8_t*)io_data(io) + io->data_size, (uint8_t*)io_data(tx) + offset, chunk, sum, io->data_size);
+        io->data_size += chunk;
+        size -= chunk;
+        offset = 0;
     }
-    tcps_timer_start(tcb);
+    if (fin)
+        tcp->flags |= TCP_FLAG_FIN;
+    tcps_tx(tcpips, io, tcb, sum);
+    return true;
+}
+
+//transmit new data and FIN, bounded by send and congestion windows. Returns true if anything sent
+static bool tcps_tx_text(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    unsigned int unsent, flight, size;
+    bool fin;
+    bool res = false;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+
+    while ((tcb->snd_pos != tcb->snd_nxt) && (tcpips_io_available(tcpips) > TCP_FRAMES_RESERVE))
+    {
+        unsent = tcps_tx_unsent(tcb);
+        flight = tcps_delta(tcb->snd_una, tcb->snd_pos);
+        size = tcb->tx_wnd < tcb->cwnd ? tcb->tx_wnd : tcb->cwnd;
+        size = size > flight ? size - flight : 0;
+        if (size > tcb->mss)
+            size = tcb->mss;
+        if (size > unsent)
+            size = unsent;
+        //sender SWS avoidance: don't split data on small window, wait for ACK clock
+        if ((size < unsent) && (size < tcb->mss) && flight)
+            break;
+        //FIN is not occupying window
+        fin = tcb->fin && (size == unsent);
+        if ((size == 0 && !fin) || !tcps_tx_segment(tcpips, tcb_handle, tcb->snd_pos, size, fin))
+            break;
+        //time new data only. Retransmitted segments are ambiguous (Karn)
+        if (!tcb->rtt_timing && size && tcps_diff(tcb->snd_max, tcb->snd_pos) >= 0)
+        {
+            tcb->rtt_timing = true;
+            tcb->rtt_seq = tcb->snd_pos + size;
+            get_uptime(&tcb->rtt_start);
+        }
+        tcb->snd_pos += fin ? size + 1 : size;
+        if (tcps_diff(tcb->snd_max, tcb->snd_pos) > 0)
+            tcb->snd_max = tcb->snd_pos;
+        res = true;
+    }
+    return res;
+}
+
+//retransmit first unacknowledged segment
+static void tcps_tx_retransmit(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    unsigned int size;
+    bool fin;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+
+    tcb->rtt_timing = false;
+    size = tcps_delta(tcb->snd_una, tcb->snd_pos);
+    fin = tcb->fin && size && (tcb->snd_pos == tcb->snd_nxt);
+    if (fin)
+        --size;
+    if (size > tcb->mss)
+    {
+        size = tcb->mss;
+        fin = false;
+    }
+    if (size || fin)
+        tcps_tx_segment(tcpips, tcb_handle, tcb->snd_una, size, fin);
 }
 
 static void tcps_tx_syn(TCPIPS* tcpips, HANDLE tcb_handle)
@@ -645,10 +1179,13 @@ static void tcps_tx_syn(TCPIPS* tcpips, HANDLE tcb_handle)
     //SYN flag
     tcp->flags |= TCP_FLAG_SYN;
     tcps_append_mss(io);
+#if (TCP_OOO_MAX)
+    tcps_append_opt(io, TCP_OPTS_SACK_PERMITTED, NULL, 2);
+#endif //TCP_OOO_MAX
 
     int2be(tcp->seq_be, tcb->snd_una);
-    tcps_tx(tcpips, io, tcb);
-    tcps_timer_start(tcb);
+    tcps_tx(tcpips, io, tcb, 0);
+    tcps_timer_start(tcb, tcb_handle);
 }
 
 static void tcps_tx_syn_ack(TCPIPS* tcpips, HANDLE tcb_handle)
@@ -665,12 +1202,51 @@ static void tcps_tx_syn_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     //add ACK, SYN flags
     tcp->flags |= TCP_FLAG_ACK | TCP_FLAG_SYN;
     tcps_append_mss(io);
+#if (TCP_OOO_MAX)
+    if (tcb->sack)
+        tcps_append_opt(io, TCP_OPTS_SACK_PERMITTED, NULL, 2);
+#endif //TCP_OOO_MAX
 
     int2be(tcp->seq_be, tcb->snd_una);
     int2be(tcp->ack_be, tcb->rcv_nxt);
-    tcps_tx(tcpips, io, tcb);
-    tcps_timer_start(tcb);
+    tcps_tx(tcpips, io, tcb, 0);
+    tcps_timer_start(tcb, tcb_handle);
+}
+
+#if (TCP_OOO_MAX)
+static bool tcps_ooo_find(TCP_TCB* tcb, IO* io)
+{
+    unsigned int i;
+    for (i = 0; i < tcb->ooo_count; ++i)
+        if (tcb->ooo[i] == io)
+            return true;
+    return false;
+}
+
+static void tcps_ooo_insert(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
+{
+    unsigned int i;
+    int delta;
+    uint32_t seq = be2int(((TCP_HEADER*)io_data(io))->seq_be);
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //queue is bounded, and not starving stack from frames
+    if (tcb->ooo_count >= TCP_OOO_MAX || tcpips_io_available(tcpips) <= TCP_FRAMES_RESERVE)
+        return;
+    for (i = 0; i < tcb->ooo_count; ++i)
+    {
+        delta = tcps_diff(be2int(((TCP_HEADER*)io_data(tcb->ooo[i]))->seq_be), seq);
+        //already queued
+        if (delta == 0)
+            return;
+        if (delta < 0)
+            break;
+    }
+    memmove(tcb->ooo + i + 1, tcb->ooo + i, (tcb->ooo_count - i) * sizeof(IO*));
+    tcb->ooo[i] = io;
+    ++tcb->ooo_count;
+    tcb->ooo_last = seq;
 }
+#endif //TCP_OOO_MAX
 
 static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
@@ -692,6 +1268,7 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
 #if (TCP_DEBUG_FLOW)
             printf("TCP: Dup\n");
 #endif //TCP_DEBUG_FLOW
+            ++tcpips->tcps.otw_drops;
             if (tcb->state == TCP_STATE_SYN_RECEIVED)
                 tcps_tx_syn_ack(tcpips, tcb_handle);
             else
@@ -754,9 +1331,16 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
         //RST bit is set, drop the segment and return:
         if (tcp->flags & TCP_FLAG_RST)
         {
-            tcps_timer_start(tcb);
+            tcps_timer_start(tcb, tcb_handle);
             return false;
         }
+#if (TCP_OOO_MAX)
+        //future segment in window, keep it until gap is filled
+        if ((seq_delta > 0) && (seq_delta + seg_len <= tcb->rx_wnd) && tcps_data_len(io) && (tcp->flags & TCP_FLAG_ACK) && !(tcp->flags & TCP_FLAG_SYN))
+            tcps_ooo_insert(tcpips, io, tcb_handle);
+        else
+#endif //TCP_OOO_MAX
+            ++tcpips->tcps.otw_drops;
 
         tcps_tx_ack(tcpips, tcb_handle);
         return false;
@@ -764,13 +1348,128 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
     return true;
 }
 
+//RFC 6298 smoothing: SRTT = 7/8 SRTT + 1/8 R, RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, then RTO update
+static void tcps_rtt_sample(TCPIPS* tcpips, TCP_TCB* tcb, unsigned int rtt)
+{
+    int delta;
+    ++tcpips->tcps.rtt_samples;
+    //zero is reserved for no samples
+    if (rtt == 0)
+        rtt = 1;
+    if (tcb->srtt == 0)
+    {
+        tcb->srtt = rtt << 3;
+        tcb->rttvar = rtt << 1;
+    }
+    else
+    {
+        delta = (int)rtt - (int)(tcb->srtt >> 3);
+        tcb->srtt += delta;
+        if (delta < 0)
+            delta = -delta;
+        tcb->rttvar += delta - (int)(tcb->rttvar >> 2);
+    }
+    //RTO = SRTT + max(G, 4 * RTTVAR), G is 1ms. RTTVAR is already scaled by 4. New sample cancels backoff
+    tcb->rto = ((tcb->srtt >> 3) + tcb->rttvar + 999) / 1000;
+    if (tcb->rto < TCP_RTO_MIN)
+        tcb->rto = TCP_RTO_MIN;
+    if (tcb->rto > TCP_RTO_MAX)
+        tcb->rto = TCP_RTO_MAX;
+}
+
+static void tcps_rx_new_ack(TCPIPS* tcpips, HANDLE tcb_handle, unsigned int acked)
+{
+    IO* io;
+    unsigned int size;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcb->snd_una += acked;
+    if (tcb->rtt_timing && tcps_diff(tcb->rtt_seq, tcb->snd_una) >= 0)
+    {
+        tcb->rtt_timing = false;
+        tcps_rtt_sample(tcpips, tcb, systime_elapsed_us(&tcb->rtt_start));
+    }
+    //acked beyond transmit point after go-back on timeout
+    if (tcps_diff(tcb->snd_pos, tcb->snd_una) > 0)
+        tcb->snd_pos = tcb->snd_una;
+    tcb->dup_acks = 0;
+    //RFC 6298 5.3: restart on new data ACK. Running timer is not touched, deadline is checked on timeout
+    if (tcb->timer_mode == TCP_TIMER_RTO)
+        get_uptime(&tcb->rto_start);
+
+    //return sent buffers to user
+    for (size = acked; tcb->tx_head < array_size(tcb->tx_queue); )
+    {
+        io = *((IO**)array_at(tcb->tx_queue, tcb->tx_head));
+        if (size < io->data_size - tcb->tx_cur)
+        {
+            tcb->tx_cur += size;
+            break;
+        }
+        size -= io->data_size - tcb->tx_cur;
+        tcb->tx_cur = 0;
+        tcps_tx_queue_pop(tcb);
+        io_pop(io, sizeof(TCP_STACK));
+        tcps_tx_complete(tcpips, tcb->process, tcb_handle, io, io->data_size);
+    }
+
+    if (tcb->recovery)
+    {
+        //all data, sent before loss, is acked. Deflate window
+        if (tcps_diff(tcb->recover, tcb->snd_una) >= 0)
+        {
+            tcb->recovery = false;
+            tcb->cwnd = tcb->ssthresh;
+        }
+        //partial ack: next segment is also lost
+        else
+        {
+            tcb->cwnd = (tcb->cwnd > acked ? tcb->cwnd - acked : 0) + tcb->mss;
+            tcps_tx_retransmit(tcpips, tcb_handle);
+        }
+    }
+    //slow start
+    else if (tcb->cwnd < tcb->ssthresh)
+        tcb->cwnd += acked < tcb->mss ? acked : tcb->mss;
+    //congestion avoidance: about one segment per RTT
+    else
+        tcb->cwnd += (tcb->mss * tcb->mss) / tcb->cwnd + 1;
+    if (tcb->cwnd > TCP_CWND_MAX)
+        tcb->cwnd = TCP_CWND_MAX;
+}
+
+static void tcps_rx_dup_ack(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    unsigned int flight;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //segment left the network, inflate window
+    if (tcb->recovery)
+    {
+        tcb->cwnd += tcb->mss;
+        if (tcb->cwnd > TCP_CWND_MAX)
+            tcb->cwnd = TCP_CWND_MAX;
+        return;
+    }
+    if (++tcb->dup_acks < TCP_DUP_ACK_THRESHOLD)
+        return;
+#if (TCP_DEBUG_FLOW)
+    printf("TCP: fast retransmit\n");
+#endif //TCP_DEBUG_FLOW
+    flight = tcps_delta(tcb->snd_una, tcb->snd_pos);
+    tcb->ssthresh = flight / 2 > 2 * tcb->mss ? flight / 2 : 2 * tcb->mss;
+    tcb->cwnd = tcb->ssthresh + TCP_DUP_ACK_THRESHOLD * tcb->mss;
+    tcb->recover = tcb->snd_max;
+    tcb->recovery = true;
+    ++tcpips->tcps.fast_retransmits;
+    tcps_tx_retransmit(tcpips, tcb_handle);
+}
+
 static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
     int snd_diff, ack_diff;
     TCP_HEADER* tcp;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     tcp = io_data(io);
-    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_nxt);
+    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_max);
     ack_diff = tcps_diff(tcb->snd_una, be2int(tcp->ack_be));
 
     if (tcb->state == TCP_STATE_SYN_RECEIVED)
@@ -788,7 +1487,7 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         {
             //form a reset segment
             tcps_tx_rst(tcpips, tcb_handle, be2int(tcp->ack_be));
-            tcps_timer_start(tcb);
+            tcps_timer_start(tcb, tcb_handle);
             return false;
         }
     }
@@ -806,22 +1505,10 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         tcb->retry = 0;
     //adjust ack
     if (ack_diff > 0)
-    {
-        tcb->snd_una += ack_diff;
-        if (tcb->tx != NULL)
-        {
-            if (ack_diff >= tcb->tx->data_size - tcb->tx_cur)
-            {
-                //return sent buffers to user
-                io_pop(tcb->tx, sizeof(TCP_STACK));
-                io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx);
-                tcb->tx = NULL;
-                tcb->tx_cur = 0;
-            }
-            else
-                tcb->tx_cur += ack_diff;
-        }
-    }
+        tcps_rx_new_ack(tcpips, tcb_handle, ack_diff);
+    //same ack, no data, same window with segments in flight
+    else if ((ack_diff == 0) && (tcps_seg_len(io) == 0) && !tcb->wnd_changed && (tcb->snd_pos != tcb->snd_una))
+        tcps_rx_dup_ack(tcpips, tcb_handle);
 
     switch (tcb->state)
     {
@@ -847,7 +1534,8 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     return true;
 }
 
-static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
+//returns true, if io is kept by connection. Zero copy frame is passed to user here, so FIN is returned in fin
+static bool tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle, bool* fin)
 {
     TCP_STACK* tcp_stack;
     TCP_HEADER* tcp;
@@ -856,6 +1544,7 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     uint16_t urg, urg_tmp;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     tcp = io_data(io);
+    *fin = (tcp->flags & TCP_FLAG_FIN) != 0;
 
     switch (tcb->state)
     {
@@ -863,6 +1552,21 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     case TCP_STATE_FIN_WAIT_1:
     case TCP_STATE_FIN_WAIT_2:
         tcb->rx_cur = data_size = tcps_data_len(io);
+#if (TCP_ZERO_COPY_FRAMES)
+        if (data_size && tcb->zero_copy)
+        {
+            //not accepted, so FIN too
+            if (!tcps_queue_frame(tcpips, io, tcb_handle))
+            {
+                *fin = false;
+                return false;
+            }
+            tcb->rcv_nxt += data_size;
+            tcb->retry = 0;
+            tcps_update_rx_wnd(tcb);
+            return true;
+        }
+#endif //TCP_ZERO_COPY_FRAMES
         if (data_size)
         {
             data_offset = tcps_data_offset(io);
@@ -917,7 +1621,19 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             {
                 //move to tmp
                 if (tcb->rx_tmp == NULL)
+                {
+                    //drop part, already copied to user block
+                    if (data_offset > tcps_data_offset(io))
+                    {
+                        memmove((uint8_t*)io_data(io) + tcps_data_offset(io), (uint8_t*)io_data(io) + data_offset, data_size);
+                        io->data_size = tcps_data_offset(io) + data_size;
+                        if (urg)
+                            short2be(tcp->urgent_pointer_be, urg);
+                        else
+                            tcp->flags &= ~TCP_FLAG_URG;
+                    }
                     tcb->rx_tmp = io;
+                }
                 //append to tmp
                 else
                 {
@@ -953,8 +1669,51 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         //Ignore the segment text
         break;
     }
+    return tcb->rx_tmp == io;
 }
 
+#if (TCP_OOO_MAX)
+//process text of queued segments, which are in sequence now. Returns true if FIN is reached
+static bool tcps_ooo_merge(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    TCP_HEADER* tcp;
+    int delta;
+    unsigned int data_off, data_len;
+    bool kept;
+    bool fin = false;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    while (tcb->ooo_count && !fin)
+    {
+        io = tcb->ooo[0];
+        tcp = io_data(io);
+        delta = tcps_diff(tcb->rcv_nxt, be2int(tcp->seq_be));
+        //gap is still here
+        if (delta > 0)
+            break;
+        memmove(tcb->ooo, tcb->ooo + 1, (--tcb->ooo_count) * sizeof(IO*));
+        data_off = tcps_data_offset(io);
+        data_len = tcps_data_len(io);
+        //already received with other segment
+        if ((unsigned int)(-delta) > data_len || ((unsigned int)(-delta) == data_len && !(tcp->flags & TCP_FLAG_FIN)))
+        {
+            ips_release_io(tcpips, io);
+            continue;
+        }
+        if (delta < 0)
+        {
+            memmove((uint8_t*)io_data(io) + data_off, (uint8_t*)io_data(io) + data_off + (-delta), data_len - (-delta));
+            io->data_size -= -delta;
+            int2be(tcp->seq_be, tcb->rcv_nxt);
+        }
+        kept = tcps_rx_text(tcpips, io, tcb_handle, &fin);
+        if (!kept)
+            ips_release_io(tcpips, io);
+    }
+    return fin;
+}
+#endif //TCP_OOO_MAX
+
 static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
@@ -990,20 +1749,23 @@ static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
     return true;
 }
 
-static inline void tcps_rx_send(TCPIPS* tcpips, HANDLE tcb_handle)
+static inline void tcps_rx_send(TCPIPS* tcpips, HANDLE tcb_handle, bool ack, bool delay)
 {
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
-
-    //ack from remote host - we transmitted all
-    if (tcb->state == TCP_STATE_ESTABLISHED && tcb->transmit && (tcb->snd_una == tcb->snd_nxt) && !tcb->fin && tcb->rx_cur == 0)
-    {
-        tcb->transmit = false;
-#if (TCP_KEEP_ALIVE)
-        tcps_timer_start(tcb);
-#endif //TCP_KEEP_ALIVE
-        return;
-    }
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    tcb->transmit = (tcb->snd_una != tcb->snd_nxt);
+    if (ack)
+        ++tcb->ack_segs;
+    //ACK is piggybacked on data/FIN. Pure ACK is not acked
+    if (tcps_tx_text(tcpips, tcb_handle) || !ack)
+        tcps_timer_start(tcb, tcb_handle);
+#if (TCP_DELAYED_ACK_MS)
+    //RFC 1122 4.2.3.2: ACK at least every second segment. Timer is shared with retransmission, so only on idle sender.
+    //Don't hold remote sender on nearly closed window
+    else if (delay && (tcb->ack_segs < 2) && !tcb->transmit && (tcb->rx_wnd >= 2 * TCP_MSS_MAX))
+        tcps_timer_start(tcb, tcb_handle);
+#endif //TCP_DELAYED_ACK_MS
+    else
+        tcps_tx_ack(tcpips, tcb_handle);
 }
 
 static inline void tcps_rx_closed(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
@@ -1047,8 +1809,8 @@ static inline void tcps_rx_listen(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         {
             tcps_set_state(tcb, TCP_STATE_SYN_RECEIVED);
             tcb->rcv_nxt = be2int(tcp->seq_be) + 1;
-            tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-            ++tcb->snd_nxt;
+            tcb->snd_una = tcb->snd_nxt = tcb->recover = tcps_gen_isn();
+            tcb->snd_pos = tcb->snd_max = ++tcb->snd_nxt;
 
             tcps_tx_syn_ack(tcpips, tcb_handle);
             return;
@@ -1061,6 +1823,7 @@ static inline void tcps_rx_listen(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 
 static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
+    bool fin;
     int ack_diff;
     TCP_HEADER* tcp;
     uint32_t ack;
@@ -1077,7 +1840,7 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         {
             if ((tcp->flags & TCP_FLAG_RST) == 0)
                 tcps_tx_rst(tcpips, tcb_handle, ack);
-            tcps_timer_start(tcb);
+            tcps_timer_start(tcb, tcb_handle);
             return;
         }
     }
@@ -1092,7 +1855,7 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             tcps_destroy_tcb(tcpips, tcb_handle);
         }
         else
-            tcps_timer_start(tcb);
+            tcps_timer_start(tcb, tcb_handle);
         return;
     }
 
@@ -1105,20 +1868,26 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             tcps_set_state(tcb, TCP_STATE_ESTABLISHED);
             //inform user connected successfully
             ipc_post_inline(tcb->process, HAL_CMD(HAL_TCP, IPC_OPEN), tcb_handle, tcb_handle, 0);
-            tcps_rx_text(tcpips, io, tcb_handle);
+            tcps_rx_text(tcpips, io, tcb_handle, &fin);
         }
-        tcps_rx_send(tcpips, tcb_handle);
+        tcps_rx_send(tcpips, tcb_handle, true, false);
         return;
     }
 }
 
 static inline void tcps_rx_otw(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
+    bool ack, fin, delay;
+#if (TCP_OOO_MAX)
+    TCP_TCB* tcb;
+#endif //TCP_OOO_MAX
     TCP_HEADER* tcp = io_data(io);
 
     //first check sequence number
     if (!tcps_rx_otw_check_seq(tcpips, io, tcb_handle))
         return;
+    //segment is occupying sequence space
+    ack = tcps_seg_len(io) != 0;
 
     //second check the RST bit
     //fourth, check the SYN bit
@@ -1135,23 +1904,34 @@ static inline void tcps_rx_otw(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     }
     else
     {
-        tcps_timer_start(so_get(&tcpips->tcps.tcbs, tcb_handle));
+        tcps_timer_start(so_get(&tcpips->tcps.tcbs, tcb_handle), tcb_handle);
         return;
     }
 
     //sixth, check the URG bit
     //seventh, process the segment text
-    tcps_rx_text(tcpips, io, tcb_handle);
+    tcps_rx_text(tcpips, io, tcb_handle, &fin);
+    //in order data only. FIN and filled gap are acked immediately
+    delay = !fin;
+#if (TCP_OOO_MAX)
+    //gap is filled?
+    tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    if (!fin && tcb->ooo_count)
+    {
+        fin = tcps_ooo_merge(tcpips, tcb_handle);
+        delay = false;
+    }
+#endif //TCP_OOO_MAX
 
     //eighth, check the FIN bit
-    if (tcp->flags & TCP_FLAG_FIN)
+    if (fin)
     {
         if (!tcps_rx_otw_fin(tcpips, tcb_handle))
             return;
     }
 
     //finally send ACK reply/data/fin/etc
-    tcps_rx_send(tcpips, tcb_handle);
+    tcps_rx_send(tcpips, tcb_handle, ack, delay);
 }
 
 static inline void tcps_rx_process(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
@@ -1176,8 +1956,47 @@ static inline void tcps_rx_process(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 
 void tcps_init(TCPIPS* tcpips)
 {
+    unsigned int i;
     so_create(&tcpips->tcps.listen, sizeof(TCP_LISTEN_HANDLE), 1);
     so_create(&tcpips->tcps.tcbs, sizeof(TCP_TCB), 1);
+    for (i = 0; i < TCP_HASH_SIZE; ++i)
+        tcpips->tcps.tcb_hash[i] = tcpips->tcps.port_hash[i] = tcpips->tcps.listen_hash[i] = INVALID_HANDLE;
+    tcpips->tcps.ack_tx = tcpips->tcps.ack_saved = 0;
+    tcpips->tcps.rx_segs = tcpips->tcps.checksum_errors = tcpips->tcps.tx_segs = 0;
+    tcpips->tcps.retransmits = tcpips->tcps.fast_retransmits = tcpips->tcps.otw_drops = 0;
+    tcpips->tcps.rtt_samples = 0;
+#if (TCPIP_TX_GATHER)
+    tcpips->tcps.gather = NULL;
+#endif //TCPIP_TX_GATHER
+}
+
+void tcps_get_stats(TCPIPS* tcpips, TCPIP_STATS* stats)
+{
+    HANDLE handle;
+    TCP_TCB* tcb;
+    unsigned int count, srtt, rttvar;
+    stats->tcp_rx = tcpips->tcps.rx_segs;
+    stats->tcp_checksum_errors = tcpips->tcps.checksum_errors;
+    stats->tcp_tx = tcpips->tcps.tx_segs;
+    stats->tcp_retransmits = tcpips->tcps.retransmits;
+    stats->tcp_fast_retransmits = tcpips->tcps.fast_retransmits;
+    stats->tcp_otw_drops = tcpips->tcps.otw_drops;
+    stats->tcp_ack_tx = tcpips->tcps.ack_tx;
+    stats->tcp_ack_saved = tcpips->tcps.ack_saved;
+    stats->tcp_rtt_samples = tcpips->tcps.rtt_samples;
+    //aggregate of open connections estimations
+    count = srtt = rttvar = 0;
+    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    {
+        tcb = so_get(&tcpips->tcps.tcbs, handle);
+        if (tcb->srtt == 0)
+            continue;
+        ++count;
+        srtt += tcb->srtt >> 3;
+        rttvar += tcb->rttvar >> 2;
+    }
+    stats->tcp_srtt = count ? srtt / count : 0;
+    stats->tcp_rttvar = count ? rttvar / count : 0;
 }
 
 void tcps_link_changed(TCPIPS* tcpips, bool link)
@@ -1189,7 +2008,10 @@ void tcps_link_changed(TCPIPS* tcpips, bool link)
         while((handle = so_first(&tcpips->tcps.tcbs)) != INVALID_HANDLE)
             tcps_close_connection(tcpips, handle, ERROR_CONNECTION_CLOSED);
         while((handle = so_first(&tcpips->tcps.listen)) != INVALID_HANDLE)
+        {
+            tcps_unlink_listener(tcpips, handle);
             so_free(&tcpips->tcps.listen, handle);
+        }
     }
 }
 
@@ -1198,9 +2020,14 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
     TCP_HEADER* tcp;
     TCP_TCB* tcb;
     HANDLE tcb_handle, process;
-    uint16_t src_port, dst_port;
+    uint16_t src_port, dst_port, window;
+#if (TCP_ZERO_COPY_FRAMES)
+    unsigned int held;
+#endif //TCP_ZERO_COPY_FRAMES
+    ++tcpips->tcps.rx_segs;
     if (io->data_size < sizeof(TCP_HEADER) || tcp_checksum(io_data(io), io->data_size, src, &tcpips->ips.ip))
     {
+        ++tcpips->tcps.checksum_errors;
         ips_release_io(tcpips, io);
         return;
     }
@@ -1228,14 +2055,27 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
     if (tcb_handle != INVALID_HANDLE)
     {
         tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
-        timer_stop(tcb->timer, tcb_handle, HAL_TCP);
         tcps_apply_options(tcpips, io, tcb);
-        tcb->tx_wnd = be2short(tcp->window_be);
+        window = be2short(tcp->window_be);
+        tcb->wnd_changed = (window != tcb->tx_wnd);
+        tcb->tx_wnd = window;
         tcb->rx_cur = 0;
+#if (TCP_ZERO_COPY_FRAMES)
+        held = tcb->rx_held;
+#endif //TCP_ZERO_COPY_FRAMES
         tcps_rx_process(tcpips, io, tcb_handle);
         //make sure not queued in rx
         if (tcb->rx_tmp == io)
             return;
+#if (TCP_OOO_MAX)
+        if (tcps_ooo_find(tcb, io))
+            return;
+#endif //TCP_OOO_MAX
+#if (TCP_ZERO_COPY_FRAMES)
+        //queued or passed to user
+        if (tcb->rx_held != held)
+            return;
+#endif //TCP_ZERO_COPY_FRAMES
     }
     ips_release_io(tcpips, io);
 }
@@ -1255,11 +2095,14 @@ static inline void tcps_listen(TCPIPS* tcpips, IPC* ipc)
     tlh = so_get(&tcpips->tcps.listen, handle);
     tlh->port = (uint16_t)ipc->param1;
     tlh->process = ipc->process;
+    tlh->next = tcpips->tcps.listen_hash[tcps_port_hash(tlh->port)];
+    tcpips->tcps.listen_hash[tcps_port_hash(tlh->port)] = handle;
     ipc->param2 = handle;
 }
 
 static inline void tcps_close_listen(TCPIPS* tcpips, HANDLE handle)
 {
+    tcps_unlink_listener(tcpips, handle);
     so_free(&tcpips->tcps.listen, handle);
 }
 
@@ -1314,8 +2157,8 @@ static inline void tcps_open(TCPIPS* tcpips, HANDLE tcb_handle)
         return;
     }
     tcps_set_state(tcb, TCP_STATE_SYN_SENT);
-    tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-    ++tcb->snd_nxt;
+    tcb->snd_una = tcb->snd_nxt = tcb->recover = tcps_gen_isn();
+    tcb->snd_pos = tcb->snd_max = ++tcb->snd_nxt;
     tcps_tx_syn(tcpips, tcb_handle);
     error(ERROR_SYNC);
 }
@@ -1332,7 +2175,9 @@ static inline void tcps_close(TCPIPS* tcpips, HANDLE tcb_handle)
         tcb->fin = true;
         ++tcb->snd_nxt;
         tcps_rx_flush(tcpips, tcb_handle);
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        //FIN goes after all queued data
+        tcps_tx_text(tcpips, tcb_handle);
+        tcps_timer_start(tcb, tcb_handle);
         error(ERROR_SYNC);
         break;
     case TCP_STATE_LAST_ACK:
@@ -1359,13 +2204,19 @@ static inline void tcps_read(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
         error(ERROR_IN_PROGRESS);
         return;
     }
+#if (TCP_ZERO_COPY_FRAMES)
+    if (tcb->zero_copy)
+    {
+        error(ERROR_INVALID_STATE);
+        return;
+    }
+#endif //TCP_ZERO_COPY_FRAMES
     io_reset(io);
     switch (tcb->state)
     {
     case TCP_STATE_ESTABLISHED:
     case TCP_STATE_FIN_WAIT_1:
     case TCP_STATE_FIN_WAIT_2:
-        timer_stop(tcb->timer, tcb_handle, HAL_TCP);
         tcp_stack = io_push(io, sizeof(TCP_STACK));
         tcp_stack->flags = 0;
         tcp_stack->urg_len = 0;
@@ -1435,8 +2286,75 @@ static inline void tcps_read(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
     }
 }
 
+#if (TCP_ZERO_COPY_FRAMES)
+static inline void tcps_read_frame(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    if (tcb == NULL)
+        return;
+    if (tcb->rx != NULL)
+    {
+        error(ERROR_IN_PROGRESS);
+        return;
+    }
+    //switch connection to zero copy mode. Already received data goes first
+    if (!tcb->zero_copy)
+    {
+        //data, appended in copy mode, can take frame headroom. Must be received by tcp_read
+        if (tcb->rx_tmp != NULL && io_get_free(tcb->rx_tmp) < sizeof(TCP_STACK))
+        {
+            error(ERROR_IN_PROGRESS);
+            return;
+        }
+        if (array_create(&tcb->rx_frames, sizeof(IO*), TCP_ZERO_COPY_FRAMES) == NULL)
+            return;
+        tcb->zero_copy = true;
+        if (tcb->rx_tmp != NULL)
+        {
+            tcps_queue_frame(tcpips, tcb->rx_tmp, tcb_handle);
+            tcb->rx_tmp = NULL;
+        }
+    }
+    if (array_size(tcb->rx_frames) == 0)
+    {
+        switch (tcb->state)
+        {
+        case TCP_STATE_ESTABLISHED:
+        case TCP_STATE_FIN_WAIT_1:
+        case TCP_STATE_FIN_WAIT_2:
+            break;
+        default:
+            error(ERROR_INVALID_STATE);
+            return;
+        }
+    }
+    ++tcb->rx_reqs;
+    tcps_deliver_frames(tcpips, tcb_handle);
+    if (tcps_update_rx_wnd(tcb))
+        tcps_tx_ack(tcpips, tcb_handle);
+    error(ERROR_SYNC);
+}
+
+static inline void tcps_frame_released(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
+{
+    TCP_TCB* tcb;
+    uint16_t wnd;
+    HANDLE owner = ((TCP_STACK*)io_stack(io))->owner;
+    tcps_release_frame(tcpips, io);
+    //frame of other connection, or owner is already closed and handle is reused
+    if (owner != tcb_handle || (tcb = so_get(&tcpips->tcps.tcbs, tcb_handle)) == NULL || !tcb->zero_copy || tcb->rx_held == 0)
+        return;
+    --tcb->rx_held;
+    wnd = tcb->rx_wnd;
+    //update only if remote sender is near to stall, next ACK will carry it anyway
+    if (tcps_update_rx_wnd(tcb) && wnd < 2 * TCP_MSS_MAX)
+        tcps_tx_ack(tcpips, tcb_handle);
+}
+#endif //TCP_ZERO_COPY_FRAMES
+
 static inline void tcps_write(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
 {
+    IO** iop;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     if (tcb == NULL)
         return;
@@ -1445,17 +2363,16 @@ static inline void tcps_write(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
         error(ERROR_INVALID_STATE);
         return;
     }
-    if (tcb->tx != NULL)
-    {
-        error(ERROR_IN_PROGRESS);
+    if (tcb->tx_queue == NULL && array_create(&tcb->tx_queue, sizeof(IO*), 1) == NULL)
         return;
-    }
-    timer_stop(tcb->timer, tcb_handle, HAL_TCP);
+    if ((iop = array_append(&tcb->tx_queue)) == NULL)
+        return;
+    *iop = io;
 
-    tcb->tx = io;
     tcb->snd_nxt += io->data_size;
     tcb->transmit = true;
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    tcps_tx_text(tcpips, tcb_handle);
+    tcps_timer_start(tcb, tcb_handle);
     error(ERROR_SYNC);
 }
 
@@ -1469,9 +2386,39 @@ static inline void tcps_flush(TCPIPS* tcpips, HANDLE tcb_handle)
 
 static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
 {
+    unsigned int flight, elapsed;
+    TCP_TIMER mode;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     if (tcb == NULL)
         return;
+    mode = tcb->timer_mode;
+    tcb->timer_mode = TCP_TIMER_IDLE;
+    if (mode == TCP_TIMER_ACK)
+    {
+        //already piggybacked?
+        if (tcb->ack_segs)
+            tcps_tx_ack(tcpips, tcb_handle);
+        else
+            tcps_timer_start(tcb, tcb_handle);
+        return;
+    }
+    if (mode == TCP_TIMER_RTO)
+    {
+        //RFC 6298 5.2: all is acked, timer is stopped lazy
+        if (!tcps_rto_pending(tcb))
+        {
+            tcps_timer_start(tcb, tcb_handle);
+            return;
+        }
+        //restarted by ACK
+        elapsed = systime_elapsed_ms(&tcb->rto_start);
+        if (elapsed < tcb->rto)
+        {
+            tcb->timer_mode = TCP_TIMER_RTO;
+            timer_start_ms(tcb->timer, tcb->rto - elapsed);
+            return;
+        }
+    }
 #if (TCP_KEEP_ALIVE)
     //keep-alive, not error condition
     if ((tcb->state == TCP_STATE_ESTABLISHED) && (tcb->transmit == false))
@@ -1482,7 +2429,7 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
         printf(":%u\n", tcb->remote_port);
 #endif //TCP_DEBUG_FLOW
         tcb->transmit = true;
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        tcps_tx_ack(tcpips, tcb_handle);
         return;
     }
 #endif //TCP_KEEP_ALIVE
@@ -1500,14 +2447,44 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
         tcps_close_connection(tcpips, tcb_handle, ERROR_TIMEOUT);
         return;
     }
+    //RFC 6298 5.5: back off
+    if (mode == TCP_TIMER_RTO)
+        tcb->rto = tcb->rto * 2 < TCP_RTO_MAX ? tcb->rto * 2 : TCP_RTO_MAX;
 
     switch (tcb->state)
     {
     case TCP_STATE_SYN_SENT:
+        ++tcpips->tcps.retransmits;
         tcps_tx_syn(tcpips, tcb_handle);
         break;
+    case TCP_STATE_SYN_RECEIVED:
+        ++tcpips->tcps.retransmits;
+        tcps_tx_syn_ack(tcpips, tcb_handle);
+        break;
     default:
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        //collapse congestion window and go back to first unacknowledged segment
+        flight = tcps_delta(tcb->snd_una, tcb->snd_pos);
+        tcb->rtt_timing = false;
+        if (flight)
+        {
+            ++tcpips->tcps.retransmits;
+            tcb->ssthresh = flight / 2 > 2 * tcb->mss ? flight / 2 : 2 * tcb->mss;
+            tcb->cwnd = tcb->mss;
+            tcb->snd_pos = tcb->snd_una;
+        }
+        tcb->recovery = false;
+        tcb->dup_acks = 0;
+        if (tcps_tx_text(tcpips, tcb_handle))
+            tcps_timer_start(tcb, tcb_handle);
+        //zero window probe
+        else if (tcb->tx_wnd == 0 && tcps_tx_unsent(tcb) && tcps_tx_segment(tcpips, tcb_handle, tcb->snd_pos, 1, false))
+        {
+            if (tcps_diff(tcb->snd_max, ++tcb->snd_pos) > 0)
+                tcb->snd_max = tcb->snd_pos;
+            tcps_timer_start(tcb, tcb_handle);
+        }
+        else
+            tcps_tx_ack(tcpips, tcb_handle);
         break;
     }
 }
@@ -1515,6 +2492,14 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
 void tcps_request(TCPIPS* tcpips, IPC* ipc)
 {
     IP ip;
+#if (TCP_ZERO_COPY_FRAMES)
+    //frame is returned to stack even if link is down
+    if (HAL_ITEM(ipc->cmd) == TCP_RELEASE_FRAME)
+    {
+        tcps_frame_released(tcpips, (HANDLE)ipc->param1, (IO*)ipc->param2);
+        return;
+    }
+#endif //TCP_ZERO_COPY_FRAMES
     if (!tcpips->connected)
     {
         error(ERROR_NOT_ACTIVE);
@@ -1557,6 +2542,11 @@ void tcps_request(TCPIPS* tcpips, IPC* ipc)
     case IPC_FLUSH:
         tcps_flush(tcpips, (HANDLE)ipc->param1);
         break;
+#if (TCP_ZERO_COPY_FRAMES)
+    case TCP_READ_FRAME:
+        tcps_read_frame(tcpips, (HANDLE)ipc->param1);
+        break;
+#endif //TCP_ZERO_COPY_FRAMES
     case IPC_TIMEOUT:
         tcps_timeout(tcpips, (HANDLE)ipc->param1);
         break;
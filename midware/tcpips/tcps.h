@@ -12,7 +12,11 @@
 #include "../../userspace/io.h"
 #include "../../userspace/ip.h"
 #include "../../userspace/so.h"
+#include "../../userspace/array.h"
+#include "../../userspace/tcpip.h"
+#include "../../userspace/tcp.h"
 #include "tcpips.h"
+#include "sys_config.h"
 #include "icmps.h"
 
 #define TCP_FLAG_FIN                                (1 << 0)
@@ -27,10 +31,33 @@
 #define TCP_OPTS_END                                0
 #define TCP_OPTS_NOOP                               1
 #define TCP_OPTS_MSS                                2
+#define TCP_OPTS_SACK_PERMITTED                     4
+#define TCP_OPTS_SACK                               5
+
+#if (TCP_ZERO_COPY_FRAMES)
+//received frame room for TCP_STACK, pushed by zero copy receive
+#define TCP_FRAME_HEADROOM                          sizeof(TCP_STACK)
+#else
+#define TCP_FRAME_HEADROOM                          0
+#endif //TCP_ZERO_COPY_FRAMES
 
 typedef struct {
     SO listen, tcbs;
+    //chains heads: TCB by 4-tuple, TCB by local port, listener by port
+    HANDLE tcb_hash[TCP_HASH_SIZE];
+    HANDLE port_hash[TCP_HASH_SIZE];
+    HANDLE listen_hash[TCP_HASH_SIZE];
     uint16_t dynamic;
+    //pure ACKs sent, and saved by delayed ACK and piggybacking
+    unsigned int ack_tx, ack_saved;
+    //segments received, dropped on checksum, sent. Retransmits on timeout, fast retransmits, received out of window
+    unsigned int rx_segs, checksum_errors, tx_segs, retransmits, fast_retransmits, otw_drops;
+    //RTT samples over all connections. Estimation itself is per connection
+    unsigned int rtt_samples;
+#if (TCPIP_TX_GATHER)
+    //frames, transmitting user write IOs by reference
+    ARRAY* gather;
+#endif //TCPIP_TX_GATHER
 } TCPS;
 
 
@@ -38,6 +65,10 @@ typedef struct {
 void tcps_init(TCPIPS* tcpips);
 void tcps_link_changed(TCPIPS* tcpips, bool link);
 void tcps_request(TCPIPS* tcpips, IPC* ipc);
+void tcps_get_stats(TCPIPS* tcpips, TCPIP_STATS* stats);
+#if (TCPIP_TX_GATHER)
+void tcps_gather_released(TCPIPS* tcpips, IO* frame);
+#endif //TCPIP_TX_GATHER
 
 //from ip
 void tcps_rx(TCPIPS* tcpips, IO* io, IP* src);
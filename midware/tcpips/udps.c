@@ -12,6 +12,7 @@
 #include "../../userspace/error.h"
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
+#include "../../userspace/process.h"
 #include <string.h>
 #include "sys_config.h"
 #include "icmps.h"
@@ -26,10 +27,14 @@ typedef struct {
 #pragma pack(pop)
 
 typedef struct {
-    HANDLE process;
+    HANDLE process, port_next;
     uint16_t remote_port, local_port;
     IP remote_addr;
     IO* head;
+    //batched reads queue and currently filled batch
+    IO* batch_head;
+    IO* batch;
+    bool flush_pending;
 #if (ICMP)
     int err;
 #endif //ICMP
@@ -37,11 +42,18 @@ typedef struct {
 
 #define UDP_FRAME_MAX_DATA_SIZE                                 (IP_FRAME_MAX_DATA_SIZE - sizeof(UDP_HEADER))
 
+#define UDP_DATAGRAM_ALIGN(size)                                (((size) + 3) & ~3)
+
+static inline unsigned int udps_port_hash(uint16_t port)
+{
+    return (port ^ (port >> 8)) & (UDP_HASH_SIZE - 1);
+}
+
 static HANDLE udps_find(TCPIPS* tcpips, uint16_t local_port)
 {
     HANDLE handle;
     UDP_HANDLE* uh;
-    for (handle = so_first(&tcpips->udps.handles); handle != INVALID_HANDLE; handle = so_next(&tcpips->udps.handles, handle))
+    for (handle = tcpips->udps.port_hash[udps_port_hash(local_port)]; handle != INVALID_HANDLE; handle = uh->port_next)
     {
         uh = so_get(&tcpips->udps.handles, handle);
         if (uh->local_port == local_port)
@@ -50,6 +62,29 @@ static HANDLE udps_find(TCPIPS* tcpips, uint16_t local_port)
     return INVALID_HANDLE;
 }
 
+static void udps_link(TCPIPS* tcpips, HANDLE handle)
+{
+    UDP_HANDLE* uh = so_get(&tcpips->udps.handles, handle);
+    HANDLE* head = &tcpips->udps.port_hash[udps_port_hash(uh->local_port)];
+    uh->port_next = *head;
+    *head = handle;
+}
+
+static void udps_unlink(TCPIPS* tcpips, HANDLE handle)
+{
+    HANDLE* cur;
+    UDP_HANDLE* uh = so_get(&tcpips->udps.handles, handle);
+    for (cur = &tcpips->udps.port_hash[udps_port_hash(uh->local_port)]; *cur != INVALID_HANDLE;
+         cur = &((UDP_HANDLE*)so_get(&tcpips->udps.handles, *cur))->port_next)
+    {
+        if (*cur == handle)
+        {
+            *cur = uh->port_next;
+            return;
+        }
+    }
+}
+
 static inline uint16_t udps_allocate_port(TCPIPS* tcpips)
 {
     unsigned int res;
@@ -77,14 +112,20 @@ static inline uint16_t udps_allocate_port(TCPIPS* tcpips)
     return 0;
 }
 
-static IO* udps_peek_head(TCPIPS* tcpips, UDP_HANDLE* uh)
+static IO* udps_peek_head(IO** head)
 {
-    IO* io = uh->head;
+    IO* io = *head;
     if (io)
-        uh->head = *((IO**)io_data(uh->head));
+        *head = *((IO**)io_data(io));
     return io;
 }
 
+static void udps_complete_batch(UDP_HANDLE* uh, HANDLE handle)
+{
+    io_complete(uh->process, HAL_IO_CMD(HAL_UDP, UDP_READ_BATCH), handle, uh->batch);
+    uh->batch = NULL;
+}
+
 static void udps_flush(TCPIPS* tcpips, HANDLE handle)
 {
     IO* io;
@@ -98,10 +139,74 @@ static void udps_flush(TCPIPS* tcpips, HANDLE handle)
     if (uh->err != ERROR_OK)
         err = uh->err;
 #endif //ICMP
-    while ((io = udps_peek_head(tcpips, uh)) != NULL)
+    //already received datagrams are not lost
+    if (uh->batch)
+        udps_complete_batch(uh, handle);
+    while ((io = udps_peek_head(&uh->batch_head)) != NULL)
+        io_complete_ex(uh->process, HAL_CMD(HAL_UDP, UDP_READ_BATCH), handle, io, err);
+    while ((io = udps_peek_head(&uh->head)) != NULL)
         io_complete_ex(uh->process, HAL_CMD(HAL_UDP, IPC_READ), handle, io, err);
 }
 
+static bool udps_send_batch(TCPIPS* tcpips, IP* src, IO* io, UDP_HANDLE* uh, HANDLE handle)
+{
+    UDP_DATAGRAM* dgram;
+    unsigned int size, free;
+    UDP_HEADER* hdr = io_data(io);
+    size = io->data_size - sizeof(UDP_HEADER);
+    for (;;)
+    {
+        if (uh->batch == NULL)
+        {
+            if ((uh->batch = udps_peek_head(&uh->batch_head)) == NULL)
+                return false;
+            uh->batch->data_size = 0;
+        }
+        free = io_get_free(uh->batch);
+        if (free >= sizeof(UDP_DATAGRAM) + UDP_DATAGRAM_ALIGN(size))
+            break;
+        //datagram is larger, than whole batch
+        if (uh->batch->data_size == 0)
+        {
+            //too small even for record header
+            if (free < sizeof(UDP_DATAGRAM))
+            {
+                udps_complete_batch(uh, handle);
+                continue;
+            }
+#if (UDP_DEBUG)
+            printf("UDP: %d byte(s) dropped\n", size - ((free - sizeof(UDP_DATAGRAM)) & ~3));
+#endif //UDP_DEBUG
+            size = (free - sizeof(UDP_DATAGRAM)) & ~3;
+            break;
+        }
+        udps_complete_batch(uh, handle);
+    }
+    dgram = (UDP_DATAGRAM*)((uint8_t*)io_data(uh->batch) + uh->batch->data_size);
+    dgram->remote_addr.u32.ip = src->u32.ip;
+    dgram->remote_port = be2short(hdr->src_port_be);
+    dgram->size = size;
+    memcpy(dgram + 1, hdr + 1, size);
+    uh->batch->data_size += sizeof(UDP_DATAGRAM) + UDP_DATAGRAM_ALIGN(size);
+    //complete batch after already queued frames are processed
+    if (!uh->flush_pending)
+    {
+        uh->flush_pending = true;
+        ipc_post_inline(process_get_current(), HAL_CMD(HAL_UDP, UDP_BATCH_FLUSH), handle, 0, 0);
+    }
+    return true;
+}
+
+static inline void udps_batch_flush(TCPIPS* tcpips, HANDLE handle)
+{
+    UDP_HANDLE* uh = so_get(&tcpips->udps.handles, handle);
+    if (uh == NULL)
+        return;
+    uh->flush_pending = false;
+    if (uh->batch)
+        udps_complete_batch(uh, handle);
+}
+
 static void udps_send_user(TCPIPS* tcpips, IP* src, IO* io, HANDLE handle)
 {
     IO* user_io;
@@ -111,9 +216,11 @@ static void udps_send_user(TCPIPS* tcpips, IP* src, IO* io, HANDLE handle)
     UDP_HEADER* hdr = io_data(io);
 
     uh = so_get(&tcpips->udps.handles, handle);
+    if (udps_send_batch(tcpips, src, io, uh, handle))
+        return;
     for (offset = sizeof(UDP_HEADER); uh->head && offset < io->data_size; offset += size)
     {
-        user_io = udps_peek_head(tcpips, uh);
+        user_io = udps_peek_head(&uh->head);
         udp_stack = io_push(user_io, sizeof(UDP_STACK));
         udp_stack->remote_addr.u32.ip = src->u32.ip;
         udp_stack->remote_port = be2short(hdr->src_port_be);
@@ -133,7 +240,11 @@ static void udps_send_user(TCPIPS* tcpips, IP* src, IO* io, HANDLE handle)
 
 void udps_init(TCPIPS* tcpips)
 {
+    unsigned int i;
     so_create(&tcpips->udps.handles, sizeof(UDP_HANDLE), 1);
+    tcpips->udps.rx = 0;
+    for (i = 0; i < UDP_HASH_SIZE; ++i)
+        tcpips->udps.port_hash[i] = INVALID_HANDLE;
 }
 
 void udps_link_changed(TCPIPS* tcpips, bool link)
@@ -146,6 +257,7 @@ void udps_link_changed(TCPIPS* tcpips, bool link)
         while ((handle = so_first(&tcpips->udps.handles)) != INVALID_HANDLE)
         {
             udps_flush(tcpips, handle);
+            udps_unlink(tcpips, handle);
             so_free(&tcpips->udps.handles, handle);
         }
     }
@@ -188,6 +300,7 @@ void udps_rx(TCPIPS* tcpips, IO* io, IP* src)
         ips_release_io(tcpips, io);
         return;
     }
+    ++tcpips->udps.rx;
     hdr = io_data(io);
     src_port = be2short(hdr->src_port_be);
     dst_port = be2short(hdr->dst_port_be);
@@ -266,10 +379,12 @@ static inline void udps_listen(TCPIPS* tcpips, IPC* ipc)
     uh->local_port = (uint16_t)ipc->param1;
     uh->remote_addr.u32.ip = __LOCALHOST.u32.ip;
     uh->process = ipc->process;
-    uh->head = NULL;
+    uh->head = uh->batch_head = uh->batch = NULL;
+    uh->flush_pending = false;
 #if (ICMP)
     uh->err = ERROR_OK;
 #endif //ICMP
+    udps_link(tcpips, handle);
 
     ipc->param2 = handle;
 }
@@ -291,10 +406,12 @@ static inline void udps_connect(TCPIPS* tcpips, IPC* ipc)
     uh->local_port = local_port;
     uh->remote_addr.u32.ip = dst.u32.ip;
     uh->process = ipc->process;
-    uh->head = NULL;
+    uh->head = uh->batch_head = uh->batch = NULL;
+    uh->flush_pending = false;
 #if (ICMP)
     uh->err = ERROR_OK;
 #endif //ICMP
+    udps_link(tcpips, handle);
     ipc->param2 = handle;
 }
 
@@ -304,11 +421,13 @@ static inline void udps_close(TCPIPS* tcpips, HANDLE handle)
     if ((uh = so_get(&tcpips->udps.handles, handle)) == NULL)
         return;
     udps_flush(tcpips, handle);
+    udps_unlink(tcpips, handle);
     so_free(&tcpips->udps.handles, handle);
 }
 
-static inline void udps_read(TCPIPS* tcpips, HANDLE handle, IO* io)
+static inline void udps_read(TCPIPS* tcpips, HANDLE handle, IO* io, bool batch)
 {
+    IO** head;
     IO* cur;
     UDP_HANDLE* uh;
     uh = so_get(&tcpips->udps.handles, handle);
@@ -323,13 +442,14 @@ static inline void udps_read(TCPIPS* tcpips, HANDLE handle, IO* io)
 #endif //ICMP
     io->data_size = 0;
     *((IO**)io_data(io)) = NULL;
+    head = batch ? &uh->batch_head : &uh->head;
     //add to head
-    if (uh->head == NULL)
-        uh->head = io;
+    if (*head == NULL)
+        *head = io;
     //add to end
     else
     {
-        for (cur = uh->head; *((IO**)io_data(cur)) != NULL; cur = *((IO**)io_data(cur))) {}
+        for (cur = *head; *((IO**)io_data(cur)) != NULL; cur = *((IO**)io_data(cur))) {}
         *((IO**)io_data(cur)) = io;
     }
     error(ERROR_SYNC);
@@ -414,7 +534,13 @@ void udps_request(TCPIPS* tcpips, IPC* ipc)
         udps_close(tcpips, ipc->param1);
         break;
     case IPC_READ:
-        udps_read(tcpips, ipc->param1, (IO*)ipc->param2);
+        udps_read(tcpips, ipc->param1, (IO*)ipc->param2, false);
+        break;
+    case UDP_READ_BATCH:
+        udps_read(tcpips, ipc->param1, (IO*)ipc->param2, true);
+        break;
+    case UDP_BATCH_FLUSH:
+        udps_batch_flush(tcpips, ipc->param1);
         break;
     case IPC_WRITE:
         udps_write(tcpips, ipc->param1, (IO*)ipc->param2);
@@ -15,9 +15,13 @@
 #include "../../userspace/ip.h"
 #include "../../userspace/io.h"
 #include "../../userspace/so.h"
+#include "sys_config.h"
 
 typedef struct {
     SO handles;
+    HANDLE port_hash[UDP_HASH_SIZE];
+    //datagrams received with valid checksum
+    unsigned int rx;
     uint16_t dynamic;
 } UDPS;
 
@@ -135,6 +135,14 @@
 
 #define TCPIP_MTU                                           1500
 #define TCPIP_MAX_FRAMES_COUNT                              10
+//receive frames, posted to ETH driver. Must not exceed driver buffers: 2 with ETH_DOUBLE_BUFFERING, 1 otherwise
+#define TCPIP_RX_FRAMES                                     2
+//transmit frames, handed to ETH driver at once. Must not exceed driver buffers, same as receive
+#define TCPIP_TX_FRAMES                                     2
+//transmit TCP data by reference to user write IO, only headers are built. ETH driver must support ETH_WRITE_GATHER
+#define TCPIP_TX_GATHER                                     1
+//time receive path per layer, reported by tcpip_get_stats. Takes uptime few times per frame
+#define TCPIP_PROFILE                                       0
 
 //----------------------------- TCP/IP MAC --------------------------------------------
 //software MAC filter. Turn on in case of hardware is not supporting
@@ -176,6 +184,8 @@
 
 //----------------------------- TCP/IP UDP --------------------------------------------
 #define UDP                                                 0
+//local port lookup buckets. Must be power of 2
+#define UDP_HASH_SIZE                                       8
 #define UDP_DEBUG                                           0
 #define UDP_DEBUG_FLOW                                      0
 
@@ -186,6 +196,14 @@
 #define TCP_TIMEOUT                                         30000
 //0 - don't limit
 #define TCP_HANDLES_LIMIT                                   10
+//connection and listener lookup buckets. Must be power of 2
+#define TCP_HASH_SIZE                                       8
+//out of order segments, queued per connection until gap is filled and reported with SACK. 0 - disable
+#define TCP_OOO_MAX                                         2
+//delay pure ACK until second full segment or timeout, ms. 0 - ACK every segment
+#define TCP_DELAYED_ACK_MS                                  200
+//frames, held by zero copy receive connection: queued and passed to user. Must fit 16 bit window. 0 - disable
+#define TCP_ZERO_COPY_FRAMES                                0
 //Low-level debug. only for development
 #define TCP_DEBUG_FLOW                                      0
 #define TCP_DEBUG_PACKETS                                   0
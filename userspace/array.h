@@ -26,6 +26,7 @@ typedef struct {
     ARRAY* (*lib_array_clear)(ARRAY**, const STD_MEM*);
     ARRAY* (*lib_array_remove)(ARRAY**, const STD_MEM*, unsigned int);
     ARRAY* (*lib_array_squeeze)(ARRAY**, const STD_MEM*);
+    ARRAY* (*lib_array_reserve)(ARRAY**, const STD_MEM*, unsigned int);
 } LIB_ARRAY;
 
 __STATIC_INLINE ARRAY* array_create(ARRAY** ar, unsigned int data_size, unsigned int reserved)
@@ -73,4 +74,10 @@ __STATIC_INLINE ARRAY* array_squeeze(ARRAY** ar)
     return ((const LIB_ARRAY*)__GLOBAL->lib[LIB_ID_ARRAY])->lib_array_squeeze(ar, &__STD_MEM);
 }
 
+//make sure, next count appends will not cause realloc
+__STATIC_INLINE ARRAY* array_reserve(ARRAY** ar, unsigned int count)
+{
+    return ((const LIB_ARRAY*)__GLOBAL->lib[LIB_ID_ARRAY])->lib_array_reserve(ar, &__STD_MEM, count);
+}
+
 #endif // ARRAY_H
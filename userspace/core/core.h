@@ -17,6 +17,7 @@
 #include "../lpc/lpc.h"
 #include "../ti/ti.h"
 #include "../nrf/nrf.h"
+#include "../linux/linux.h"
 
 #ifdef REXOSP
 #include "rexosp.h"
@@ -29,9 +29,16 @@ typedef enum {
     ETH_SET_MAC = IPC_USER,
     ETH_GET_MAC,
     ETH_NOTIFY_LINK_CHANGED,
-    ETH_GET_HEADER_SIZE
+    ETH_GET_HEADER_SIZE,
+    ETH_WRITE_GATHER
 }ETH_IPCS;
 
+//ETH_WRITE_GATHER frame tail, transmitted by reference right after IO data. Pushed on frame IO stack.
+typedef struct {
+    const void* data;
+    unsigned int size;
+} ETH_GATHER;
+
 void eth_set_mac(HANDLE eth, unsigned int eth_handle, const MAC* mac);
 void eth_get_mac(HANDLE eth, unsigned int eth_handle, MAC* mac);
 unsigned int eth_get_header_size(HANDLE eth, unsigned int eth_handle);
@@ -8,6 +8,8 @@
 
 #include "ip.h"
 #include "stdio.h"
+#include "endian.h"
+#include <string.h>
 
 void ip_print(const IP* ip)
 {
@@ -20,18 +22,154 @@ void ip_print(const IP* ip)
     }
 }
 
-uint16_t ip_checksum(void* buf, unsigned int size)
+typedef union {
+    uint16_t u16;
+    uint8_t u8[2];
+} IP_SUM_WORD;
+
+//one's complement addition with end around carry
+static inline uint32_t ip_sum_add(uint32_t sum, uint32_t value)
+{
+    sum += value;
+    return sum + (sum < value);
+}
+
+static inline uint16_t ip_sum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)((sum & 0xffff) + (sum >> 16));
+}
+
+static inline uint16_t ip_sum_swap(uint16_t sum)
+{
+    return (uint16_t)((sum << 8) | (sum >> 8));
+}
+
+//byte on even (0) or odd (1) position of 16 bit word in memory order
+static inline uint16_t ip_sum_byte(uint8_t value, unsigned int pos)
+{
+    IP_SUM_WORD w;
+    w.u8[pos] = value;
+    w.u8[pos ^ 1] = 0;
+    return w.u16;
+}
+
+/*
+    Sum of block in memory byte order, folded to 16 bit, block is at even offset. Copy while summing if dst is not NULL.
+    RFC 1071: sum is byte order independent, so words are summed as is. Unaligned head is summed
+    shifted by one byte and swapped back at the end.
+*/
+static inline uint16_t ip_sum_block(uint8_t* dst, const uint8_t* src, unsigned int size)
 {
-    unsigned int i;
     uint32_t sum = 0;
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
+    uint32_t w0, w1, w2, w3;
+    bool odd = (unsigned int)src & 1;
+    if (odd && size)
+    {
+        sum = ip_sum_byte(*src, 1);
+        if (dst)
+            *dst++ = *src;
+        ++src;
+        --size;
+    }
+    if (((unsigned int)src & 2) && size >= 2)
+    {
+        sum += *(const uint16_t*)src;
+        if (dst)
+        {
+            *(uint16_t*)dst = *(const uint16_t*)src;
+            dst += 2;
+        }
+        src += 2;
+        size -= 2;
+    }
+    for (; size >= 16; size -= 16)
+    {
+        w0 = ((const uint32_t*)src)[0];
+        w1 = ((const uint32_t*)src)[1];
+        w2 = ((const uint32_t*)src)[2];
+        w3 = ((const uint32_t*)src)[3];
+        if (dst)
+        {
+            ((uint32_t*)dst)[0] = w0;
+            ((uint32_t*)dst)[1] = w1;
+            ((uint32_t*)dst)[2] = w2;
+            ((uint32_t*)dst)[3] = w3;
+            dst += 16;
+        }
+        sum = ip_sum_add(sum, w0);
+        sum = ip_sum_add(sum, w1);
+        sum = ip_sum_add(sum, w2);
+        sum = ip_sum_add(sum, w3);
+        src += 16;
+    }
+    for (; size >= 4; size -= 4)
+    {
+        w0 = *(const uint32_t*)src;
+        if (dst)
+        {
+            *(uint32_t*)dst = w0;
+            dst += 4;
+        }
+        sum = ip_sum_add(sum, w0);
+        src += 4;
+    }
+    if (size >= 2)
+    {
+        sum = ip_sum_add(sum, *(const uint16_t*)src);
+        if (dst)
+        {
+            *(uint16_t*)dst = *(const uint16_t*)src;
+            dst += 2;
+        }
+        src += 2;
+        size -= 2;
+    }
     //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    if (size)
+    {
+        sum = ip_sum_add(sum, ip_sum_byte(*src, 0));
+        if (dst)
+            *dst = *src;
+    }
+    return odd ? ip_sum_swap(ip_sum_fold(sum)) : ip_sum_fold(sum);
+}
+
+uint32_t ip_checksum_sum(const void* buf, unsigned int size, uint32_t sum)
+{
+    return ip_sum_add(sum, ip_sum_block(NULL, buf, size));
+}
+
+uint32_t ip_checksum_copy(void* dst, const void* src, unsigned int size, uint32_t sum, unsigned int offset)
+{
+    uint16_t res;
+    //word access is possible only on same alignment
+    if (((unsigned int)dst ^ (unsigned int)src) & 3)
+    {
+        memcpy(dst, src, size);
+        res = ip_sum_block(NULL, dst, size);
+    }
+    else
+        res = ip_sum_block(dst, src, size);
+    return ip_sum_add(sum, (offset & 1) ? ip_sum_swap(res) : res);
+}
+
+uint16_t ip_checksum_fold(uint32_t sum)
+{
+    IP_SUM_WORD w;
+    w.u16 = ~ip_sum_fold(sum);
+    return be2short(w.u8);
+}
+
+uint16_t ip_checksum_update(uint16_t checksum, uint16_t old_value, uint16_t new_value)
+{
+    //RFC 1624: HC' = ~(~HC + ~m + m')
+    return ~ip_sum_fold((uint32_t)(uint16_t)~checksum + (uint16_t)~old_value + new_value);
+}
+
+uint16_t ip_checksum(void* buf, unsigned int size)
+{
+    return ip_checksum_fold(ip_sum_block(NULL, buf, size));
 }
 
 bool ip_compare(const IP* ip1, const IP* ip2, const IP* mask)
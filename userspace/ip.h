@@ -229,6 +229,14 @@ typedef enum {
 
 void ip_print(const IP* ip);
 uint16_t ip_checksum(void *buf, unsigned int size);
+//partial one's complement sum in memory byte order. Block is at even offset of checksummed data
+uint32_t ip_checksum_sum(const void* buf, unsigned int size, uint32_t sum);
+//copy block, placed at offset of checksummed data, adding it to partial sum
+uint32_t ip_checksum_copy(void* dst, const void* src, unsigned int size, uint32_t sum, unsigned int offset);
+//final checksum of partial sum, ready for short2be
+uint16_t ip_checksum_fold(uint32_t sum);
+//RFC 1624 incremental update of checksum on 16 bit field change. Values are in host order, as returned by be2short
+uint16_t ip_checksum_update(uint16_t checksum, uint16_t old_value, uint16_t new_value);
 bool ip_compare(const IP* ip1, const IP* ip2, const IP* mask);
 void ip_set(HANDLE tcpip, const IP* ip);
 void ip_get(HANDLE tcpip, IP* ip);
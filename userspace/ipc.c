@@ -26,18 +26,27 @@ static int ipc_index(HANDLE wait_process, unsigned int cmd, unsigned int param1)
     return -1;
 }
 
+static int ipc_find(HANDLE wait_process, unsigned int cmd, unsigned int param1)
+{
+    //nothing with same cmd hash, don't scan
+    if ((cmd != ANY_CMD) && (__GLOBAL->process->ipc_posted[IPC_HASH(cmd)] == __GLOBAL->process->ipc_consumed[IPC_HASH(cmd)]))
+        return -1;
+    return ipc_index(wait_process, cmd, param1);
+}
+
 static IPC* ipc_peek(int index, IPC* ipc)
 {
-    //cmd, process, handle
-    IPC tmp;
-    for(; index != __GLOBAL->process->ipcs.tail; index = RB_ROUND_BACK(&__GLOBAL->process->ipcs, index - 1))
+    RB* ipcs = &__GLOBAL->process->ipcs;
+    memcpy(ipc, IPC_ITEM(index), sizeof(IPC));
+    //shift older IPCs by one slot, keeping order. At most two contiguous spans and wrap item
+    if ((unsigned int)index < ipcs->tail)
     {
-        //swap
-        memcpy(&tmp, IPC_ITEM(index), sizeof(IPC));
-        memcpy(IPC_ITEM(index), IPC_ITEM(RB_ROUND_BACK(&__GLOBAL->process->ipcs, index - 1)), sizeof(IPC));
-        memcpy(IPC_ITEM(RB_ROUND_BACK(&__GLOBAL->process->ipcs, index - 1)), &tmp, sizeof(IPC));
+        memmove(IPC_ITEM(1), IPC_ITEM(0), index * sizeof(IPC));
+        memcpy(IPC_ITEM(0), IPC_ITEM(ipcs->size - 1), sizeof(IPC));
+        index = ipcs->size - 1;
     }
-    memcpy(ipc, IPC_ITEM(__GLOBAL->process->ipcs.tail), sizeof(IPC));
+    memmove(IPC_ITEM(ipcs->tail + 1), IPC_ITEM(ipcs->tail), (index - ipcs->tail) * sizeof(IPC));
+    ++__GLOBAL->process->ipc_consumed[IPC_HASH(ipc->cmd)];
     rb_get(&__GLOBAL->process->ipcs);
     return ipc;
 }
@@ -47,7 +56,7 @@ unsigned int ipc_remove(HANDLE process, unsigned int cmd, unsigned int param1)
     unsigned int count;
     int index;
     IPC tmp;
-    for(count = 0; (index = ipc_index(process, cmd, param1)) >= 0; ++count)
+    for(count = 0; (index = ipc_find(process, cmd, param1)) >= 0; ++count)
         ipc_peek(index, &tmp);
     return count;
 }
@@ -84,6 +93,20 @@ void ipc_ipost_inline(HANDLE process, unsigned int cmd, unsigned int param1, uns
     ipc_ipost(&ipc);
 }
 
+unsigned int ipc_post_batch(IPC* ipcs, unsigned int count)
+{
+    unsigned int posted = 0;
+    svc_call(SVC_IPC_POST_BATCH, (unsigned int)ipcs, count, (unsigned int)&posted);
+    return posted;
+}
+
+unsigned int ipc_ipost_batch(IPC* ipcs, unsigned int count)
+{
+    unsigned int posted = 0;
+    __GLOBAL->svc_irq(SVC_IPC_POST_BATCH, (unsigned int)ipcs, count, (unsigned int)&posted);
+    return posted;
+}
+
 void ipc_read(IPC* ipc)
 {
     for (;;)
@@ -101,7 +124,7 @@ void ipc_read(IPC* ipc)
 
 void ipc_read_ex(IPC* ipc, HANDLE process, unsigned int cmd, unsigned int param1)
 {
-    if (ipc_index(process, cmd, param1) < 0)
+    if (ipc_find(process, cmd, param1) < 0)
         svc_call(SVC_IPC_WAIT, process, cmd, param1);
     ipc_peek(ipc_index(process, cmd, param1), ipc);
 }
@@ -103,6 +103,11 @@ typedef enum {
 
 #define ANY_CMD                                             0xffffffff
 
+//IPC queue is indexed by cmd hash. Pending count is posted - consumed, so kernel and process are never writing same counter.
+//Only tells, if scan is required. Scan itself is linear of queue size
+#define IPC_HASH_SIZE                                       8
+#define IPC_HASH(cmd)                                       (((cmd) ^ ((cmd) >> 16)) & (IPC_HASH_SIZE - 1))
+
 typedef struct {
     HANDLE process;
     unsigned int cmd;
@@ -173,6 +178,26 @@ void ipc_ipost(IPC* ipc);
 */
 void ipc_ipost_inline(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3);
 
+/**
+    \brief post array of IPC in single supervisor call
+    \details Consecutive IPCs for same receiver are queued at once and receiver is waked up once.
+    On receiver overflow posting is stopped and ERROR_OVERFLOW is set.
+    Count, which size in bytes doesn't fit in unsigned int, is rejected with ERROR_OUT_OF_RANGE.
+    \param ipcs: array of IPC structures
+    \param count: number of items in array
+    \retval number of posted IPCs
+*/
+unsigned int ipc_post_batch(IPC* ipcs, unsigned int count);
+
+/**
+    \brief post array of IPC in single supervisor call
+    \details This version must be called for IRQ context
+    \param ipcs: array of IPC structures
+    \param count: number of items in array
+    \retval number of posted IPCs
+*/
+unsigned int ipc_ipost_batch(IPC* ipcs, unsigned int count);
+
 /**
     \brief read IPC. Ping is processed internally
     \param ipc: ipc
@@ -0,0 +1,34 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#include "host.h"
+#include "../types.h"
+#include "../stdio.h"
+#include <stdarg.h>
+
+//from libc
+extern long write(int fd, const void* buf, unsigned int count);
+extern void _exit(int status);
+
+void host_write(const char *const buf, unsigned int size, void* param)
+{
+    write(1, buf, size);
+}
+
+void host_printf(const char *const fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    format(fmt, va, host_write, NULL);
+    va_end(va);
+}
+
+void host_exit(int status)
+{
+    _exit(status);
+}
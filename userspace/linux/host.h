@@ -0,0 +1,22 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef HOST_H
+#define HOST_H
+
+/*
+    host.h - console output and exit for host-native core apps. Userspace stdout requires driver,
+    so host apps are writing directly to host stdout
+*/
+
+//format callback, param is ignored
+void host_write(const char *const buf, unsigned int size, void* param);
+void host_printf(const char *const fmt, ...);
+void host_exit(int status);
+
+#endif // HOST_H
@@ -0,0 +1,43 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2019, RExOS team
+    All rights reserved.
+
+    author: Alexey E. Kramarenko (alexeyk13@yandex.ru)
+*/
+
+#ifndef LINUX_H
+#define LINUX_H
+
+/*
+    linux.h - host-native core. Kernel and all processes are running as single linux process.
+    Build with -DLINUX -m32
+*/
+
+#ifdef LINUX
+
+//SRAM is mapped at fixed address on startup
+#ifndef SRAM_BASE
+#define SRAM_BASE                0x20000000
+#endif
+
+#ifndef SRAM_SIZE
+#define SRAM_SIZE                0x100000
+#endif
+
+//vector N is raised by SIGRTMIN + N
+#define IRQ_VECTORS_COUNT        16
+
+//HPET and second pulse are multiplexed on SIGALRM
+#define HPET_IRQn                0
+//first vector, free for host drivers
+#define USER_IRQn                1
+
+//host signal frame is saved below stack pointer at any time. Pools must not grow there
+#ifndef SIGNAL_FRAME_SIZE
+#define SIGNAL_FRAME_SIZE        0x1000
+#endif
+
+#endif //LINUX
+
+#endif // LINUX_H
@@ -65,6 +65,9 @@ typedef struct {
     HANDLE stdout, stdin;
     const char* name;
     RB ipcs;
+    //IPC queue index. Posted by kernel, consumed by process
+    unsigned short ipc_posted[IPC_HASH_SIZE];
+    unsigned short ipc_consumed[IPC_HASH_SIZE];
     //follow:
     //IPC queue
     //name holder (if not persistent)
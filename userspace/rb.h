@@ -17,6 +17,7 @@
 
 #include "types.h"
 #include "cc_macro.h"
+#include <string.h>
 
 #define RB_ROUND(rb, pos)                                ((pos) >= ((rb)->size) ? 0 : (pos))
 #define RB_ROUND_BACK(rb, pos)                           ((pos) < 0 ? ((rb)->size) - 1 : (pos))
@@ -116,6 +117,102 @@ __STATIC_INLINE unsigned int rb_free(RB* rb)
     return rb->tail > rb->head ? rb->tail - rb->head - 1: rb->size - rb->head + rb->tail - 1;
 }
 
+/**
+    \brief get rb contiguous free size after head
+    \param rb: pointer to initialized \ref RB structure
+    \retval free items, that can be put without wrap
+*/
+__STATIC_INLINE unsigned int rb_put_span(RB* rb)
+{
+    if (rb->tail > rb->head)
+        return rb->tail - rb->head - 1;
+    return rb->tail ? rb->size - rb->head : rb->size - rb->head - 1;
+}
+
+/**
+    \brief get rb contiguous used size after tail
+    \param rb: pointer to initialized \ref RB structure
+    \retval used items, that can be get without wrap
+*/
+__STATIC_INLINE unsigned int rb_get_span(RB* rb)
+{
+    return rb->tail > rb->head ? rb->size - rb->tail : rb->head - rb->tail;
+}
+
+/**
+    \brief mark items as put, after they are written directly at head
+    \param rb: pointer to initialized \ref RB structure
+    \param size: items count. Must not exceed \ref rb_free
+    \retval none
+*/
+__STATIC_INLINE void rb_put_advance(RB* rb, unsigned int size)
+{
+    rb->head += size;
+    if (rb->head >= rb->size)
+        rb->head -= rb->size;
+}
+
+/**
+    \brief mark items as get, after they are read directly at tail
+    \param rb: pointer to initialized \ref RB structure
+    \param size: items count. Must not exceed \ref rb_size
+    \retval none
+*/
+__STATIC_INLINE void rb_get_advance(RB* rb, unsigned int size)
+{
+    rb->tail += size;
+    if (rb->tail >= rb->size)
+        rb->tail -= rb->size;
+}
+
+/**
+    \brief put block of bytes in ring buffer
+    \details data is copied by maximum 2 contiguous chunks
+    \param rb: pointer to initialized \ref RB structure
+    \param data: ring buffer data
+    \param buf: source buffer
+    \param size: size of source buffer
+    \retval bytes put, limited by ring buffer free space
+*/
+__STATIC_INLINE unsigned int rb_put_n(RB* rb, void* data, const void* buf, unsigned int size)
+{
+    register unsigned int chunk;
+    chunk = rb_free(rb);
+    if (size > chunk)
+        size = chunk;
+    chunk = rb->size - rb->head;
+    if (chunk > size)
+        chunk = size;
+    memcpy((char*)data + rb->head, buf, chunk);
+    memcpy(data, (const char*)buf + chunk, size - chunk);
+    rb_put_advance(rb, size);
+    return size;
+}
+
+/**
+    \brief get block of bytes from ring buffer
+    \details data is copied by maximum 2 contiguous chunks
+    \param rb: pointer to initialized \ref RB structure
+    \param data: ring buffer data
+    \param buf: destination buffer
+    \param size: size of destination buffer
+    \retval bytes get, limited by ring buffer used size
+*/
+__STATIC_INLINE unsigned int rb_get_n(RB* rb, const void* data, void* buf, unsigned int size)
+{
+    register unsigned int chunk;
+    chunk = rb_size(rb);
+    if (size > chunk)
+        size = chunk;
+    chunk = rb->size - rb->tail;
+    if (chunk > size)
+        chunk = size;
+    memcpy(buf, (const char*)data + rb->tail, chunk);
+    memcpy((char*)buf + chunk, data, size - chunk);
+    rb_get_advance(rb, size);
+    return size;
+}
+
 /**
     \}
  */
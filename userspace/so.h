@@ -29,6 +29,7 @@ typedef struct {
     HANDLE (*lib_so_first)(SO*, const STD_MEM*);
     HANDLE (*lib_so_next)(SO*, const STD_MEM*, HANDLE);
     unsigned int (*lib_so_count)(SO*, const STD_MEM*);
+    SO* (*lib_so_reserve)(SO*, const STD_MEM*, unsigned int);
 } LIB_SO;
 
 __STATIC_INLINE SO* so_create(SO* so, unsigned int data_size, unsigned int reserved)
@@ -77,4 +78,10 @@ __STATIC_INLINE unsigned int so_count(SO* so)
     return ((const LIB_SO*)__GLOBAL->lib[LIB_ID_SO])->lib_so_count(so, &__STD_MEM);
 }
 
+//make sure, next count allocations will not cause realloc
+__STATIC_INLINE SO* so_reserve(SO* so, unsigned int count)
+{
+    return ((const LIB_SO*)__GLOBAL->lib[LIB_ID_SO])->lib_so_reserve(so, &__STD_MEM, count);
+}
+
 #endif // SO_H
@@ -101,6 +101,54 @@ bool stream_read(HANDLE handle, char* buf, unsigned int size)
     return get_last_error() == ERROR_OK;
 }
 
+unsigned int stream_write_reserve(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    svc_call(SVC_STREAM_WRITE_RESERVE, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+unsigned int stream_iwrite_reserve(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    __GLOBAL->svc_irq(SVC_STREAM_WRITE_RESERVE, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+void stream_write_commit(HANDLE handle, unsigned int size)
+{
+    svc_call(SVC_STREAM_WRITE_COMMIT, (unsigned int)handle, size, 0);
+}
+
+void stream_iwrite_commit(HANDLE handle, unsigned int size)
+{
+    __GLOBAL->svc_irq(SVC_STREAM_WRITE_COMMIT, (unsigned int)handle, size, 0);
+}
+
+unsigned int stream_read_peek(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    svc_call(SVC_STREAM_READ_PEEK, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+unsigned int stream_iread_peek(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    __GLOBAL->svc_irq(SVC_STREAM_READ_PEEK, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+void stream_read_consume(HANDLE handle, unsigned int size)
+{
+    svc_call(SVC_STREAM_READ_CONSUME, (unsigned int)handle, size, 0);
+}
+
+void stream_iread_consume(HANDLE handle, unsigned int size)
+{
+    __GLOBAL->svc_irq(SVC_STREAM_READ_CONSUME, (unsigned int)handle, size, 0);
+}
+
 void stream_flush(HANDLE stream)
 {
     svc_call(SVC_STREAM_FLUSH, (unsigned int)stream, 0, 0);
@@ -131,6 +131,75 @@ unsigned int stream_iread_no_block(HANDLE handle, const char* buf, unsigned int
 */
 bool stream_read(HANDLE handle, char* buf, unsigned int size);
 
+/**
+    \brief reserve space for direct (zero-copy) write to STREAM internal buffer
+    \details Returned space is contiguous, so can be used as DMA target. Data is not visible for
+    readers until \ref stream_write_commit. Reservation is exclusive: reserve on other handle and
+    copying writes are failed with ERROR_IN_PROGRESS until commit.
+    \param handle: handle of created stream
+    \param buf: pointer to receive start of free space
+    \retval number of bytes, that can be written to buf
+*/
+unsigned int stream_write_reserve(HANDLE handle, char** buf);
+
+/**
+    \brief reserve space for direct (zero-copy) write to STREAM internal buffer, ISR version
+    \param handle: handle of created stream
+    \param buf: pointer to receive start of free space
+    \retval number of bytes, that can be written to buf
+*/
+unsigned int stream_iwrite_reserve(HANDLE handle, char** buf);
+
+/**
+    \brief commit data, written directly after \ref stream_write_reserve
+    \param handle: handle of created stream
+    \param size: number of bytes written. Must not exceed reserved size. 0 to cancel reservation
+    \retval none
+*/
+void stream_write_commit(HANDLE handle, unsigned int size);
+
+/**
+    \brief commit data, written directly after \ref stream_iwrite_reserve. ISR version
+    \param handle: handle of created stream
+    \param size: number of bytes written. Must not exceed reserved size
+    \retval none
+*/
+void stream_iwrite_commit(HANDLE handle, unsigned int size);
+
+/**
+    \brief get STREAM internal buffer for direct (zero-copy) read
+    \details Returned data is contiguous and stays in STREAM until \ref stream_read_consume.
+    Only one reader can use peek/consume on STREAM.
+    \param handle: handle of created stream
+    \param buf: pointer to receive start of data
+    \retval number of bytes, available at buf
+*/
+unsigned int stream_read_peek(HANDLE handle, char** buf);
+
+/**
+    \brief get STREAM internal buffer for direct (zero-copy) read, ISR version
+    \param handle: handle of created stream
+    \param buf: pointer to receive start of data
+    \retval number of bytes, available at buf
+*/
+unsigned int stream_iread_peek(HANDLE handle, char** buf);
+
+/**
+    \brief release data, processed after \ref stream_read_peek
+    \param handle: handle of created stream
+    \param size: number of bytes processed. Must not exceed peeked size
+    \retval none
+*/
+void stream_read_consume(HANDLE handle, unsigned int size);
+
+/**
+    \brief release data, processed after \ref stream_iread_peek. ISR version
+    \param handle: handle of created stream
+    \param size: number of bytes processed. Must not exceed peeked size
+    \retval none
+*/
+void stream_iread_consume(HANDLE handle, unsigned int size);
+
 /**
     \brief flush STREAM
     \param stream: created STREAM object
@@ -51,6 +51,7 @@ typedef enum {
     SVC_IPC_POST,
     SVC_IPC_WAIT,
     SVC_IPC_CALL,
+    SVC_IPC_POST_BATCH,
 
     SVC_STREAM_CREATE,
     SVC_STREAM_OPEN,
@@ -63,6 +64,10 @@ typedef enum {
     SVC_STREAM_READ,
     SVC_STREAM_WRITE_NO_BLOCK,
     SVC_STREAM_READ_NO_BLOCK,
+    SVC_STREAM_WRITE_RESERVE,
+    SVC_STREAM_WRITE_COMMIT,
+    SVC_STREAM_READ_PEEK,
+    SVC_STREAM_READ_CONSUME,
     SVC_STREAM_FLUSH,
     SVC_STREAM_DESTROY,
 
@@ -86,13 +91,18 @@ typedef void (*STDOUT)(const char *const buf, unsigned int size, void* param);
 
 /**
     \brief arch-dependent stack pointer query
-    \details Same for every ARM, so defined here
+    \details Same for every ARM, so defined here. On host core space for signal frame is excluded
     \retval stack pointer
 */
 __STATIC_INLINE void* get_sp()
 {
   void* result;
+#ifdef LINUX
+  __ASM volatile ("mov %%esp, %0" : "=r" (result));
+  result = (char*)result - SIGNAL_FRAME_SIZE;
+#else
   __ASM volatile ("mov %0, sp" : "=r" (result));
+#endif //LINUX
   return result;
 }
 
@@ -19,27 +19,22 @@ typedef struct {
 } TCP_PSEUDO_HEADER;
 #pragma pack(pop)
 
-uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst)
+uint16_t tcp_checksum_hdr(void* buf, unsigned int hdr_size, unsigned int size, const IP* src, const IP* dst, uint32_t sum)
 {
     TCP_PSEUDO_HEADER tph;
-    unsigned int i;
-    uint32_t sum = 0;
     tph.src.u32.ip = src->u32.ip;
     tph.dst.u32.ip = dst->u32.ip;
     tph.zero = 0;
     tph.ptcl = PROTO_TCP;
     short2be(tph.length_be, size);
 
-    for (i = 0; i < (sizeof(TCP_PSEUDO_HEADER) >> 1); ++i)
-        sum += (((uint8_t*)&tph)[i << 1] << 8) | (((uint8_t*)&tph)[(i << 1) + 1]);
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
-    //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    sum = ip_checksum_sum(&tph, sizeof(TCP_PSEUDO_HEADER), sum);
+    return ip_checksum_fold(ip_checksum_sum(buf, hdr_size, sum));
+}
+
+uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst)
+{
+    return tcp_checksum_hdr(buf, size, size, src, dst, 0);
 }
 
 void tcp_get_remote_addr(HANDLE tcpip, HANDLE handle, IP* ip)
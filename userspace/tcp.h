@@ -20,6 +20,8 @@
 typedef struct {
     uint16_t flags;
     uint16_t urg_len;
+    //zero copy frame owner connection, set by stack
+    HANDLE owner;
 } TCP_STACK;
 
 typedef enum {
@@ -28,10 +30,14 @@ typedef enum {
     TCP_CREATE_TCB,
     TCP_GET_REMOTE_ADDR,
     TCP_GET_REMOTE_PORT,
-    TCP_GET_LOCAL_PORT
+    TCP_GET_LOCAL_PORT,
+    TCP_READ_FRAME,
+    TCP_RELEASE_FRAME
 }TCP_IPCS;
 
 uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst);
+//checksum of segment with payload after header already added to partial sum, f.e. by ip_checksum_copy
+uint16_t tcp_checksum_hdr(void* buf, unsigned int hdr_size, unsigned int size, const IP* src, const IP* dst, uint32_t sum);
 
 void tcp_get_remote_addr(HANDLE tcpip, HANDLE handle, IP* ip);
 uint16_t tcp_get_remote_port(HANDLE tcpip, HANDLE handle);
@@ -48,6 +54,10 @@ void tcp_close(HANDLE tcpip, HANDLE handle);
 #define tcp_read_sync(tcpip, handle, io, size)                      io_read_sync((tcpip), HAL_IO_REQ(HAL_TCP, IPC_READ), (handle), (io), (size))
 #define tcp_write(tcpip, handle, io)                                io_write((tcpip), HAL_IO_REQ(HAL_TCP, IPC_WRITE), (handle), (io))
 #define tcp_write_sync(tcpip, handle, io)                           io_write_sync((tcpip), HAL_IO_REQ(HAL_TCP, IPC_WRITE), (handle), (io))
+//zero copy receive. Stack frame with payload and TCP_STACK is completed with HAL_IO_CMD(HAL_TCP, TCP_READ_FRAME), error with HAL_CMD.
+//Connection can't be read with tcp_read after first call. Frame must be returned to stack
+#define tcp_read_frame(tcpip, handle)                               ipc_post_inline((tcpip), HAL_REQ(HAL_TCP, TCP_READ_FRAME), (handle), 0, 0)
+#define tcp_release_frame(tcpip, handle, io)                        ipc_post_inline((tcpip), HAL_IO_CMD(HAL_TCP, TCP_RELEASE_FRAME), (handle), (unsigned int)(io), 0)
 
 void tcp_flush(HANDLE tcpip, HANDLE handle);
 
@@ -9,6 +9,8 @@
 #include "tcpip.h"
 #include "stdio.h"
 #include "process.h"
+#include "io.h"
+#include <string.h>
 
 extern void tcpips_main();
 
@@ -39,3 +41,16 @@ ETH_CONN_TYPE tcpip_get_conn_state(HANDLE tcpip)
 {
     return (ETH_CONN_TYPE)get_handle(tcpip, HAL_REQ(HAL_TCPIP, TCPIP_GET_CONN_STATE), 0, 0, 0);
 }
+
+bool tcpip_get_stats(HANDLE tcpip, TCPIP_STATS* stats)
+{
+    bool res;
+    IO* io = io_create(sizeof(TCPIP_STATS));
+    if (io == NULL)
+        return false;
+    res = io_read_sync(tcpip, HAL_IO_REQ(HAL_TCPIP, TCPIP_GET_STATS), 0, io, sizeof(TCPIP_STATS)) == sizeof(TCPIP_STATS);
+    if (res)
+        memcpy(stats, io_data(io), sizeof(TCPIP_STATS));
+    io_destroy(io);
+    return res;
+}
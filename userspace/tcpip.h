@@ -15,11 +15,41 @@
 
 typedef enum {
     TCPIP_GET_CONN_STATE = IPC_USER,
+    TCPIP_GET_STATS
 }TCPIP_IPCS;
 
+//stack counters since start. Always collected
+typedef struct {
+    //frames from driver and to driver. Completed with error by driver, received with receive ring not full
+    unsigned int rx_frames, tx_frames, rx_errors, rx_starved;
+    //frames in pool: created, highest in use at once, dropped from transmit or ARP queue on pool exhaust
+    unsigned int io_allocated, io_used_max, io_drops;
+    //received frames, dropped by MAC filter or with unknown len/type
+    unsigned int mac_drops;
+    //received IP frames, dropped: malformed or invalid checksum, not for this host, no handler for protocol
+    unsigned int ip_header_errors, ip_addr_drops, ip_proto_drops;
+    //IP reassembly: completed, timed out, evicted by new one, dropped as malformed or too big, fragments with no new data
+    unsigned int ip_assembled, ip_assembly_timeouts, ip_assembly_evictions, ip_assembly_drops, ip_fragment_dups;
+    //frames to hosts, not in ARP cache yet. Queued frames, dropped when ARP is not resolved
+    unsigned int arp_misses, arp_drops;
+    //TCP segments: received, dropped on invalid checksum, sent
+    unsigned int tcp_rx, tcp_checksum_errors, tcp_tx;
+    //retransmits on timeout, fast retransmits by duplicate ACKs, received segments out of window or duplicated
+    unsigned int tcp_retransmits, tcp_fast_retransmits, tcp_otw_drops;
+    //pure ACKs sent, and saved by delayed ACK and piggybacking
+    unsigned int tcp_ack_tx, tcp_ack_saved;
+    //RTT samples over all connections. Smoothed RTT and RTT variation, averaged over open connections, us. Zero if there are no samples yet
+    unsigned int tcp_rtt_samples, tcp_srtt, tcp_rttvar;
+    //IP frames received. UDP datagrams received with valid checksum
+    unsigned int ip_rx, udp_rx;
+    //time in receive path, including upper layers: from MAC, from IP, from TCP, from UDP, us. Only with TCPIP_PROFILE
+    unsigned int rx_us, ip_rx_us, tcp_rx_us, udp_rx_us;
+} TCPIP_STATS;
+
 HANDLE tcpip_create(unsigned int process_size, unsigned int priority, unsigned int eth_handle);
 bool tcpip_open(HANDLE tcpip, HANDLE eth, unsigned int eth_handle, ETH_CONN_TYPE conn_type);
 void tcpip_close(HANDLE tcpip);
 ETH_CONN_TYPE tcpip_get_conn_state(HANDLE tcpip);
+bool tcpip_get_stats(HANDLE tcpip, TCPIP_STATS* stats);
 
 #endif // TCPIP_H
@@ -22,12 +22,30 @@ typedef struct {
 
 #pragma pack(pop)
 
+typedef enum {
+    UDP_READ_BATCH = IPC_USER,
+    //internal: complete partially filled batch after pending datagrams are processed
+    UDP_BATCH_FLUSH
+} UDP_IPCS;
+
+//batched read record. Followed by size bytes of datagram, next record is 4 bytes aligned
+typedef struct {
+    IP remote_addr;
+    uint16_t remote_port;
+    uint16_t size;
+} UDP_DATAGRAM;
+
+#define UDP_DATAGRAM_NEXT(dgram)                                    ((UDP_DATAGRAM*)((uint8_t*)((dgram) + 1) + (((dgram)->size + 3) & ~3)))
+
 uint16_t udp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst);
 HANDLE udp_listen(HANDLE tcpip, unsigned short port);
 HANDLE udp_connect(HANDLE tcpip, unsigned short port, const IP* remote_addr);
 void udp_close_connect(HANDLE tcpip, HANDLE handle);
 #define udp_read(tcpip, handle, io, size)                           io_read((tcpip), HAL_IO_REQ(HAL_UDP, IPC_READ), (handle), (io), (size))
 #define udp_read_sync(tcpip, handle, io, size)                      io_read_sync((tcpip), HAL_IO_REQ(HAL_UDP, IPC_READ), (handle), (io), (size))
+//fill io with UDP_DATAGRAM records. Completed with HAL_IO_CMD(HAL_UDP, UDP_READ_BATCH) when io is full or no more datagrams are pending.
+//Batched reads are served before plain reads
+#define udp_read_batch(tcpip, handle, io, size)                     io_read((tcpip), HAL_IO_REQ(HAL_UDP, UDP_READ_BATCH), (handle), (io), (size))
 
 //write to outgoing connection
 #define udp_write(tcpip, handle, io)                                io_write((tcpip), HAL_IO_REQ(HAL_UDP, IPC_WRITE), (handle), (io))
@@ -123,6 +123,7 @@ void web_server_destroy_node(HANDLE web_server, HANDLE obj);
 void web_server_register_error(HANDLE web_server, WEB_RESPONSE code, const char *html);
 void web_server_unregister_error(HANDLE web_server, WEB_RESPONSE code);
 
+//request body, up to size_max per call. Zero size on end of body
 void web_server_read(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max);
 int web_server_read_sync(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max);
 void web_server_write(HANDLE web_server, HANDLE session, WEB_RESPONSE code,  IO* io);